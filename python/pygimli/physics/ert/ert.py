@@ -162,6 +162,8 @@ class ERTModelling(pg.ModellingBase):
         nEle = len(self.electrodes)
         nData = self.data.size()
 
+        # the prolongation of empty cells needs the neighbour infos
+        mesh.createNeighbourInfos()
         self.resistivity = res = self.createMappedModel(model, -1.0)
 
         if self.verbose():
@@ -53,6 +53,19 @@ public:
     weights_(&weights), k_(&k){
         nData_ = data.size();
         nElecs_ = data.sensorCount();
+
+        //** electrode indices per datum, looked up once and not per cell and wavenumber
+        const RVector & da = data("a");
+        const RVector & db = data("b");
+        const RVector & dm = data("m");
+        const RVector & dn = data("n");
+        ia_.resize(nData_); ib_.resize(nData_); im_.resize(nData_); in_.resize(nData_);
+        for (Index dataIdx = 0; dataIdx < nData_; dataIdx ++ ){
+            ia_[dataIdx] = (int)da[dataIdx];
+            ib_[dataIdx] = (int)db[dataIdx];
+            im_[dataIdx] = (int)dm[dataIdx];
+            in_[dataIdx] = (int)dn[dataIdx];
+        }
     }
 
     virtual ~CreateSensitivityColMT(){}
@@ -71,23 +84,20 @@ public:
     }
 
     virtual void calc2(Index tNr=0){
+        //** fallback for higher order cells
         ElementMatrix < double > S_i;
         ElementMatrix < double > S1_i;
 
+        ElementKernel< 3 > K3;
+        ElementKernel< 4 > K4;
+        ElementKernel< 6 > K6;
+        ElementKernel< 8 > K8;
+
         Cell * cell = NULL;
         int modelIdx = 0;
 
-        const Vector < ValueType > *va;
-        const Vector < ValueType > *vb;
-        const Vector < ValueType > *vm;
-        const Vector < ValueType > *vn;
         Vector < ValueType > dummy((*pots_)[0].size(), ValueType(0));
 
-        const RVector *da = &(*data_)("a");
-        const RVector *db = &(*data_)("b");
-        const RVector *dm = &(*data_)("m");
-        const RVector *dn = &(*data_)("n");
-
         for (Index cellID = start_; cellID < end_; cellID ++) {
 
             cell    = (*para_)[cellID];
@@ -95,28 +105,55 @@ public:
 
             if (modelIdx < 0) continue;
 
-            S1_i.ux2uy2uz2(*cell);
-
+            bool haveS1 = false;
             for (Index kIdx = 0; kIdx < weights_->size(); kIdx ++){
+                double k2 = (*k_)[kIdx] * (*k_)[kIdx];
+                double w = (*weights_)[kIdx];
+                bool done = false;
+                switch (cell->nodeCount()){
+                    case 3: if ((done = elementKernel(*cell, k2, K3))) addSens_(K3, modelIdx, kIdx, w, dummy); break;
+                    case 4: if ((done = elementKernel(*cell, k2, K4))) addSens_(K4, modelIdx, kIdx, w, dummy); break;
+                    case 6: if ((done = elementKernel(*cell, k2, K6))) addSens_(K6, modelIdx, kIdx, w, dummy); break;
+                    case 8: if ((done = elementKernel(*cell, k2, K8))) addSens_(K8, modelIdx, kIdx, w, dummy); break;
+                    default: break;
+                }
+                if (done) continue;
+
+                if (!haveS1){
+                    S1_i.ux2uy2uz2(*cell);
+                    haveS1 = true;
+                }
                 S_i.u2(*cell);
-                S_i *= (*k_)[kIdx] * (*k_)[kIdx];
+                S_i *= k2;
                 S_i += S1_i;
-                int a = 0, b = 0, m = 0, n = 0;
-                for (Index dataIdx = 0; dataIdx < nData_; dataIdx ++ ){
+                addSens_(S_i, modelIdx, kIdx, w, dummy);
+            }
+        }
+    }
 
-                    a = (int)(*da)[dataIdx];
-                    b = (int)(*db)[dataIdx];
-                    m = (int)(*dm)[dataIdx];
-                    n = (int)(*dn)[dataIdx];
+    /*! Add the sensitivities of one cell element matrix S_i and
+     * wavenumber kIdx for all data. */
+    template < class ElementType >
+    void addSens_(ElementType & S_i, int modelIdx, Index kIdx, double weight,
+                  const Vector < ValueType > & dummy){
+        const Vector < ValueType > *va;
+        const Vector < ValueType > *vb;
+        const Vector < ValueType > *vm;
+        const Vector < ValueType > *vn;
 
-                    if (a > -1) va = &(*pots_)[a + nElecs_ * kIdx]; else va = &dummy;
-                    if (b > -1) vb = &(*pots_)[b + nElecs_ * kIdx]; else vb = &dummy;
-                    if (m > -1) vm = &(*pots_)[m + nElecs_ * kIdx]; else vm = &dummy;
-                    if (n > -1) vn = &(*pots_)[n + nElecs_ * kIdx]; else vn = &dummy;
+        const Matrix < ValueType > & pots = *pots_;
+        Matrix < ValueType > & S = *S_;
+        Index offset = nElecs_ * kIdx;
 
-                    (*S_)[dataIdx][modelIdx] += S_i.mult((*va), (*vb), (*vm), (*vn)) * (*weights_)[kIdx];
-                }
-            }
+        for (Index dataIdx = 0; dataIdx < nData_; dataIdx ++ ){
+            int a = ia_[dataIdx], b = ib_[dataIdx], m = im_[dataIdx], n = in_[dataIdx];
+
+            if (a > -1) va = &pots[a + offset]; else va = &dummy;
+            if (b > -1) vb = &pots[b + offset]; else vb = &dummy;
+            if (m > -1) vm = &pots[m + offset]; else vm = &dummy;
+            if (n > -1) vn = &pots[n + offset]; else vn = &dummy;
+
+            S[dataIdx][modelIdx] += S_i.mult((*va), (*vb), (*vm), (*vn)) * weight;
         }
     }
 
@@ -259,6 +296,7 @@ protected:
     const RVector                   * k_;
     uint                            nData_;
     uint                            nElecs_;
+    std::vector < int >             ia_, ib_, im_, in_;
 
 };
 
@@ -436,6 +474,382 @@ void createSensitivityCol(CMatrix & S,
 }
 
 
+DCMatrixFreeJacobian::DCMatrixFreeJacobian(const Mesh & mesh,
+                                           const DataContainerERT & data,
+                                           const RMatrix & pots,
+                                           const RVector & weights,
+                                           const RVector & k,
+                                           const RVector & model,
+                                           uint nThreads, bool verbose)
+    : MatrixBase(verbose), pots_(&pots), weights_(weights), k_(k),
+      nThreads_(max(nThreads, 1)){
+
+    nData_  = data.size();
+    nElecs_ = data.sensorCount();
+    nModel_ = max(mesh.cellMarkers()) + 1;
+
+    if (pots.rows() < weights.size() * nElecs_){
+        throwLengthError(EXIT_MATRIX_SIZE_INVALID, WHERE_AM_I +
+                         " potential matrix rowsize to small." +
+                         str(pots.rows()) + " < " + str(weights.size() * nElecs_));
+    }
+
+    a_.resize(nData_); b_.resize(nData_); m_.resize(nData_); n_.resize(nData_);
+    for (Index i = 0; i < nData_; i ++){
+        a_[i] = (SIndex)data("a")[i];
+        b_[i] = (SIndex)data("b")[i];
+        m_[i] = (SIndex)data("m")[i];
+        n_[i] = (SIndex)data("n")[i];
+    }
+    kFactor_ = data("k");
+
+    std::vector< Cell * > cells(mesh.findCellByMarker(0, -1));
+    std::sort(cells.begin(), cells.end(), lessCellMarker);
+
+    Index nIdx = 0, nMat = 0;
+    for (Index c = 0; c < cells.size(); c ++){
+        Index nn = cells[c]->nodeCount();
+        cellMarker_.push_back(cells[c]->marker());
+        cellNodes_.push_back(nn);
+        idxOffset_.push_back(nIdx);
+        matOffset_.push_back(nMat);
+        nIdx += nn;
+        nMat += nn * nn;
+    }
+    idx_.resize(nIdx);
+    ux_.resize(nMat);
+    u2_.resize(nMat);
+
+    ElementMatrix < double > S_i;
+    for (Index c = 0; c < cells.size(); c ++){
+        Index nn = cellNodes_[c];
+        S_i.ux2uy2uz2(*cells[c]);
+        for (Index i = 0; i < nn; i ++){
+            idx_[idxOffset_[c] + i] = S_i.idx(i);
+            for (Index j = 0; j < nn; j ++){
+                ux_[matOffset_[c] + i * nn + j] = S_i.getVal(i, j);
+            }
+        }
+        S_i.u2(*cells[c]);
+        for (Index i = 0; i < nn; i ++){
+            for (Index j = 0; j < nn; j ++){
+                u2_[matOffset_[c] + i * nn + j] = S_i.getVal(i, j);
+            }
+        }
+    }
+    this->setModel(model);
+
+    if (verbose_) std::cout << "Matrix free Jacobian: " << nData_ << "x"
+                            << nModel_ << " using " << cells.size()
+                            << " cells and " << nElecs_ << " electrodes" << std::endl;
+}
+
+void DCMatrixFreeJacobian::setModel(const RVector & model){
+    modelScale_.resize(nModel_);
+    if (model.size() == nModel_){
+        modelScale_ = 1.0 / (model * model);
+    } else {
+        modelScale_.fill(1.0);
+    }
+}
+
+class DCMatrixFreeMultMT : public GIMLI::BaseCalcMT{
+public:
+    DCMatrixFreeMultMT(RMatrix & G, const RVector & coeff,
+                       const RMatrix & pots, const RVector & weights,
+                       const RVector & k, Index nElecs,
+                       const std::vector < Index > & cellMarker,
+                       const std::vector < Index > & cellNodes,
+                       const std::vector < Index > & idxOffset,
+                       const std::vector < Index > & matOffset,
+                       const IndexArray & idx,
+                       const RVector & ux, const RVector & u2, bool verbose)
+    : BaseCalcMT(1, verbose), G_(&G), coeff_(&coeff), pots_(&pots),
+      weights_(&weights), k_(&k), nElecs_(nElecs), cellMarker_(&cellMarker),
+      cellNodes_(&cellNodes), idxOffset_(&idxOffset), matOffset_(&matOffset),
+      idx_(&idx), ux_(&ux), u2_(&u2){
+    }
+
+    virtual ~DCMatrixFreeMultMT(){}
+
+    /*! G[:, e] = U^T A(v) u_e for the electrode range of this thread, with
+     * A(v) the stiffness matrix assembled with the cell coefficients v. */
+    virtual void calc(Index tNr=0){
+        Index nNodes = pots_->cols();
+        RVector W(nNodes);
+        for (Index e = start_; e < end_; e ++){
+            for (Index kIdx = 0; kIdx < weights_->size(); kIdx ++){
+                const RVector & ue = (*pots_)[e + nElecs_ * kIdx];
+                double k2 = (*k_)[kIdx] * (*k_)[kIdx];
+                W *= 0.0;
+
+                for (Index c = 0; c < cellMarker_->size(); c ++){
+                    double coeff = (*coeff_)[(*cellMarker_)[c]];
+                    if (coeff == 0.0) continue;
+
+                    Index nn = (*cellNodes_)[c];
+                    const Index * id = &(*idx_)[(*idxOffset_)[c]];
+                    const double * sx = &(*ux_)[(*matOffset_)[c]];
+                    const double * s2 = &(*u2_)[(*matOffset_)[c]];
+
+                    for (Index i = 0; i < nn; i ++){
+                        double t = 0.0;
+                        for (Index j = 0; j < nn; j ++){
+                            t += (sx[i * nn + j] + k2 * s2[i * nn + j]) * ue[id[j]];
+                        }
+                        W[id[i]] += coeff * t;
+                    }
+                }
+                for (Index e1 = 0; e1 < nElecs_; e1 ++){
+                    (*G_)[e1][e] += (*weights_)[kIdx] *
+                        dot((*pots_)[e1 + nElecs_ * kIdx], W);
+                }
+            }
+        }
+    }
+
+protected:
+    RMatrix                     * G_;
+    const RVector               * coeff_;
+    const RMatrix               * pots_;
+    const RVector               * weights_;
+    const RVector               * k_;
+    Index                       nElecs_;
+    const std::vector < Index > * cellMarker_;
+    const std::vector < Index > * cellNodes_;
+    const std::vector < Index > * idxOffset_;
+    const std::vector < Index > * matOffset_;
+    const IndexArray            * idx_;
+    const RVector               * ux_;
+    const RVector               * u2_;
+};
+
+class DCMatrixFreeTransMultMT : public GIMLI::BaseCalcMT{
+public:
+    DCMatrixFreeTransMultMT(std::vector < RVector > & out, const RMatrix & Wt,
+                            const RMatrix & pots, const RVector & weights,
+                            const RVector & k, Index nElecs,
+                            const std::vector < Index > & cellMarker,
+                            const std::vector < Index > & cellNodes,
+                            const std::vector < Index > & idxOffset,
+                            const std::vector < Index > & matOffset,
+                            const IndexArray & idx,
+                            const RVector & ux, const RVector & u2, bool verbose)
+    : BaseCalcMT(1, verbose), out_(&out), Wt_(&Wt), pots_(&pots),
+      weights_(&weights), k_(&k), nElecs_(nElecs), cellMarker_(&cellMarker),
+      cellNodes_(&cellNodes), idxOffset_(&idxOffset), matOffset_(&matOffset),
+      idx_(&idx), ux_(&ux), u2_(&u2){
+    }
+
+    virtual ~DCMatrixFreeTransMultMT(){}
+
+    /*! out[marker] += v_e^T S_c u_e with v_e = sum_e2 Wt[e][e2] u_e2 for the
+     * electrode range of this thread. Every thread has its own out vector. */
+    virtual void calc(Index tNr=0){
+        RVector & out = (*out_)[tNr];
+        Index nNodes = pots_->cols();
+        RVector V(nNodes);
+
+        for (Index e = start_; e < end_; e ++){
+            if (sum(abs((*Wt_)[e])) == 0.0) continue;
+
+            for (Index kIdx = 0; kIdx < weights_->size(); kIdx ++){
+                const RVector & ue = (*pots_)[e + nElecs_ * kIdx];
+                double k2 = (*k_)[kIdx] * (*k_)[kIdx];
+                double w = (*weights_)[kIdx];
+
+                V *= 0.0;
+                for (Index e2 = 0; e2 < nElecs_; e2 ++){
+                    double wt = (*Wt_)[e][e2];
+                    if (wt != 0.0) V += (*pots_)[e2 + nElecs_ * kIdx] * wt;
+                }
+
+                for (Index c = 0; c < cellMarker_->size(); c ++){
+                    Index nn = (*cellNodes_)[c];
+                    const Index * id = &(*idx_)[(*idxOffset_)[c]];
+                    const double * sx = &(*ux_)[(*matOffset_)[c]];
+                    const double * s2 = &(*u2_)[(*matOffset_)[c]];
+
+                    double val = 0.0;
+                    for (Index i = 0; i < nn; i ++){
+                        double t = 0.0;
+                        for (Index j = 0; j < nn; j ++){
+                            t += (sx[i * nn + j] + k2 * s2[i * nn + j]) * ue[id[j]];
+                        }
+                        val += t * V[id[i]];
+                    }
+                    out[(*cellMarker_)[c]] += w * val;
+                }
+            }
+        }
+    }
+
+protected:
+    std::vector < RVector >     * out_;
+    const RMatrix               * Wt_;
+    const RMatrix               * pots_;
+    const RVector               * weights_;
+    const RVector               * k_;
+    Index                       nElecs_;
+    const std::vector < Index > * cellMarker_;
+    const std::vector < Index > * cellNodes_;
+    const std::vector < Index > * idxOffset_;
+    const std::vector < Index > * matOffset_;
+    const IndexArray            * idx_;
+    const RVector               * ux_;
+    const RVector               * u2_;
+};
+
+RVector DCMatrixFreeJacobian::mult(const RVector & a) const {
+    if (a.size() != nModel_){
+        throwLengthError(EXIT_MATRIX_SIZE_INVALID, WHERE_AM_I + " " +
+                         str(a.size()) + " != " + str(nModel_));
+    }
+    RVector coeff(a * modelScale_);
+    RMatrix G(nElecs_, nElecs_);
+
+    uint nThreads = min(nThreads_, nElecs_);
+    distributeCalc(DCMatrixFreeMultMT(G, coeff, *pots_, weights_, k_,
+                                      nElecs_, cellMarker_, cellNodes_,
+                                      idxOffset_, matOffset_, idx_, ux_, u2_,
+                                      verbose_),
+                   nElecs_, nThreads, verbose_);
+
+    RVector ret(nData_);
+    for (Index i = 0; i < nData_; i ++){
+        SIndex a = a_[i], b = b_[i], m = m_[i], n = n_[i];
+        double v = 0.0;
+        if (a > -1 && m > -1) v += G[a][m];
+        if (a > -1 && n > -1) v -= G[a][n];
+        if (b > -1 && m > -1) v -= G[b][m];
+        if (b > -1 && n > -1) v += G[b][n];
+        ret[i] = v * kFactor_[i];
+    }
+    return ret;
+}
+
+RVector DCMatrixFreeJacobian::transMult(const RVector & d) const {
+    if (d.size() != nData_){
+        throwLengthError(EXIT_MATRIX_SIZE_INVALID, WHERE_AM_I + " " +
+                         str(d.size()) + " != " + str(nData_));
+    }
+    //** collect the data weights per electrode pair: (a-b) x (m-n)
+    RMatrix Wt(nElecs_, nElecs_);
+    for (Index i = 0; i < nData_; i ++){
+        SIndex a = a_[i], b = b_[i], m = m_[i], n = n_[i];
+        double w = d[i] * kFactor_[i];
+        if (a > -1 && m > -1) Wt[a][m] += w;
+        if (a > -1 && n > -1) Wt[a][n] -= w;
+        if (b > -1 && m > -1) Wt[b][m] -= w;
+        if (b > -1 && n > -1) Wt[b][n] += w;
+    }
+
+    uint nThreads = min(nThreads_, nElecs_);
+    std::vector < RVector > out(nThreads, RVector(nModel_, 0.0));
+
+    distributeCalc(DCMatrixFreeTransMultMT(out, Wt, *pots_, weights_, k_,
+                                           nElecs_, cellMarker_, cellNodes_,
+                                           idxOffset_, matOffset_, idx_,
+                                           ux_, u2_, verbose_),
+                   nElecs_, nThreads, verbose_);
+
+    RVector ret(out[0]);
+    for (Index i = 1; i < out.size(); i ++) ret += out[i];
+    return ret * modelScale_;
+}
+
+RVector DCMatrixFreeJacobian::row(Index i) const {
+    RVector e(nData_, 0.0);
+    e[i] = 1.0;
+    return transMult(e);
+}
+
+CompressedJacobian::CompressedJacobian(const RMatrix & J, double relError,
+                                       bool verbose)
+    : MatrixBase(verbose), rows_(J.rows()), cols_(J.cols()), relError_(0.0){
+
+    Stopwatch swatch(true);
+    rowPtr_.resize(rows_ + 1, 0);
+
+    //** per row: drop the smallest entries by index, so ties with the
+    //** last dropped value are kept and the energy budget holds
+    double totalEnergy = 0.0, droppedEnergy = 0.0;
+    std::vector < std::pair < double, Index > > sq(cols_);
+    std::vector < bool > drop(cols_);
+    std::vector < double > vals;
+
+    for (Index i = 0; i < rows_; i ++){
+        const RVector & row = J[i];
+        for (Index j = 0; j < cols_; j ++){
+            sq[j] = std::pair < double, Index >(row[j] * row[j], j);
+        }
+        std::sort(sq.begin(), sq.end());
+
+        double rowEnergy = 0.0;
+        for (Index j = 0; j < cols_; j ++) rowEnergy += sq[j].first;
+        totalEnergy += rowEnergy;
+
+        double maxDrop = relError * relError * rowEnergy, rowDrop = 0.0;
+        std::fill(drop.begin(), drop.end(), false);
+        for (Index j = 0; j < cols_ && rowDrop + sq[j].first <= maxDrop; j ++){
+            rowDrop += sq[j].first;
+            drop[sq[j].second] = true;
+        }
+        droppedEnergy += rowDrop;
+
+        for (Index j = 0; j < cols_; j ++){
+            if (!drop[j]){
+                colIdx_.push_back(j);
+                vals.push_back(row[j]);
+            }
+        }
+        rowPtr_[i + 1] = colIdx_.size();
+    }
+    vals_.resize(vals.size());
+    for (Index k = 0; k < vals.size(); k ++) vals_[k] = vals[k];
+
+    if (totalEnergy > 0.0) relError_ = std::sqrt(droppedEnergy / totalEnergy);
+
+    if (verbose_){
+        std::cout << "Compressed Jacobian: " << rows_ << "x" << cols_
+                  << " kept " << vals_.size() << " values ("
+                  << compressionRatio() * 100.0 << "%), relative error: "
+                  << relError_ << " (" << swatch.duration() << " s)" << std::endl;
+    }
+}
+
+RVector CompressedJacobian::mult(const RVector & a) const {
+    if (a.size() != cols_){
+        throwLengthError(EXIT_MATRIX_SIZE_INVALID, WHERE_AM_I + " " +
+                         str(a.size()) + " != " + str(cols_));
+    }
+    RVector ret(rows_);
+    for (Index i = 0; i < rows_; i ++){
+        double v = 0.0;
+        for (Index k = rowPtr_[i]; k < rowPtr_[i + 1]; k ++){
+            v += vals_[k] * a[colIdx_[k]];
+        }
+        ret[i] = v;
+    }
+    return ret;
+}
+
+RVector CompressedJacobian::transMult(const RVector & a) const {
+    if (a.size() != rows_){
+        throwLengthError(EXIT_MATRIX_SIZE_INVALID, WHERE_AM_I + " " +
+                         str(a.size()) + " != " + str(rows_));
+    }
+    RVector ret(cols_, 0.0);
+    for (Index i = 0; i < rows_; i ++){
+        double ai = a[i];
+        if (ai == 0.0) continue;
+        for (Index k = rowPtr_[i]; k < rowPtr_[i + 1]; k ++){
+            ret[colIdx_[k]] += vals_[k] * ai;
+        }
+    }
+    return ret;
+}
+
 void sensitivityDCFEMSingle(const std::vector < Cell * > & para, const RVector & p1, const RVector & p2,
 		       RVector & sens, bool verbose){
     uint nCells = para.size();
@@ -22,6 +22,7 @@
 #include "bert.h"
 
 #include <vector.h>
+#include <matrix.h>
 
 namespace GIMLI{
 
@@ -58,6 +59,110 @@ DLLEXPORT void createSensitivityCol(CMatrix & S,
                                     std::vector < std::pair < Index, Index > > & matrixClusterIds,
                                     uint nThreads, bool verbose);
 
+/*! Matrix free sensitivity matrix for DC resistivity.
+ * J * v and J^T * w are computed on the fly from the subpotentials
+ * and the element matrices of the parameter cells, so only
+ * O(nodes x electrodes) memory is needed instead of O(data x model).
+ * The entries are scaled with k/rho^2 like the dense matrix of
+ * \ref DCMultiElectrodeModelling::createJacobian. The subpotentials
+ * need to stay valid for the lifetime of this matrix. */
+class DLLEXPORT DCMatrixFreeJacobian : public MatrixBase {
+public:
+    DCMatrixFreeJacobian(const Mesh & mesh,
+                         const DataContainerERT & data,
+                         const RMatrix & pots,
+                         const RVector & weights,
+                         const RVector & k,
+                         const RVector & model,
+                         uint nThreads=1, bool verbose=false);
+
+    virtual ~DCMatrixFreeJacobian(){}
+
+    virtual Index rows() const { return nData_; }
+
+    virtual Index cols() const { return nModel_; }
+
+    /*! Return J * a */
+    virtual RVector mult(const RVector & a) const;
+
+    /*! Return J^T * a */
+    virtual RVector transMult(const RVector & a) const;
+
+    /*! Update the resistivity scaling 1/rho^2 for a new model. */
+    void setModel(const RVector & model);
+
+    /*! Return the row of the sensitivity matrix, for testing only. */
+    RVector row(Index i) const;
+
+protected:
+    const RMatrix           * pots_;
+    RVector                 weights_;
+    RVector                 k_;
+    uint                    nThreads_;
+
+    Index                   nData_;
+    Index                   nModel_;
+    Index                   nElecs_;
+
+    /*! Electrode indices a, b, m, n and geometric factors of the data */
+    std::vector < SIndex >  a_, b_, m_, n_;
+    RVector                 kFactor_;
+    RVector                 modelScale_;
+
+    /*! Element matrices of the parameter cells in one flat array.
+     * Cell c has cellNodes_[c] nodes starting at matOffset_[c] in ux_ and
+     * u2_ and at idxOffset_[c] in idx_. */
+    std::vector < Index >   cellMarker_;
+    std::vector < Index >   cellNodes_;
+    std::vector < Index >   idxOffset_;
+    std::vector < Index >   matOffset_;
+    IndexArray              idx_;
+    RVector                 ux_;
+    RVector                 u2_;
+};
+
+/*! Row wise sparsified copy of a dense sensitivity matrix.
+ * For each datum the smallest entries are dropped as long as their energy
+ * stays below relError^2 of the row energy, i.e., the threshold adapts to
+ * the decay of each sensitivity row. The kept entries are stored in
+ * compressed row format for fast mult and transMult. */
+class DLLEXPORT CompressedJacobian : public MatrixBase {
+public:
+    CompressedJacobian(const RMatrix & J, double relError=1e-3,
+                       bool verbose=false);
+
+    virtual ~CompressedJacobian(){}
+
+    virtual Index rows() const { return rows_; }
+
+    virtual Index cols() const { return cols_; }
+
+    /*! Return J * a */
+    virtual RVector mult(const RVector & a) const;
+
+    /*! Return J^T * a */
+    virtual RVector transMult(const RVector & a) const;
+
+    /*! Return the number of stored values. */
+    inline Index nVals() const { return vals_.size(); }
+
+    /*! Return the ratio of stored values to rows * cols. */
+    inline double compressionRatio() const {
+        return (double)vals_.size() / ((double)rows_ * cols_);
+    }
+
+    /*! Return the relative Frobenius norm of the dropped entries. */
+    inline double relativeError() const { return relError_; }
+
+protected:
+    Index                   rows_;
+    Index                   cols_;
+    std::vector < Index >   rowPtr_;
+    std::vector < Index >   colIdx_;
+    RVector                 vals_;
+    double                  relError_;
+};
+
 DLLEXPORT void sensitivityDCFEMSingle(const std::vector < Cell * > & para,
                                       const RVector & p1, const RVector & p2,
                                       RVector & sens, bool verbose);
@@ -37,6 +37,7 @@
 #include <regionManager.h>
 #include <shape.h>
 #include <sparsematrix.h>
+#include <spatialindex.h>
 #include <stopwatch.h>
 #include <vectortemplates.h>
 
@@ -168,6 +169,16 @@ void dcfemDomainAssembleStiffnessMatrix(SparseMatrix < ValueType > & S, const Me
     if (!S.valid()) S.buildSparsityPattern(mesh);
 
     ElementMatrix < double > Se, Stmp;
+    ElementKernel< 3 > K3;
+    ElementKernel< 4 > K4;
+    ElementKernel< 6 > K6;
+    ElementKernel< 8 > K8;
+    //** stiffness of the other cells, cached for static meshes since it
+    //** is the same for all wavenumbers and forward runs
+    const CellGradientCache * gradCache = 0;
+    bool gradCacheChecked = false;
+    double k2 = 0.0;
+    if (k > 0.0) k2 = k * k;
 
     if (atts.size() != mesh.cellCount()){
        throwLengthError(1, WHERE_AM_I + " attribute size missmatch" + toStr(atts.size())
@@ -181,22 +192,39 @@ void dcfemDomainAssembleStiffnessMatrix(SparseMatrix < ValueType > & S, const Me
         rho = atts[mesh.cell(i).id()];
         //** rho == 0.0 may happen while secondary field assemblation
         if (GIMLI::abs(rho) > TOLERANCE){
-            if (k > 0.0){
-//             Stmp = Se.u2(mesh.cell(i));
-//             Stmp *= k * k;
-//             Stmp += Se.ux2uy2uz2(mesh.cell(i));
-
-                Stopwatch s(true);
-                Se.u2(mesh.cell(i));
-                sCount += s.cycleCounter().toc();
-
-                Se *= k * k;
-                Se += Stmp.ux2uy2uz2(mesh.cell(i));
-
-            } else {
-                Se.ux2uy2uz2(mesh.cell(i));
+            //** linear cells without heap traffic
+            const Cell & c = mesh.cell(i);
+            bool done = false;
+            switch (c.nodeCount()){
+                case 3: if ((done = elementKernel(c, k2, K3))) S.add(K3, 1./rho); break;
+                case 4: if ((done = elementKernel(c, k2, K4))) S.add(K4, 1./rho); break;
+                case 6: if ((done = elementKernel(c, k2, K6))) S.add(K6, 1./rho); break;
+                case 8: if ((done = elementKernel(c, k2, K8))) S.add(K8, 1./rho); break;
+                default: break;
+            }
+            if (!done){
+                if (!gradCacheChecked){
+                    gradCacheChecked = true;
+                    bool contiguous = mesh.staticGeometry();
+                    for (Index j = 0; j < mesh.cellCount() && contiguous; j ++){
+                        contiguous = (Index(mesh.cell(j).id()) == j);
+                    }
+                    if (contiguous) gradCache = &mesh.cellGradientCache();
+                }
+                if (k > 0.0){
+                    Stopwatch s(true);
+                    Se.u2(c);
+                    sCount += s.cycleCounter().toc();
+
+                    Se *= k * k;
+                    if (gradCache) Se += Stmp.ux2uy2uz2(c, *gradCache);
+                    else Se += Stmp.ux2uy2uz2(c);
+                } else {
+                    if (gradCache) Se.ux2uy2uz2(c, *gradCache);
+                    else Se.ux2uy2uz2(c);
+                }
+                S.add(Se, 1./rho);
             }
-            S.add(Se, 1./rho);
 //             Se *= 1.0 / rho;
 //             S += Se;
         } else {
@@ -227,6 +255,11 @@ void dcfemDomainAssembleStiffnessMatrix(SparseMatrix < ValueType > & S, const Me
     }
 }
 
+void dcfemDomainAssembleStiffnessMatrix(RSparseMatrix & S, const Mesh & mesh,
+                                        const RVector & atts,
+                                        double k, bool fix){
+    dcfemDomainAssembleStiffnessMatrix< double >(S, mesh, atts, k, fix);
+}
 void dcfemDomainAssembleStiffnessMatrix(RSparseMatrix & S, const Mesh & mesh,
                                         double k, bool fix){
     dcfemDomainAssembleStiffnessMatrix(S, mesh, mesh.cellAttributes(), k, fix);
@@ -297,6 +330,13 @@ void dcfemBoundaryAssembleStiffnessMatrix(SparseMatrix < ValueType > & S,
     assembleStiffnessMatrixHomogenDirichletBC(S, vecHomDirNodes);
 }
 
+void dcfemBoundaryAssembleStiffnessMatrix(RSparseMatrix & S, const Mesh & mesh,
+                                          const RVector & atts,
+                                          const RVector3 & source,
+                                          double k){
+    dcfemBoundaryAssembleStiffnessMatrix< double >(S, mesh, atts, source, k);
+}
+
 void dcfemBoundaryAssembleStiffnessMatrix(RSparseMatrix & S, const Mesh & mesh,
                                           const RVector3 & source,
                                           double k){
@@ -550,6 +590,8 @@ void DCMultiElectrodeModelling::init_(){
 
     electrodeRef_        = NULL;
     JIsRMatrix_          = true;
+    matrixFreeJacobian_  = false;
+    jacobianCompression_ = 0.0;
 
     buildCompleteElectrodeModel_    = false;
     dipoleCurrentPattern_           = false;
@@ -583,7 +625,7 @@ void DCMultiElectrodeModelling::assembleStiffnessMatrixDCFEMByPass(CSparseMatrix
 }
 
 template < class ValueType >
-void DCMultiElectrodeModelling::assembleStiffnessMatrixDCFEMByPass_(SparseMatrix < ValueType > & _S){
+void DCMultiElectrodeModelling::assembleStiffnessMatrixDCFEMByPass_(SparseMatrix < ValueType > & _S) const {
 
     std::vector < std::pair< Index, Index> > byPassPair;
     std::vector < std::pair< Index, Index> > byPassNodesPair;
@@ -850,6 +892,14 @@ void DCMultiElectrodeModelling::searchElectrodes_(){
             }
         }
 
+        //** search tree over the node-electrodes, ids are the index in sourceIdx
+        R3Vector sourcePos(sourceIdx.size());
+        for (Index j = 0; j < sourceIdx.size(); j ++){
+            sourcePos[j] = mesh_->node(sourceIdx[j]).pos();
+        }
+        SpatialIndex sourceTree(sourcePos);
+        std::vector< bool > sourceUsed(sourceIdx.size(), false);
+
         for (uint i = 0; i < ePos.size(); i ++){
             bool match = false;
             //** match the known CEM-electrodes
@@ -891,13 +941,13 @@ void DCMultiElectrodeModelling::searchElectrodes_(){
 
             //** match the known node-electrodes
             if (!match){
-                for (std::vector< Index >::iterator it = sourceIdx.begin(); it != sourceIdx.end(); it ++){
-//                     std::cout << ePos[i] << " " << mesh_->node(*it).pos() <<
-//                             " " << ePos[i].dist(mesh_->node(*it).pos()) << std::endl;
-                    if (ePos[i].dist(mesh_->node(*it).pos()) < 0.01){ //CR 1cm?? really??
-                        electrodes_.push_back(new ElectrodeShapeNode(mesh_->node(*it)));
+                IndexArray candidates(sourceTree.radius(ePos[i], 0.01)); //CR 1cm?? really??
+                for (Index j = 0; j < candidates.size(); j ++){
+                    Index k = candidates[j];
+                    if (!sourceUsed[k] && ePos[i].dist(sourcePos[k]) < 0.01){
+                        electrodes_.push_back(new ElectrodeShapeNode(mesh_->node(sourceIdx[k])));
                         electrodes_.back()->setId(i);
-                        sourceIdx.erase(it);
+                        sourceUsed[k] = true;
                         nodeECounter++;
                         match = true;
                         break;
@@ -1192,6 +1242,72 @@ void DCMultiElectrodeModelling::mapERTModel(const RVector & model,
     }
 }
 
+void DCMultiElectrodeModelling::prepareResponse_mt(){
+    ModellingBase::prepareResponse_mt();
+    this->searchElectrodes_();
+
+    if (dataContainer_ && !dataContainer_->allNonZero("k")){
+        if (this->topography() || buildCompleteElectrodeModel_){
+            throwError(1, WHERE_AM_I + " data contains no K-factors ");
+        }
+        dataContainer_->set("k", this->calcGeometricFactor(this->dataContainer()));
+    }
+}
+
+RVector DCMultiElectrodeModelling::response_mt(const RVector & model,
+                                               Index i) const {
+    if (complex_ || dipoleCurrentPattern_ || buildCompleteElectrodeModel_){
+        throwError(1, WHERE_AM_I + " read only response is not supported for "
+                   "complex resistivity, dipole current pattern or cem.");
+    }
+    if (!dataContainer_){
+        throwError(1, WHERE_AM_I + " no response without data container");
+    }
+    if (electrodes_.size() == 0){
+        throwError(1, WHERE_AM_I + " no electrodes known. "
+                   "Call prepareResponse_mt() first.");
+    }
+    if (!dataContainer_->allNonZero("k")){
+        throwError(1, WHERE_AM_I + " data contains no K-factors. "
+                   "Call prepareResponse_mt() first.");
+    }
+    if (min(model) < TOLERANCE) {
+        throwError(EXIT_FEM_NO_RHO, WHERE_AM_I + " response for model with "
+                   "negative or zero resistivity is not defined.");
+    }
+
+    RVector atts(createMappedModel(model, -1.0));
+
+    std::vector < ElectrodeShape * > eA, eB;
+    createPolCurrentPattern_(eA, eB);
+    Index nCurrentPattern = eA.size();
+
+    RMatrix subSolutions(nCurrentPattern * kValues_.size(), mesh_->nodeCount());
+    RMatrix solutions(nCurrentPattern, mesh_->nodeCount());
+
+    for (Index kIdx = 0; kIdx < kValues_.size(); kIdx ++){
+        if (analytical_){
+            calculateKAnalyt(eA, eB, subSolutions, kValues_[kIdx], kIdx);
+        } else {
+            calculateK_mt(eA, eB, atts, subSolutions, kIdx);
+        }
+        for (Index j = 0; j < nCurrentPattern; j ++) {
+            solutions[j] += subSolutions[j + kIdx * nCurrentPattern] * weights_[kIdx];
+        }
+    }
+
+    DataMap dMap;
+    dMap.collect(electrodes_, solutions);
+
+    RVector resp(dMap.data(this->dataContainer()));
+    RVector respRez(dMap.data(this->dataContainer(), true));
+
+    resp    *= dataContainer_->get("k");
+    respRez *= dataContainer_->get("k");
+
+    return sqrt(abs(resp * respRez));
+}
+
 template < class ValueType >
 DataMap DCMultiElectrodeModelling::response_(const Vector < ValueType > & model,
                                              ValueType background){
@@ -1404,6 +1520,13 @@ void DCMultiElectrodeModelling::createJacobian(const RVector & model){
         THROW_TO_IMPL
 
 
+    } else if (matrixFreeJacobian_){
+        RMatrix * u = prepareJacobianT_(model);
+        delete jacobian_;
+        jacobian_ = new DCMatrixFreeJacobian(*mesh_, this->dataContainer(), *u,
+                                             weights_, kValues_, model,
+                                             nThreads_, verbose_);
+        JIsRMatrix_ = false;
     } else {
         RMatrix * u = prepareJacobianT_(model);
         if (!JIsRMatrix_){
@@ -1414,6 +1537,15 @@ void DCMultiElectrodeModelling::createJacobian(const RVector & model){
 
         RMatrix * J = dynamic_cast< RMatrix * >(jacobian_);
         createJacobian_(model, *u, J);
+
+        J = dynamic_cast< RMatrix * >(jacobian_);
+        if (jacobianCompression_ > 0.0 && J){
+            MatrixBase * Jc = new CompressedJacobian(*J, jacobianCompression_,
+                                                     verbose_);
+            delete jacobian_;
+            jacobian_ = Jc;
+            JIsRMatrix_ = false;
+        }
     }
 }
 
@@ -1456,12 +1588,16 @@ void DCMultiElectrodeModelling::createCurrentPattern(std::vector < ElectrodeShap
             std::cerr << WHERE_AM_I << " no data structure given" << std::endl;
         }
     } else { // simple pol or dipole with reference node
+        createPolCurrentPattern_(eA, eB);
+    }
+}
 
-        for (int i = 0; i < nElecs; i ++){
-            if (electrodes_[i] != electrodeRef_ && electrodes_[i]->id() > -1){
-                eA.push_back(electrodes_[i]);
-                eB.push_back(electrodeRef_);
-            }
+void DCMultiElectrodeModelling::createPolCurrentPattern_(std::vector < ElectrodeShape * > & eA,
+                                                         std::vector < ElectrodeShape * > & eB) const {
+    for (Index i = 0; i < electrodes_.size(); i ++){
+        if (electrodes_[i] != electrodeRef_ && electrodes_[i]->id() > -1){
+            eA.push_back(electrodes_[i]);
+            eB.push_back(electrodeRef_);
         }
     }
 }
@@ -1861,12 +1997,56 @@ void DCMultiElectrodeModelling::calculateK(const std::vector < ElectrodeShape *
     calculateK_(eA, eB, solutionK, kIdx);
 }
 
+void DCMultiElectrodeModelling::calculateK_mt(const std::vector < ElectrodeShape * > & eA,
+                                              const std::vector < ElectrodeShape * > & eB,
+                                              const RVector & atts,
+                                              RMatrix & solutionK, int kIdx) const {
+    uint nCurrentPattern = eA.size();
+    double k = kValues_[kIdx];
+
+    if (solutionK.rows() < (kIdx + 1) * nCurrentPattern) {
+        throwLengthError(1, WHERE_AM_I + " workspace size insufficient" + toStr(solutionK.rows())
+            + " " + toStr((kIdx + 1) * nCurrentPattern));
+    }
+
+    RSparseMatrix S;
+    S.buildSparsityPattern(*mesh_);
+
+    dcfemDomainAssembleStiffnessMatrix(S, *mesh_, atts, k);
+    dcfemBoundaryAssembleStiffnessMatrix(S, *mesh_, atts, sourceCenterPos_, k);
+
+    this->assembleStiffnessMatrixDCFEMByPass_(S);
+    assembleStiffnessMatrixHomogenDirichletBC(S, calibrationSourceIdx_);
+
+    LinSolver solver(false);
+    solver.setMatrix(S, 1);
+
+    RVector rhs(S.rows());
+    RVector sol(S.cols());
+
+    for (uint i = 0; i < nCurrentPattern; i ++){
+        rhs *= 0.0;
+        if (eA[i]) eA[i]->assembleRHS(rhs,  1.0, mesh_->nodeCount());
+        if (eB[i]) eB[i]->assembleRHS(rhs, -1.0, mesh_->nodeCount());
+
+        solver.solve(rhs, sol);
+        solutionK[i + kIdx * nCurrentPattern] = sol;
+    }
+}
+
 void DCMultiElectrodeModelling::calculateK(const std::vector < ElectrodeShape * > & eA,
                                            const std::vector < ElectrodeShape * > & eB,
                                            CMatrix & solutionK, int kIdx){
     calculateK_(eA, eB, solutionK, kIdx);
 }
 
+RVector DCSRMultiElectrodeModelling::response_mt(const RVector & model,
+                                                 Index i) const {
+    throwError(1, WHERE_AM_I + " read only response is not supported "
+               "with singularity removal.");
+    return RVector(0);
+}
+
 void DCSRMultiElectrodeModelling::updateMeshDependency_(){
     DCMultiElectrodeModelling::updateMeshDependency_();
     if (primMeshOwner_ && primMesh_) delete primMesh_;
@@ -38,6 +38,18 @@ DLLEXPORT void dcfemDomainAssembleStiffnessMatrix(RSparseMatrix & S, const Mesh
 DLLEXPORT void dcfemDomainAssembleStiffnessMatrix(CSparseMatrix & S, const Mesh & mesh,
                                                   double k=0.0, bool fix=true);
 
+/*! Read only variant using the resistivity per cell from atts instead
+ * of the cell attributes, e.g., from \ref ModellingBase::createMappedModel. */
+DLLEXPORT void dcfemDomainAssembleStiffnessMatrix(RSparseMatrix & S, const Mesh & mesh,
+                                                  const RVector & atts,
+                                                  double k=0.0, bool fix=true);
+
+/*! Assemble the boundary conditions using the resistivity per cell from atts. */
+DLLEXPORT void dcfemBoundaryAssembleStiffnessMatrix(RSparseMatrix & S, const Mesh & mesh,
+                                                    const RVector & atts,
+                                                    const RVector3 & source,
+                                                    double k=0.0);
+
 // DLLEXPORT void assembleStiffnessMatrixHomogenDirichletBC(RSparseMatrix & S,
 //                                                          const IndexArray & nodeID);
 
@@ -166,6 +178,17 @@ public:
      * Either cell based or marker based. See \ref mapERTModel */
     RVector response(const RVector & model, double background);
 
+    /*! Read only response for multi threading purposes.
+     * Neither the mesh nor the potentials of this operator are touched,
+     * the model is mapped by \ref createMappedModel.
+     * Complex resistivities, dipole current pattern and the
+     * complete electrode model are not supported.
+     * Call \ref prepareResponse_mt once before. */
+    virtual RVector response_mt(const RVector & model, Index i=0) const;
+
+    /*! Search the electrodes and ensure geometric factors. */
+    virtual void prepareResponse_mt();
+
     void createCurrentPattern(std::vector < ElectrodeShape * > & eA,
                               std::vector < ElectrodeShape * > & eB,
                               bool reciprocity);
@@ -185,6 +208,13 @@ public:
                             const std::vector < ElectrodeShape * > & eB,
                             CMatrix & solutionK, int kIdx);
 
+    /*! Read only variant of calculateK for multi threading purposes.
+     * The resistivity per cell is taken from atts. */
+    void calculateK_mt(const std::vector < ElectrodeShape * > & eA,
+                       const std::vector < ElectrodeShape * > & eB,
+                       const RVector & atts,
+                       RMatrix & solutionK, int kIdx) const;
+
     template < class ValueType >
     void calculateKAnalyt(const std::vector < ElectrodeShape * > & eA,
                           const std::vector < ElectrodeShape * > & eB,
@@ -216,6 +246,17 @@ public:
     inline void setAnalytical(bool ana){ analytical_=ana; }
     inline bool analytical() const { return analytical_; }
 
+    /*! Use a matrix free Jacobian (\ref DCMatrixFreeJacobian) instead of
+     * the dense sensitivity matrix. Only the subpotentials are stored, J * v
+     * and J^T * w are calculated on demand. Not for complex resistivity. */
+    inline void setMatrixFreeJacobian(bool mf){ matrixFreeJacobian_=mf; }
+    inline bool matrixFreeJacobian() const { return matrixFreeJacobian_; }
+
+    /*! Store the Jacobian compressed (\ref CompressedJacobian) with the
+     * given relative error per datum. 0 means dense matrix [default]. */
+    inline void setJacobianCompression(double relError){ jacobianCompression_=relError; }
+    inline double jacobianCompression() const { return jacobianCompression_; }
+
     void collectSubPotentials(RMatrix & subSolutions){
         subSolutions_=& subSolutions;
     }
@@ -270,7 +311,11 @@ protected:
                      Matrix < ValueType > & solutionK, int kIdx);
 
     template < class ValueType >
-    void assembleStiffnessMatrixDCFEMByPass_(SparseMatrix < ValueType > & S);
+    void assembleStiffnessMatrixDCFEMByPass_(SparseMatrix < ValueType > & S) const;
+
+    /*! Pol current pattern for all electrodes against the reference. */
+    void createPolCurrentPattern_(std::vector < ElectrodeShape * > & eA,
+                                  std::vector < ElectrodeShape * > & eB) const;
 
     template < class ValueType >
     DataMap response_(const Vector < ValueType > & model,
@@ -296,6 +341,8 @@ protected:
     bool complex_;
 
     bool JIsRMatrix_;
+    bool matrixFreeJacobian_;
+    double jacobianCompression_;
 
     bool analytical_;
     bool topography_;
@@ -357,6 +404,10 @@ public:
                             const std::vector < ElectrodeShape * > & eB,
                             RMatrix & solutionK, int kIdx);
 
+    /*! The read only response of \ref DCMultiElectrodeModelling has no
+     * singularity removal, so it is not available here and throws. */
+    virtual RVector response_mt(const RVector & model, Index i=0) const;
+
     inline void setPrimaryPotFileBody(const std::string & primPotFileBody){
         primPotFileBody_=primPotFileBody;
     }
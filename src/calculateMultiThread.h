@@ -56,6 +56,20 @@ protected:
     Index threadNumber_;
 };
 
+/*! Run a copy of calc as worker thread. */
+template < class T > class WorkerThread__{
+public:
+    WorkerThread__(const T & calc) : calc_(calc){ }
+
+    void operator () () {
+        setWorkerThread(true);
+        calc_();
+    }
+
+protected:
+    T calc_;
+};
+
 template < class T > void distributeCalc(T calc, uint nCalcs, uint nThreads, bool verbose=false){
     if (nThreads == 1){
         calc.setRange(0, nCalcs);
@@ -66,8 +80,8 @@ template < class T > void distributeCalc(T calc, uint nCalcs, uint nThreads, boo
         std::vector < T > calcObjs;
         for (uint i = 0; i < nThreads; i ++){
             calcObjs.push_back(calc);
-            Index start = singleCalcCount * i;
-            Index end   = singleCalcCount * (i + 1);
+            Index start = min(singleCalcCount * i, nCalcs);
+            Index end   = min(singleCalcCount * (i + 1), nCalcs);
             if (i == nThreads -1) end = nCalcs;
             if (debug()) std::cout << "Threaded calculation: " << i << ": " << start <<" " << end << std::endl;
             calcObjs.back().setRange(start, end, i);
@@ -76,7 +90,7 @@ template < class T > void distributeCalc(T calc, uint nCalcs, uint nThreads, boo
         boost::thread_group threads;
         for (uint i = 0; i < nThreads; i++) {
             if (debug()) std::cout << "start thread: " << i << std::endl;
-            threads.create_thread(calcObjs[i]);
+            threads.create_thread(WorkerThread__< T >(calcObjs[i]));
         }
         threads.join_all();
 #else
@@ -85,7 +99,7 @@ template < class T > void distributeCalc(T calc, uint nCalcs, uint nThreads, boo
 
         for (uint i = 0; i < nThreads; i++) {
             if (debug()) std::cout << "start thread: " << i << std::endl;
-            threads.emplace_back(calcObjs[i]);
+            threads.emplace_back(WorkerThread__< T >(calcObjs[i]));
         }
 
         for (auto & th : threads) if (th.joinable()) th.join();
@@ -20,7 +20,9 @@
 
 #include "pos.h"
 
+#include "calculateMultiThread.h"
 #include "regionManager.h"
+#include "stopwatch.h"
 #include "vectortemplates.h"
 
 namespace GIMLI {
@@ -141,6 +143,16 @@ void HarmonicModelling::createJacobian(const RVector & model) {
     }
 }
 
+RMatrix HarmonicModelling::designMatrix() const {
+    RMatrix G(nt_, np_);
+    for (size_t i = 0 ; i < np_ ; i++){
+        for (size_t j = 0 ; j < nt_ ; j++){
+            G[j][i] = A_[i][j];
+        }
+    }
+    return G;
+}
+
 PolynomialModelling::PolynomialModelling(uint dim, uint nCoeffizient,
                                           const std::vector < RVector3 > & referencePoints, const RVector & startModel)
     : dim_(dim), referencePoints_(referencePoints), f_(PolynomialFunction < double >(nCoeffizient)) {
@@ -182,4 +194,164 @@ RVector PolynomialModelling::startModel(){
     return p;
 }
 
+RMatrix PolynomialModelling::designMatrix(){
+    RVector p(this->startModel());
+    Index n = f_.size();
+    RMatrix G(referencePoints_.size(), p.size());
+
+    for (Index l = 0; l < referencePoints_.size(); l ++){
+        const RVector3 & xyz = referencePoints_[l];
+        for (Index k = 0; k < n; k ++){
+            for (Index j = 0; j < n; j ++){
+                for (Index i = 0; i < n; i ++){
+                    Index c = k * (n * n) + j * n + i;
+                    if (::fabs(p[c]) > TOLERANCE){
+                        G[l][c] = powInt(xyz[0], i) * powInt(xyz[1], j) * powInt(xyz[2], k);
+                    }
+                }
+            }
+        }
+    }
+    return G;
+}
+
+class LinearCurveFitMT : public BaseCalcMT {
+public:
+    LinearCurveFitMT(const LinearCurveFitter & fitter, const RMatrix & data,
+                     RMatrix & coeff, bool verbose)
+    : BaseCalcMT(1, verbose), fitter_(&fitter), data_(&data), coeff_(&coeff){ }
+
+    virtual ~LinearCurveFitMT(){}
+
+    virtual void calc(Index tNr=0){
+        fitter_->fit(*data_, *coeff_, start_, end_);
+    }
+
+protected:
+    const LinearCurveFitter * fitter_;
+    const RMatrix           * data_;
+    RMatrix                 * coeff_;
+};
+
+LinearCurveFitter::LinearCurveFitter(const RMatrix & G, double lambda, bool verbose)
+    : G_(G), lambda_(lambda), verbose_(verbose), nDropped_(0){
+
+    Stopwatch swatch(true);
+    nt_ = G_.rows();
+    np_ = G_.cols();
+
+    //** normal equations G^T G + lambda I, lower triangle
+    L_.assign(np_ * np_, 0.0);
+    for (Index t = 0; t < nt_; t ++){
+        const RVector & g = G_[t];
+        for (Index i = 0; i < np_; i ++){
+            double gi = g[i];
+            if (gi == 0.0) continue;
+            for (Index j = 0; j <= i; j ++) L_[i * np_ + j] += gi * g[j];
+        }
+    }
+    for (Index i = 0; i < np_; i ++) L_[i * np_ + i] += lambda_;
+
+    //** Cholesky L L^T, dependent or empty columns are dropped.
+    //** The pivot is compared with the diagonal of its own column,
+    //** so the decision is independent of the column scaling.
+    dropped_.assign(np_, false);
+    for (Index j = 0; j < np_; j ++){
+        double * Lj = &L_[j * np_];
+        double d = Lj[j];
+        double tol = d * 1e-12;
+        for (Index k = 0; k < j; k ++) d -= Lj[k] * Lj[k];
+        if (d <= tol){
+            dropped_[j] = true;
+            nDropped_ ++;
+            for (Index k = 0; k <= j; k ++) Lj[k] = 0.0;
+            for (Index i = j + 1; i < np_; i ++) L_[i * np_ + j] = 0.0;
+            continue;
+        }
+        Lj[j] = std::sqrt(d);
+        for (Index i = j + 1; i < np_; i ++){
+            double * Li = &L_[i * np_];
+            double v = Li[j];
+            for (Index k = 0; k < j; k ++) v -= Li[k] * Lj[k];
+            Li[j] = v / Lj[j];
+        }
+    }
+
+    if (verbose_) std::cout << "LinearCurveFitter: " << nt_ << " x " << np_
+                            << " lambda = " << lambda_ << " dropped: " << nDropped_
+                            << " (" << swatch.duration(true) << " s)" << std::endl;
+}
+
+void LinearCurveFitter::solve_(double * b) const {
+    for (Index j = 0; j < np_; j ++){
+        if (dropped_[j]) { b[j] = 0.0; continue; }
+        const double * Lj = &L_[j * np_];
+        double v = b[j];
+        for (Index k = 0; k < j; k ++) v -= Lj[k] * b[k];
+        b[j] = v / Lj[j];
+    }
+    for (SIndex j = np_ - 1; j >= 0; j --){
+        if (dropped_[j]) continue;
+        double v = b[j];
+        for (Index i = j + 1; i < np_; i ++) v -= L_[i * np_ + j] * b[i];
+        b[j] = v / L_[j * np_ + j];
+    }
+}
+
+void LinearCurveFitter::fit(const RMatrix & data, RMatrix & coeff,
+                            Index start, Index end) const {
+    std::vector < double > b(np_);
+    for (Index s = start; s < end; s ++){
+        const RVector & d = data[s];
+        std::fill(b.begin(), b.end(), 0.0);
+        for (Index t = 0; t < nt_; t ++){
+            double dt = d[t];
+            const RVector & g = G_[t];
+            for (Index i = 0; i < np_; i ++) b[i] += dt * g[i];
+        }
+        solve_(&b[0]);
+        RVector & c = coeff[s];
+        for (Index i = 0; i < np_; i ++) c[i] = b[i];
+    }
+}
+
+RMatrix LinearCurveFitter::fit(const RMatrix & data, Index nThreads) const {
+    if (data.cols() != nt_){
+        throwLengthError(1, WHERE_AM_I + " data.cols() != nt " +
+                         str(data.cols()) + " " + str(nt_));
+    }
+    RMatrix coeff(data.rows(), np_);
+    if (nThreads == 0) nThreads = numberOfCPU();
+    nThreads = max(1, (int)min(nThreads, data.rows()));
+
+    Stopwatch swatch(true);
+    distributeCalc(LinearCurveFitMT(*this, data, coeff, verbose_),
+                   data.rows(), nThreads, verbose_);
+    if (verbose_) std::cout << "LinearCurveFitter: fitted " << data.rows()
+                            << " series (" << swatch.duration(true) << " s)" << std::endl;
+    return coeff;
+}
+
+RVector LinearCurveFitter::fit(const RVector & data) const {
+    if (data.size() != nt_){
+        throwLengthError(1, WHERE_AM_I + " data.size() != nt " +
+                         str(data.size()) + " " + str(nt_));
+    }
+    RMatrix d(1, data.size());
+    d[0] = data;
+    RMatrix coeff(1, np_);
+    fit(d, coeff, 0, 1);
+    return coeff[0];
+}
+
+RMatrix LinearCurveFitter::response(const RMatrix & coeff) const {
+    if (coeff.cols() != np_){
+        throwLengthError(1, WHERE_AM_I + " coeff.cols() != np " +
+                         str(coeff.cols()) + " " + str(np_));
+    }
+    RMatrix ret(coeff.rows(), nt_);
+    for (Index s = 0; s < coeff.rows(); s ++) ret[s] = G_ * coeff[s];
+    return ret;
+}
+
 } // namespace GIMLI{
@@ -102,6 +102,9 @@ public:
     /*! Define the start model */
     inline virtual RVector startModel(){ return RVector(np_, 0.0); }
 
+    /*! Return the design matrix (nt x np), i.e., the Jacobian. */
+    RMatrix designMatrix() const;
+
 protected:
 
     RVector t_; //! abscissa vector x
@@ -141,6 +144,11 @@ public:
 
     void setPowCombinationTmp(int i) { powCombination_ = i; }
 
+    /*! Return the design matrix (nPoints x nCoeffizient^3) for the reference
+     * points. Columns of coefficients with zero start model, e.g., outside
+     * the Pascal's triangle, are zero and not fitted by \ref LinearCurveFitter. */
+    RMatrix designMatrix();
+
 protected:
     uint dim_;
     std::vector < RVector3 > referencePoints_;
@@ -152,6 +160,54 @@ protected:
     uint powCombination_;
 };
 
+//! Batched linear least squares fit of many series on a shared abscissa.
+/*! Batched linear least squares fit of many series sharing one design
+ * matrix G (nt x np), e.g., \ref HarmonicModelling::designMatrix for many
+ * monitoring channels. The regularized normal equations
+ * \f$ (G^T G + \lambda I) p = G^T d \f$ are Cholesky factorized once and
+ * every series costs a projection and two triangular solves. Coefficients
+ * without information (zero pivot) are set to zero. */
+class DLLEXPORT LinearCurveFitter {
+public:
+    LinearCurveFitter(const RMatrix & G, double lambda=0.0, bool verbose=false);
+
+    virtual ~LinearCurveFitter(){ }
+
+    /*! Return coefficients (nSeries x np) for all rows of data (nSeries x nt),
+     * distributed over nThreads (0 = number of CPUs). */
+    RMatrix fit(const RMatrix & data, Index nThreads=0) const;
+
+    /*! Return coefficients for one series. */
+    RVector fit(const RVector & data) const;
+
+    /*! Fit the rows [start, end) of data into the same rows of coeff. */
+    void fit(const RMatrix & data, RMatrix & coeff, Index start, Index end) const;
+
+    /*! Return G * coeff[i] for all rows of coeff (nSeries x np). */
+    RMatrix response(const RMatrix & coeff) const;
+
+    inline const RMatrix & designMatrix() const { return G_; }
+
+    inline double lambda() const { return lambda_; }
+
+    /*! Return the number of coefficients dropped due to zero pivot. */
+    inline Index rankDefect() const { return nDropped_; }
+
+protected:
+    /*! Solve (L L^T) x = b in place. */
+    void solve_(double * b) const;
+
+    RMatrix G_;
+    double lambda_;
+    bool verbose_;
+    Index nt_, np_;
+    Index nDropped_;
+
+    //! lower triangle Cholesky factor, row major np x np
+    std::vector < double > L_;
+    std::vector < bool > dropped_;
+};
+
 } // namespace GIMLI{
 
 #endif // _GIMLI_CURVEFITTING__H
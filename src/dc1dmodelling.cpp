@@ -21,6 +21,9 @@
 #include "datacontainer.h"
 #include "dc1dmodelling.h"
 #include "meshgenerators.h"
+#include "calculateMultiThread.h"
+
+#include <algorithm>
 
 namespace GIMLI {
 
@@ -95,6 +98,62 @@ RVector DC1dModelling::response(const RVector & model) {
     return rhoa(rho, thk);
 }
 
+/*! Kernel of the DC 1D Hankel transform and, if dK is given, its derivatives
+ * for one wave number lam and nR soundings. Thicknesses and resistivities of
+ * layer i for sounding s are thk[i * stride + s] and rho[i * stride + s].
+ * K and z are of size nR, dK of size (2 * nL - 1) * nR ordered by parameter.
+ * Differentiation of the recursion in kern1d. Needs nL > 1. */
+static void kern1dDeriv_(double lam, Index nL,
+                         const double * thk, const double * rho,
+                         Index stride, Index nR,
+                         double * z, double * K, double * dK){
+    Index nPar = 2 * nL - 1;
+
+    for (Index s = 0; s < nR; s ++) z[s] = rho[(nL - 1) * stride + s];
+    if (dK) {
+        std::fill(dK, dK + nPar * nR, 0.0);
+        for (Index s = 0; s < nR; s ++) dK[(nPar - 1) * nR + s] = 1.0;
+    }
+
+    for (Index i = nL - 2; i > 0; i --){
+        for (Index s = 0; s < nR; s ++){
+            double r = rho[i * stride + s];
+            double t = std::tanh(lam * thk[i * stride + s]);
+            double N = z[s] + t * r;
+            double D = z[s] * t + r;
+            if (dK){
+                double dzdz = r * r * (1.0 - t * t) / (D * D);
+                for (Index p = i + 1; p < nL - 1; p ++) dK[p * nR + s] *= dzdz;
+                for (Index p = nL + i; p < nPar; p ++) dK[p * nR + s] *= dzdz;
+                dK[i * nR + s] = r * (r * r - z[s] * z[s]) / (D * D)
+                                 * lam * (1.0 - t * t);
+                dK[(nL - 1 + i) * nR + s] = (N + r * t) / D - r * N / (D * D);
+            }
+            z[s] = r * N / D;
+        }
+    }
+
+    for (Index s = 0; s < nR; s ++){
+        double r0 = rho[s];
+        double p = (z[s] - r0) / (z[s] + r0);
+        double e = std::exp(-2.0 * lam * thk[s]);
+        double ehl = p * e;
+        K[s] = ehl / (1.0 - ehl) * r0 / 2.0 / PI;
+
+        if (dK){
+            double dKdehl = r0 / 2.0 / PI / ((1.0 - ehl) * (1.0 - ehl));
+            double dpdz = 2.0 * r0 / ((z[s] + r0) * (z[s] + r0));
+            double c = dKdehl * e * dpdz;
+            for (Index q = 1; q < nL - 1; q ++) dK[q * nR + s] *= c;
+            for (Index q = nL; q < nPar; q ++) dK[q * nR + s] *= c;
+            dK[s] = dKdehl * (-2.0 * lam * ehl);
+            dK[(nL - 1) * nR + s] = dKdehl * e *
+                    (-2.0 * z[s] / ((z[s] + r0) * (z[s] + r0)))
+                    + ehl / (1.0 - ehl) / 2.0 / PI;
+        }
+    }
+}
+
 RVector DC1dModelling::rhoa(const RVector & rho, const RVector & thk) {
     tmp_ = pot1d(am_, rho, thk);
     tmp_ -= pot1d(an_, rho, thk);
@@ -103,6 +162,70 @@ RVector DC1dModelling::rhoa(const RVector & rho, const RVector & thk) {
     return tmp_ * k_ + rho[0];
 }
 
+void DC1dModelling::potDeriv_(const RVector & R, const RVector & rho,
+                              const RVector & thk, RMatrix & dPot) const {
+    Index nL = rho.size();
+    Index nPar = nL * 2 - 1;
+    dPot.resize(R.size(), nPar);
+    if (nL < 2) return;
+
+    RVector model(cat(thk, rho));
+    RVector dK(nPar);
+    double z, K;
+    for (Index i = 0; i < R.size(); i ++){
+        double rabs = std::fabs(R[i]);
+        RVector & dP = dPot[i];
+        dP *= 0.0;
+        for (Index j = 0; j < myx_.size(); j ++){
+            kern1dDeriv_(myx_[j] / rabs, nL, &model[0], &model[nL - 1], 1, 1,
+                         &z, &K, &dK[0]);
+            dP += dK * (myw_[j] * 2.0 / rabs);
+        }
+    }
+}
+
+void DC1dModelling::rhoaDeriv(const RVector & rho, const RVector & thk,
+                              RMatrix & J) const {
+    RMatrix dam, dan, dbm, dbn;
+    potDeriv_(am_, rho, thk, dam);
+    potDeriv_(an_, rho, thk, dan);
+    potDeriv_(bm_, rho, thk, dbm);
+    potDeriv_(bn_, rho, thk, dbn);
+
+    J.resize(am_.size(), rho.size() * 2 - 1);
+    for (Index i = 0; i < J.rows(); i ++){
+        J[i] = (dam[i] - dan[i] - dbm[i] + dbn[i]) * k_[i];
+        J[i][rho.size() - 1] += 1.0;
+    }
+}
+
+void DC1dModelling::createJacobian(const RVector & model){
+    if (model.size() != nlayers_ * 2 - 1){
+        throwLengthError(1, WHERE_AM_I + " model size invalid: " +
+                         str(model.size()) + " != " + str(nlayers_ * 2 - 1));
+    }
+    if (!jacobian_) this->initJacobian();
+    RMatrix * J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J) {
+        throwError(1, WHERE_AM_I + " Jacobian is not a dense matrix.");
+    }
+    rhoaDeriv(model(nlayers_ - 1, nlayers_ * 2 - 1), model(0, nlayers_ - 1), *J);
+}
+
+void DC1dRhoModelling::createJacobian(const RVector & rho){
+    if (!jacobian_) this->initJacobian();
+    RMatrix * J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J) {
+        throwError(1, WHERE_AM_I + " Jacobian is not a dense matrix.");
+    }
+    RMatrix Jfull;
+    rhoaDeriv(rho, thk_, Jfull);
+    J->resize(Jfull.rows(), rho.size());
+    for (Index i = 0; i < J->rows(); i ++){
+        (*J)[i] = Jfull[i](thk_.size(), Jfull.cols());
+    }
+}
+
 RVector DC1dModelling::kern1d(const RVector & lam, const RVector & rho, const RVector & h) {
     size_t nr = rho.size();
     size_t nl = lam.size();
@@ -446,4 +569,252 @@ RVector DC1dModellingC::response(const RVector & model) {
     return cat(abs(rhoaC), angPlus);
 }
 
+void DC1dModellingC::createJacobian(const RVector & model){
+    ModellingBase::createJacobian(model);
+}
+
+void DC1dMultiJacobian::resize(Index nSoundings, Index nData, Index nPar){
+    nSoundings_ = nSoundings;
+    nData_ = nData;
+    nPar_ = nPar;
+    blocks_.resize(nSoundings);
+    for (Index s = 0; s < nSoundings; s ++) blocks_[s].resize(nData, nPar);
+}
+
+RVector DC1dMultiJacobian::mult(const RVector & a) const {
+    if (a.size() != this->cols()){
+        throwLengthError(1, WHERE_AM_I + " wrong size of vector a (" +
+                         str(a.size()) + ") needed: " + str(this->cols()));
+    }
+    RVector ret(this->rows());
+    RVector aS(nPar_);
+    for (Index s = 0; s < nSoundings_; s ++){
+        for (Index p = 0; p < nPar_; p ++) aS[p] = a[p * nSoundings_ + s];
+        ret.setVal(blocks_[s] * aS, s * nData_, (s + 1) * nData_);
+    }
+    return ret;
+}
+
+RVector DC1dMultiJacobian::transMult(const RVector & a) const {
+    if (a.size() != this->rows()){
+        throwLengthError(1, WHERE_AM_I + " wrong size of vector a (" +
+                         str(a.size()) + ") needed: " + str(this->rows()));
+    }
+    RVector ret(this->cols());
+    for (Index s = 0; s < nSoundings_; s ++){
+        RVector tS(GIMLI::transMult(blocks_[s], a(s * nData_, (s + 1) * nData_)));
+        for (Index p = 0; p < nPar_; p ++) ret[p * nSoundings_ + s] = tS[p];
+    }
+    return ret;
+}
+
+DC1dMultiModelling::DC1dMultiModelling(size_t nlayers, Index nSoundings,
+                                       const RVector & am, const RVector & an,
+                                       const RVector & bm, const RVector & bn,
+                                       bool verbose)
+    : DC1dModelling(nlayers, am, an, bm, bn, verbose), nSoundings_(nSoundings){
+    nPar_ = nlayers_ * 2 - 1;
+    setMesh(createMesh1D(nSoundings_, nPar_));
+    initFilterTable_();
+}
+
+DC1dMultiModelling::DC1dMultiModelling(size_t nlayers, Index nSoundings,
+                                       const RVector & ab2, const RVector & mn2,
+                                       bool verbose)
+    : DC1dModelling(nlayers, ab2, mn2, verbose), nSoundings_(nSoundings){
+    nPar_ = nlayers_ * 2 - 1;
+    setMesh(createMesh1D(nSoundings_, nPar_));
+    initFilterTable_();
+}
+
+/*! Collect the unique distance for all data, afterwards the unique wave
+ * numbers myx_ / distance with their filter weights. */
+void DC1dMultiModelling::initFilterTable_(){
+    Index nData = am_.size();
+    RVector allDist(cat(cat(am_, an_), cat(bm_, bn_)));
+    RVector sorted(sort(RVector(abs(allDist))));
+
+    std::vector < double > dist;
+    for (Index i = 0; i < sorted.size(); i ++){
+        if (dist.empty() || sorted[i] > dist.back() * (1.0 + 1e-12)) {
+            dist.push_back(sorted[i]);
+        }
+    }
+    dist_ = dist;
+
+    std::vector < Index > * idx[4] = {&iam_, &ian_, &ibm_, &ibn_};
+    for (Index k = 0; k < 4; k ++){
+        idx[k]->resize(nData);
+        for (Index i = 0; i < nData; i ++){
+            double d = std::fabs(allDist[k * nData + i]);
+            (*idx[k])[i] = std::lower_bound(dist.begin(), dist.end(),
+                                            d * (1.0 - 1e-12)) - dist.begin();
+        }
+    }
+
+    //** all (lambda, distance, weight) triples sorted by lambda
+    std::vector < std::pair < double, std::pair< Index, double > > > lam;
+    for (Index r = 0; r < dist_.size(); r ++){
+        for (Index j = 0; j < myx_.size(); j ++){
+            lam.push_back(std::make_pair(myx_[j] / dist_[r],
+                          std::make_pair(r, myw_[j] * 2.0 / dist_[r])));
+        }
+    }
+    std::sort(lam.begin(), lam.end());
+
+    std::vector < double > uLam;
+    std::vector < double > weight;
+    lamPtr_.clear();
+    lamDist_.clear();
+    for (Index i = 0; i < lam.size(); i ++){
+        if (uLam.empty() || lam[i].first > uLam.back() * (1.0 + 1e-12)){
+            uLam.push_back(lam[i].first);
+            lamPtr_.push_back(lamDist_.size());
+        }
+        lamDist_.push_back(lam[i].second.first);
+        weight.push_back(lam[i].second.second);
+    }
+    lamPtr_.push_back(lamDist_.size());
+    lam_ = uLam;
+    lamWeight_ = weight;
+
+    if (verbose_) std::cout << "DC1dMultiModelling: " << nSoundings_
+                            << " soundings, " << dist_.size()
+                            << " distances, " << lam_.size() << " of "
+                            << lam.size() << " wave numbers." << std::endl;
+}
+
+void DC1dMultiModelling::checkModelSize_(const RVector & model) const {
+    if (model.size() != nPar_ * nSoundings_){
+        throwLengthError(1, WHERE_AM_I + " model size invalid: " +
+                         str(model.size()) + " != " + str(nPar_ * nSoundings_));
+    }
+}
+
+void DC1dMultiModelling::calculate(const RVector & model, RVector & resp,
+                                   DC1dMultiJacobian * J,
+                                   Index start, Index end) const {
+    Index nS = nSoundings_;
+    Index nR = end - start;
+    Index nL = nlayers_;
+    Index nDist = dist_.size();
+    Index nPar = nPar_;
+    Index nData = am_.size();
+    if (nR == 0) return;
+
+    //** model values are already parameter major, i.e., SoA over soundings
+    const double * thk = &model[0] + start;
+    const double * rho = &model[0] + (nL - 1) * nS + start;
+
+    RVector pot(nDist * nR, 0.0);
+    RVector dPot(J ? nDist * nPar * nR : 0, 0.0);
+
+    RVector z(nR), K(nR);
+    RVector dz(J ? nPar * nR : 0);
+
+    for (Index u = 0; u < lam_.size() && nL > 1; u ++){
+        kern1dDeriv_(lam_[u], nL, thk, rho, nS, nR, &z[0], &K[0],
+                     J ? &dz[0] : 0);
+
+        for (Index k = lamPtr_[u]; k < lamPtr_[u + 1]; k ++){
+            Index d = lamDist_[k];
+            double w = lamWeight_[k];
+            double * pt = &pot[d * nR];
+            for (Index s = 0; s < nR; s ++) pt[s] += w * K[s];
+            if (J){
+                for (Index q = 0; q < nPar; q ++){
+                    double * dpt = &dPot[(d * nPar + q) * nR];
+                    const double * dk = &dz[q * nR];
+                    for (Index s = 0; s < nR; s ++) dpt[s] += w * dk[s];
+                }
+            }
+        }
+    }
+
+    for (Index s = 0; s < nR; s ++){
+        for (Index i = 0; i < nData; i ++){
+            resp[(start + s) * nData + i] = k_[i] * (pot[iam_[i] * nR + s] -
+                                                     pot[ian_[i] * nR + s] -
+                                                     pot[ibm_[i] * nR + s] +
+                                                     pot[ibn_[i] * nR + s])
+                                            + rho[s];
+        }
+        if (J){
+            RMatrix & Js = J->block(start + s);
+            for (Index i = 0; i < nData; i ++){
+                for (Index q = 0; q < nPar; q ++){
+                    Js[i][q] = k_[i] * (dPot[(iam_[i] * nPar + q) * nR + s] -
+                                        dPot[(ian_[i] * nPar + q) * nR + s] -
+                                        dPot[(ibm_[i] * nPar + q) * nR + s] +
+                                        dPot[(ibn_[i] * nPar + q) * nR + s]);
+                }
+                Js[i][nL - 1] += 1.0;
+            }
+        }
+    }
+}
+
+class DC1dMultiCalcMT : public GIMLI::BaseCalcMT{
+public:
+    DC1dMultiCalcMT(const DC1dMultiModelling & fop, const RVector & model,
+                    RVector & resp, DC1dMultiJacobian * J, bool verbose)
+    : BaseCalcMT(1, verbose), fop_(&fop), model_(&model), resp_(&resp), J_(J){
+    }
+
+    virtual ~DC1dMultiCalcMT(){}
+
+    virtual void calc(Index tNr=0){
+        fop_->calculate(*model_, *resp_, J_, start_, end_);
+    }
+
+protected:
+    const DC1dMultiModelling    * fop_;
+    const RVector               * model_;
+    RVector                     * resp_;
+    DC1dMultiJacobian           * J_;
+};
+
+RVector DC1dMultiModelling::response_mt(const RVector & model, Index i) const {
+    checkModelSize_(model);
+    RVector resp(nSoundings_ * am_.size());
+    distributeCalc(DC1dMultiCalcMT(*this, model, resp, 0, verbose_),
+                   nSoundings_, max(Index(1), min(nThreads_, nSoundings_)), verbose_);
+    return resp;
+}
+
+RVector DC1dMultiModelling::response(const RVector & model){
+    return response_mt(model);
+}
+
+void DC1dMultiModelling::initJacobian(){
+    if (jacobian_ && ownJacobian_){
+        delete jacobian_;
+    }
+    jacobian_ = new DC1dMultiJacobian();
+    ownJacobian_ = true;
+}
+
+void DC1dMultiModelling::createJacobian(const RVector & model){
+    checkModelSize_(model);
+    DC1dMultiJacobian * J = dynamic_cast< DC1dMultiJacobian * >(jacobian_);
+    if (!J) {
+        this->initJacobian();
+        J = dynamic_cast< DC1dMultiJacobian * >(jacobian_);
+    }
+    J->resize(nSoundings_, am_.size(), nPar_);
+
+    RVector resp(nSoundings_ * am_.size());
+    distributeCalc(DC1dMultiCalcMT(*this, model, resp, J, verbose_),
+                   nSoundings_, max(Index(1), min(nThreads_, nSoundings_)), verbose_);
+}
+
+RVector DC1dMultiModelling::createDefaultStartModel() {
+    RVector mod(nPar_ * nSoundings_, meanrhoa_);
+    for (Index i = 0; i < nlayers_ - 1; i++) {
+        mod.setVal(std::pow(2.0, 1.0 + i), i * nSoundings_,
+                   SIndex((i + 1) * nSoundings_));
+    }
+    return mod;
+}
+
 } // namespace GIMLI{
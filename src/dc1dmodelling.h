@@ -61,6 +61,13 @@ public:
 
     RVector pot1d(const RVector & R, const RVector & rho, const RVector & thk);
 
+    /*! Analytical derivatives of the apparent resistivities with respect to
+     * [thk, rho] by differentiation of the kernel recursion. */
+    void rhoaDeriv(const RVector & rho, const RVector & thk, RMatrix & J) const;
+
+    /*! Analytical Jacobian, see \ref rhoaDeriv. */
+    virtual void createJacobian(const RVector & model);
+
     inline RVector getK() { return k_; }
 
     inline RVector geometricFactor() { return k_; }
@@ -109,6 +116,10 @@ protected:
     /*! init myw and myx */
     void init_();
 
+    /*! Derivatives of the potentials for distances R, size R.size() x nPar */
+    void potDeriv_(const RVector & R, const RVector & rho, const RVector & thk,
+                   RMatrix & dPot) const;
+
     void postprocess_();
 
     size_t nlayers_;
@@ -140,6 +151,9 @@ public:
     virtual ~DC1dModellingC() { }
 
     RVector response(const RVector & model);
+
+    /*! No analytical derivatives for complex resistivity yet (brute force). */
+    virtual void createJacobian(const RVector & model);
 };
 
 /*! DC1dRhoModelling - Variant of DC 1D modelling with fixed parameterization
@@ -170,6 +184,9 @@ public:
 
     RVector response(const RVector & rho) {  return rhoa(rho, thk_); }
 
+    /*! Analytical Jacobian for the resistivities only. */
+    virtual void createJacobian(const RVector & rho);
+
     RVector createDefaultStartModel() {
         return RVector(thk_.size() + 1, meanrhoa_);
     }
@@ -178,6 +195,100 @@ protected:
     RVector thk_;
 };
 
+/*! Jacobian of \ref DC1dMultiModelling. Block diagonal over the soundings,
+ * i.e., one dense nData x nPar block per sounding, while the model is stored
+ * parameter by parameter (column p * nSoundings + s) and the data sounding
+ * by sounding (row s * nData + i). */
+class DLLEXPORT DC1dMultiJacobian : public MatrixBase {
+public:
+    DC1dMultiJacobian() : MatrixBase(), nSoundings_(0), nData_(0), nPar_(0) { }
+
+    virtual ~DC1dMultiJacobian() { }
+
+    void resize(Index nSoundings, Index nData, Index nPar);
+
+    virtual Index rows() const { return nSoundings_ * nData_; }
+
+    virtual Index cols() const { return nSoundings_ * nPar_; }
+
+    virtual RVector mult(const RVector & a) const;
+
+    virtual RVector transMult(const RVector & a) const;
+
+    /*! Return the block of sounding s. */
+    inline RMatrix & block(Index s) { return blocks_[s]; }
+    inline const RMatrix & block(Index s) const { return blocks_[s]; }
+
+protected:
+    Index nSoundings_;
+    Index nData_;
+    Index nPar_;
+    std::vector < RMatrix > blocks_;
+};
+
+//! Batched DC 1D modelling for many soundings, e.g., a whole survey
+/*! Batched DC 1D modelling for nSoundings soundings with the same
+ * electrode configuration, e.g., for laterally constrained inversion.
+ * The model is stored parameter by parameter over all soundings
+ * [thk_0(s=0..nS-1), ..., thk_(n-2)(...), rho_0(...), ..., rho_(n-1)(...)],
+ * so the mesh createMesh1D(nSoundings, nPar) provides lateral constraints
+ * per parameter, the response is ordered sounding by sounding.
+ * All electrode distances share one table of Hankel filter abscissae
+ * (coinciding wave numbers are calculated once) and the kernels are
+ * evaluated for all soundings of a thread at once. The Jacobian is
+ * calculated analytically by differentiation of the layer recursion. */
+class DLLEXPORT DC1dMultiModelling : public DC1dModelling {
+public:
+    DC1dMultiModelling(size_t nlayers, Index nSoundings,
+                       const RVector & am, const RVector & an,
+                       const RVector & bm, const RVector & bn,
+                       bool verbose=false);
+
+    DC1dMultiModelling(size_t nlayers, Index nSoundings,
+                       const RVector & ab2, const RVector & mn2,
+                       bool verbose=false);
+
+    virtual ~DC1dMultiModelling() { }
+
+    /*! Return the apparent resistivities of all soundings. */
+    virtual RVector response(const RVector & model);
+
+    /*! Read only response, see \ref response. */
+    virtual RVector response_mt(const RVector & model, Index i=0) const;
+
+    /*! Analytical Jacobian as \ref DC1dMultiJacobian. */
+    virtual void createJacobian(const RVector & model);
+
+    virtual void initJacobian();
+
+    virtual RVector createDefaultStartModel();
+
+    inline Index nSoundings() const { return nSoundings_; }
+
+    /*! Calculate the responses for the soundings [start, end) and, if J is
+     * given, their Jacobian blocks. */
+    void calculate(const RVector & model, RVector & resp,
+                   DC1dMultiJacobian * J, Index start, Index end) const;
+
+protected:
+    void initFilterTable_();
+
+    void checkModelSize_(const RVector & model) const;
+
+    Index nSoundings_;
+    Index nPar_;
+
+    /*! Unique electrode distances and their index per datum */
+    RVector dist_;
+    std::vector < Index > iam_, ian_, ibm_, ibn_;
+
+    /*! Unique wave numbers and their contributions (distance, weight) */
+    RVector lam_;
+    std::vector < Index > lamPtr_;
+    std::vector < Index > lamDist_;
+    RVector lamWeight_;
+};
+
 } // namespace GIMLI{
 
 #endif // _GIMLI_DC1DMODELLING__H
@@ -23,6 +23,9 @@
 #include "pos.h"
 
 #include "integration.h"
+#include "mesh.h"
+#include "calculateMultiThread.h"
+#include "stopwatch.h"
 
 namespace GIMLI{
 
@@ -499,18 +502,34 @@ template < > ElementMatrix < double > & ElementMatrix < double >::u2(const MeshE
     return *this;
 }
 
-template < > ElementMatrix < double > & ElementMatrix < double >::ux2uy2uz2(const Cell & cell, bool useCache){
+template < > ElementMatrix < double > & ElementMatrix < double >::ux2uy2uz2(const Cell & cell,
+                                                                           const CellGradientCache & cache){
+    Index nNodes = cell.nodeCount();
+    if (Index(cell.id()) >= cache.size() || cache.nodeCount(cell.id()) != nNodes){
+        throwError(1, WHERE_AM_I + " cell " + str(cell.id()) +
+                   " does not match the cache.");
+    }
+    if (size() != nNodes) resize(nNodes);
+
+    const double * S = cache.stiffness(cell.id());
+    for (Index i = 0; i < nNodes; i ++){
+        idx_[i] = cell.node(i).id();
+        for (Index j = i; j < nNodes; j ++){
+            mat_[i][j] = *S;
+            mat_[j][i] = *S;
+            S ++;
+        }
+    }
+    return *this;
+}
+
+template < > ElementMatrix < double > & ElementMatrix < double >::ux2uy2uz2(const Cell & cell){
 
     uint dim = cell.nodeCount();
     if (size() != dim) resize(dim);
 
     for (uint i = 0; i < dim; i ++) idx_[i] = cell.node(i).id();
 
-    if (cell.uxCache().rows() > 0 && useCache){
-        mat_ = cell.uxCache();
-        return *this;
-    }
-
 //     double J = cell.jacobianDeterminant();
 //     if (J <= 0) std::cerr << WHERE_AM_I << " JacobianDeterminant < 0 (" << J << ") " << cell << std::endl;
 //      std::cout << J << std::endl;
@@ -822,11 +841,124 @@ template < > ElementMatrix < double > & ElementMatrix < double >::ux2uy2uz2(cons
         break;
     }
 
-    if (useCache) cell.setUxCache(mat_);
-
     return *this;
 }
 
+class CellGradientCacheMT : public BaseCalcMT{
+public:
+    CellGradientCacheMT(const Mesh & mesh, Index dim,
+                        const std::map< uint8, RMatrix > & dNdrst,
+                        const std::vector< Index > & stiffOffset,
+                        const std::vector< Index > & nodeOffset,
+                        double * stiff, double * grad)
+        : BaseCalcMT(), mesh_(&mesh), dim_(dim), dNdrst_(&dNdrst),
+          stiffOffset_(&stiffOffset), nodeOffset_(&nodeOffset),
+          stiff_(stiff), grad_(grad){
+    }
+
+    virtual ~CellGradientCacheMT(){}
+
+    virtual void calc(Index tNr=0){
+        ElementMatrix < double > S;
+        for (Index c = start_; c < end_; c ++){
+            const Cell & cell = mesh_->cell(c);
+            Index n = cell.nodeCount();
+
+            S.ux2uy2uz2(cell);
+            double * s = stiff_ + (*stiffOffset_)[c];
+            for (Index i = 0; i < n; i ++){
+                for (Index j = i; j < n; j ++) *s++ = S.getVal(i, j);
+            }
+
+            //** dN_i/dx_k = sum_r dN_i/dr * dr/dx_k
+            const RMatrix & dNdr = dNdrst_->find(cell.rtti())->second;
+            const RMatrix3 & iJ = cell.shape().invJacobian();
+            double * g = grad_ + (*nodeOffset_)[c] * dim_;
+            for (Index i = 0; i < n; i ++){
+                for (Index k = 0; k < dim_; k ++){
+                    double v = 0.0;
+                    for (Index r = 0; r < dim_; r ++) v += dNdr[r][i] * iJ[r * 3 + k];
+                    g[i * dim_ + k] = v;
+                }
+            }
+        }
+    }
+
+protected:
+    const Mesh * mesh_;
+    Index dim_;
+    const std::map< uint8, RMatrix > * dNdrst_;
+    const std::vector< Index > * stiffOffset_;
+    const std::vector< Index > * nodeOffset_;
+    double * stiff_;
+    double * grad_;
+};
+
+CellGradientCache::CellGradientCache(const Mesh & mesh, bool verbose)
+    : dim_(mesh.dim()){
+    update(mesh, verbose);
+}
+
+void CellGradientCache::update(const Mesh & mesh, bool verbose){
+    Stopwatch swatch(true);
+    dim_ = mesh.dim();
+    Index nCells = mesh.cellCount();
+
+    //** the shape function derivatives at the local cell center only
+    //** depend on the cell type, they also fill the shape function cache
+    //** before the threads use it
+    std::map< uint8, RMatrix > dNdrst;
+
+    stiffOffset_.assign(nCells + 1, 0);
+    nodeOffset_.assign(nCells + 1, 0);
+    for (Index c = 0; c < nCells; c ++){
+        const Cell & cell = mesh.cell(c);
+        if (Index(cell.id()) != c){
+            throwError(1, WHERE_AM_I + " cell ids need to be [0, cellCount).");
+        }
+        Index n = cell.nodeCount();
+        if (!dNdrst.count(cell.rtti())){
+            //** the corners of the linear shape, also for quadratic cells
+            Index nCorners = cell.shape().nodeCount();
+            RVector3 rst(0.0, 0.0, 0.0);
+            for (Index i = 0; i < nCorners; i ++) rst += cell.shape().rst(i);
+            rst /= double(nCorners);
+            RMatrix & dN = dNdrst[cell.rtti()];
+            for (Index r = 0; r < dim_; r ++) dN.push_back(cell.dNdL(rst, r));
+        }
+        stiffOffset_[c + 1] = stiffOffset_[c] + n * (n + 1) / 2;
+        nodeOffset_[c + 1] = nodeOffset_[c] + n;
+    }
+    stiff_.resize(stiffOffset_[nCells]);
+    grad_.resize(nodeOffset_[nCells] * dim_);
+
+    //** initialize the singleton before the threads do
+    IntegrationRules::instance();
+
+    Index nThreads = max(Index(1), min(threadCount(), nCells / 1000));
+    if (nCells > 0){
+        distributeCalc(CellGradientCacheMT(mesh, dim_, dNdrst, stiffOffset_, nodeOffset_,
+                                           &stiff_[0], &grad_[0]),
+                       nCells, nThreads, verbose);
+    }
+
+    if (verbose) std::cout << "CellGradientCache: " << nCells << " cells, "
+                           << memSize() / 1024 << " kB (" << swatch.duration()
+                           << " s, " << nThreads << " threads)" << std::endl;
+}
+
+RVector3 CellGradientCache::grad(Index cellId, Index i) const {
+    RVector3 ret(0.0, 0.0, 0.0);
+    const double * g = gradients(cellId) + i * dim_;
+    for (Index k = 0; k < dim_; k ++) ret[k] = g[k];
+    return ret;
+}
+
+Index CellGradientCache::memSize() const {
+    return (stiff_.size() + grad_.size()) * sizeof(double) +
+           (stiffOffset_.size() + nodeOffset_.size()) * sizeof(Index);
+}
+
 void ElementMatrixMap::add(Index row, const ElementMatrix < double > & Ai){
     rows_ = max(row + 1, rows_);
     cols_ = max(max(Ai.idx()) + 1, cols_);
@@ -879,5 +1011,109 @@ RVector ElementMatrixMap::mult(const RVector & a, const RVector & b) const{
     return ret;
 }
 
+/*! Integrals over the reference cell with unit weight sum, i.e.,
+ * M_ij = sum_q w_q N_i N_j and T^ab_ij = sum_q w_q dN_i/dr_a dN_j/dr_b. */
+template < Index N > class ElementKernelTable_ {
+public:
+    ElementKernelTable_(const Cell & cell,
+                        const RVector & wM, const R3Vector & xM,
+                        const RVector & wS, const R3Vector & xS){
+        dim_ = cell.dim();
+        for (Index i = 0; i < N; i ++){
+            for (Index j = 0; j < N; j ++){
+                M_[i][j] = 0.0;
+                for (Index a = 0; a < 3; a ++)
+                    for (Index b = 0; b < 3; b ++) T_[a][b][i][j] = 0.0;
+            }
+        }
+        for (Index q = 0; q < wM.size(); q ++){
+            RVector n(cell.N(xM[q]));
+            for (Index i = 0; i < N; i ++)
+                for (Index j = 0; j < N; j ++) M_[i][j] += wM[q] * n[i] * n[j];
+        }
+        for (Index q = 0; q < wS.size(); q ++){
+            RVector dN[3];
+            for (Index a = 0; a < dim_; a ++) dN[a] = cell.dNdL(xS[q], a);
+            for (Index a = 0; a < dim_; a ++){
+                for (Index b = 0; b < dim_; b ++){
+                    for (Index i = 0; i < N; i ++)
+                        for (Index j = 0; j < N; j ++)
+                            T_[a][b][i][j] += wS[q] * dN[a][i] * dN[b][j];
+                }
+            }
+        }
+    }
+
+    void fill(const Cell & cell, double k2, ElementKernel< N > & K) const {
+        for (Index i = 0; i < N; i ++) K.idx_[i] = cell.node(i).id();
+
+        //** metric of the constant inverse Jacobian like ux2uy2uz2
+        const RMatrix3 & iJ = cell.shape().invJacobian();
+        double G[3][3];
+        for (Index a = 0; a < dim_; a ++){
+            for (Index b = 0; b < dim_; b ++){
+                G[a][b] = 0.0;
+                for (Index x = 0; x < dim_; x ++) G[a][b] += iJ[a * 3 + x] * iJ[b * 3 + x];
+            }
+        }
+        double A = cell.shape().domainSize();
+
+        for (Index i = 0; i < N; i ++){
+            for (Index j = i; j < N; j ++){
+                double v = k2 * M_[i][j];
+                for (Index a = 0; a < dim_; a ++)
+                    for (Index b = 0; b < dim_; b ++) v += G[a][b] * T_[a][b][i][j];
+                K.mat_[i][j] = A * v;
+                K.mat_[j][i] = K.mat_[i][j];
+            }
+        }
+    }
+
+protected:
+    Index dim_;
+    double M_[N][N];
+    double T_[3][3][N][N];
+};
+
+#define ELEMENTKERNEL_CASE__(RTTI, N, M, MO, S, SO) \
+    case RTTI: { \
+        static const ElementKernelTable_< N > table(cell, \
+            IntegrationRules::instance().M##Weights(MO), \
+            IntegrationRules::instance().M##Abscissa(MO), \
+            IntegrationRules::instance().S##Weights(SO), \
+            IntegrationRules::instance().S##Abscissa(SO)); \
+        table.fill(cell, k2, K); \
+    } return true;
+
+bool elementKernel(const Cell & cell, double k2, ElementKernel< 3 > & K){
+    switch (cell.rtti()){
+        ELEMENTKERNEL_CASE__(MESH_TRIANGLE_RTTI, 3, tri, 2, tri, 1)
+        default: return false;
+    }
+}
+
+bool elementKernel(const Cell & cell, double k2, ElementKernel< 4 > & K){
+    switch (cell.rtti()){
+        ELEMENTKERNEL_CASE__(MESH_QUADRANGLE_RTTI, 4, qua, 2, qua, 2)
+        ELEMENTKERNEL_CASE__(MESH_TETRAHEDRON_RTTI, 4, tet, 2, tet, 1)
+        default: return false;
+    }
+}
+
+bool elementKernel(const Cell & cell, double k2, ElementKernel< 6 > & K){
+    switch (cell.rtti()){
+        ELEMENTKERNEL_CASE__(MESH_TRIPRISM_RTTI, 6, pri, 2, pri, 2)
+        default: return false;
+    }
+}
+
+bool elementKernel(const Cell & cell, double k2, ElementKernel< 8 > & K){
+    switch (cell.rtti()){
+        ELEMENTKERNEL_CASE__(MESH_HEXAHEDRON_RTTI, 8, hex, 2, hex, 2)
+        default: return false;
+    }
+}
+
+#undef ELEMENTKERNEL_CASE__
 
 } // namespace GIMLI
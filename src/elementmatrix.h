@@ -25,6 +25,8 @@
 
 namespace GIMLI{
 
+class CellGradientCache;
+
 template < class ValueType > class DLLEXPORT ElementMatrix {
 public:
     ElementMatrix() { }
@@ -86,7 +88,12 @@ public:
 
     ElementMatrix < ValueType > & u2(const MeshEntity & ent);
 
-    ElementMatrix < ValueType > & ux2uy2uz2(const Cell & cell, bool useCache=false);
+    ElementMatrix < ValueType > & ux2uy2uz2(const Cell & cell);
+
+    /*! Fill with the stiffness matrix of cell taken from cache, see
+     * \ref Mesh::cellGradientCache. */
+    ElementMatrix < ValueType > & ux2uy2uz2(const Cell & cell,
+                                            const CellGradientCache & cache);
 
     ElementMatrix < ValueType > & u(const MeshEntity & ent,
                                     const RVector & w,
@@ -235,6 +242,111 @@ protected:
     Index cols_;
 };
 
+//! Stack allocated element matrix with N nodes.
+/*! Stack allocated element matrix with compile-time size N. Filled by
+ * \ref elementKernel without any heap allocation, for the per-cell hot loops
+ * of the FEM assembling and the sensitivity calculation. */
+template < Index N > class ElementKernel {
+public:
+    ElementKernel(){ }
+
+    static inline Index size() { return N; }
+
+    inline Index idx(Index i) const { return idx_[i]; }
+
+    inline double getVal(Index i, Index j) const { return mat_[i][j]; }
+
+    /*! Return (S * (a-b)) * (m-n) */
+    template < class Val > Val mult(const Vector < Val > & a,
+                                    const Vector < Val > & b,
+                                    const Vector < Val > & m,
+                                    const Vector < Val > & n) const {
+        Val d[N];
+        for (Index j = 0; j < N; j ++) d[j] = a[idx_[j]] - b[idx_[j]];
+
+        Val ret = 0;
+        for (Index i = 0; i < N; i ++) {
+            Val t = 0;
+            for (Index j = 0; j < N; j ++) t += mat_[i][j] * d[j];
+            ret += t * (m[idx_[i]] - n[idx_[i]]);
+        }
+        return ret;
+    }
+
+    double mat_[N][N];
+    Index idx_[N];
+};
+
+/*! Fill K with the stiffness matrix ux2uy2uz2 plus k2 times the mass matrix
+ * u2 of a linear cell, i.e., the same as ElementMatrix::u2 * k2 +
+ * ElementMatrix::ux2uy2uz2. The integrals over the reference cell are
+ * tabulated once per cell type. Supported are triangles (N=3),
+ * quadrangles and tetrahedrons (N=4), triangular prisms (N=6) and
+ * hexahedrons (N=8). Return false for any other cell type. */
+DLLEXPORT bool elementKernel(const Cell & cell, double k2, ElementKernel< 3 > & K);
+DLLEXPORT bool elementKernel(const Cell & cell, double k2, ElementKernel< 4 > & K);
+DLLEXPORT bool elementKernel(const Cell & cell, double k2, ElementKernel< 6 > & K);
+DLLEXPORT bool elementKernel(const Cell & cell, double k2, ElementKernel< 8 > & K);
+
+//! Contiguous per-cell cache of stiffness matrices and shape function gradients.
+/*! Holds for all cells of a mesh, indexed by cell id, the symmetric stiffness
+ * matrix \ref ElementMatrix::ux2uy2uz2 in packed upper triangular storage and
+ * the Cartesian gradients of the shape functions at the cell center, each in
+ * one contiguous array. The gradients are exact for linear cells.
+ * Usually obtained by \ref Mesh::cellGradientCache, which builds it on demand
+ * and rebuilds it in place if the geometry changes. */
+class DLLEXPORT CellGradientCache{
+public:
+    /*! Build the cache for all cells of mesh, distributed over
+     * \ref threadCount() threads. The cell ids need to be [0, cellCount). */
+    CellGradientCache(const Mesh & mesh, bool verbose=false);
+
+    /*! Rebuild the cache in place for the current geometry of mesh. */
+    void update(const Mesh & mesh, bool verbose=false);
+
+    /*! Return the amount of cached cells. */
+    inline Index size() const { return nodeOffset_.size() - 1; }
+
+    /*! Return the amount of gradient components per shape function. */
+    inline Index dim() const { return dim_; }
+
+    /*! Return the node count of the cell with id cellId. */
+    inline Index nodeCount(Index cellId) const {
+        return nodeOffset_[cellId + 1] - nodeOffset_[cellId];
+    }
+
+    /*! Return the packed upper triangle of the stiffness matrix for cellId,
+     * row by row, i.e., S_ij for i <= j at i * n - i * (i - 1) / 2 + j - i. */
+    inline const double * stiffness(Index cellId) const {
+        return &stiff_[stiffOffset_[cellId]];
+    }
+
+    /*! Return the stiffness matrix entry S_ij for cellId. */
+    inline double stiffness(Index cellId, Index i, Index j) const {
+        if (i > j) std::swap(i, j);
+        return stiffness(cellId)[i * nodeCount(cellId) - i * (i - 1) / 2 + j - i];
+    }
+
+    /*! Return the shape function gradients for cellId. The component k of
+     * the gradient of the i-th shape function is at i * dim() + k. */
+    inline const double * gradients(Index cellId) const {
+        return &grad_[nodeOffset_[cellId] * dim_];
+    }
+
+    /*! Return the gradient of the i-th shape function for cellId. */
+    RVector3 grad(Index cellId, Index i) const;
+
+    /*! Return the allocated memory in bytes. */
+    Index memSize() const;
+
+protected:
+    Index dim_;
+    RVector stiff_;
+    RVector grad_;
+    std::vector< Index > stiffOffset_;
+    std::vector< Index > nodeOffset_;
+};
+
 template < class ValueType > std::ostream & operator << (std::ostream & str, const ElementMatrix< ValueType > & e){
     for (uint i = 0; i < e.idx().size(); i ++) str << e.idx(i) << " " ;
 
@@ -20,32 +20,216 @@
 #include "gimli.h"
 #include "em1dmodelling.h"
 #include "meshgenerators.h"
+#include "calculateMultiThread.h"
 
 #include <math.h>
 
 namespace GIMLI {
 
-RVector MT1dModelling::rhoaphi(const RVector & rho, const RVector & thk) { // after mtmod.c by R.-U. B�rner
-    size_t nperiods = periods_.size();
-    RVector rhoa(nperiods), phi(nperiods);
-
-    RVector::ValType my0 = PI * 4e-7;
-    Complex i_unit(0.0 , 1.0), adm, alpha, tanalpha;
-    CVector z(nlay_);
-    for (size_t i = 0 ; i < nperiods ; i++) {
-        RVector::ValType omega = 2.0 * PI / periods_[i];
-        z[nlay_ - 1] = sqrt(i_unit * omega * rho[nlay_ - 1] / my0);
-        for (int k = nlay_ - 2 ; k >= 0 ; k--) {
-            adm = sqrt(my0 / (rho[k] * i_unit * omega));
-            alpha = thk[k] * sqrt(i_unit * my0 * omega / rho[k]);
-            tanalpha = sinh(alpha) / cosh(alpha);
-            z[k] = (adm * z[k + 1] + tanalpha) / (adm * z[k + 1] * tanalpha + (RVector::ValType)1.0);
-            z[k] /= adm;
+/*! Hankel filter coefficients for J0 (100 points, 10 per decade) */
+static const int HANKEL_NC = 100;
+static const int HANKEL_NC0 = 60;
+static const double hankelJ0[100]={
+    2.89878288E-07,3.64935144E-07,4.59426126E-07,5.78383226E-07,
+    7.28141338E-07,9.16675639E-07,1.15402625E-06,1.45283298E-06,
+    1.82900834E-06,2.30258511E-06,2.89878286E-06,3.64935148E-06,
+    4.59426119E-06,5.78383236E-06,7.28141322E-06,9.16675664E-06,
+    1.15402621E-05,1.45283305E-05,1.82900824E-05,2.30258527E-05,
+    2.89878259E-05,3.64935186E-05,4.59426051E-05,5.78383329E-05,
+    7.28141144E-05,9.16675882E-05,1.15402573E-04,1.45283354E-04,
+    1.82900694E-04,2.30258630E-04,2.89877891E-04,3.64935362E-04,
+    4.59424960E-04,5.78383437E-04,7.28137738E-04,9.16674828E-04,
+    1.15401453E-03,1.45282561E-03,1.82896826E-03,2.30254535E-03,
+    2.89863979E-03,3.64916703E-03,4.59373308E-03,5.78303238E-03,
+    7.27941497E-03,9.16340705E-03,1.15325691E-02,1.45145832E-02,
+    1.82601199E-02,2.29701042E-02,2.88702619E-02,3.62691810E-02,
+    4.54794031E-02,5.69408192E-02,7.09873072E-02,8.80995426E-02,
+    1.08223889E-01,1.31250483E-01,1.55055715E-01,1.76371506E-01,
+    1.85627738E-01,1.69778044E-01,1.03405245E-01,-3.02583233E-02,
+    -2.27574393E-01,-3.62173217E-01,-2.05500446E-01,3.37394873E-01,
+    3.17689897E-01,-5.13762160E-01,3.09130264E-01,-1.26757592E-01,
+    4.61967890E-02,-1.80968674E-02,8.35426050E-03,-4.47368304E-03,
+    2.61974783E-03,-1.60171357E-03,9.97717882E-04,-6.26275815E-04,
+    3.94338818E-04,-2.48606354E-04,1.56808604E-04,-9.89266288E-05,
+    6.24152398E-05,-3.93805393E-05,2.48472358E-05,-1.56774945E-05,
+    9.89181741E-06,-6.24131160E-06,3.93800058E-06,-2.48471018E-06,
+    1.56774609E-06,-9.89180896E-07,6.24130948E-07,-3.93800005E-07,
+    2.48471005E-07,-1.56774605E-07,9.89180888E-08,-6.24130946E-08};
+
+/*! Surface impedance of a layered halfspace for nP angular frequencies at
+ * once (structure of arrays, real arithmetic). With k = sqrt(i omega mu0 / rho)
+ * all complex square roots factor into sqrt(i) times a real layer term, and
+ * tanh(alpha) = tanh(a + ia) is evaluated by exp(-2a), sin(2a), cos(2a). */
+static void mtImpedance( const double * rho, const double * thk, Index nl,
+                         const double * omega, const double * sqrtOmega, Index nP,
+                         double * zr, double * zi){
+    double my0 = PI * 4e-7;
+    double s2 = 1.0 / std::sqrt(2.0);
+
+    //** lowest layer z = sqrt(i omega rho / mu0)
+    double c = std::sqrt(rho[nl - 1] / my0) * s2;
+    for (Index p = 0; p < nP; p ++){
+        zr[p] = c * sqrtOmega[p];
+        zi[p] = zr[p];
+    }
+
+    for (int k = nl - 2; k >= 0; k--) {
+        double sk = std::sqrt(my0 / rho[k]); // u = sk * sqrt(omega)
+        for (Index p = 0; p < nP; p ++){
+            double u = sk * sqrtOmega[p];
+            //** adm = sqrt(mu0 / (i omega rho)) = (1 - i) u / (sqrt(2) omega)
+            double ar = u * s2 / omega[p];
+            double ai = -ar;
+            //** tanh(alpha), alpha = thk (1 + i) u / sqrt(2)
+            double a2 = 2.0 * thk[k] * u * s2;
+            double q = std::exp(-a2);
+            double td = 1.0 + q * q + 2.0 * q * std::cos(a2);
+            double tr = (1.0 - q * q) / td;
+            double ti = 2.0 * q * std::sin(a2) / td;
+            //** w = adm * z
+            double wr = ar * zr[p] - ai * zi[p];
+            double wi = ar * zi[p] + ai * zr[p];
+            //** z = (w + t) / ((w * t + 1) * adm)
+            double nr = wr + tr, ni = wi + ti;
+            double dr = wr * tr - wi * ti + 1.0;
+            double di = wr * ti + wi * tr;
+            double er = dr * ar - di * ai;
+            double ei = dr * ai + di * ar;
+            double e2 = er * er + ei * ei;
+            zr[p] = (nr * er + ni * ei) / e2;
+            zi[p] = (ni * er - nr * ei) / e2;
+        }
+    }
+}
+
+void MT1dModelling::rhoaphi_(const RVector & rho, const RVector & thk,
+                             double * rhoa, double * phi) const {
+    Index nperiods = periods_.size();
+    double my0 = PI * 4e-7;
+    RVector omega(2.0 * PI / periods_);
+    RVector sqrtOmega(sqrt(omega));
+    RVector zr(nperiods), zi(nperiods);
+    mtImpedance(&rho[0], &thk[0], rho.size(), &omega[0], &sqrtOmega[0],
+                nperiods, &zr[0], &zi[0]);
+
+    for (Index i = 0 ; i < nperiods ; i++) {
+        rhoa[i] = (zr[i] * zr[i] + zi[i] * zi[i]) * my0 / omega[i];
+        phi[i] = std::atan(zi[i] / zr[i]);
+    }
+}
+
+RVector MT1dModelling::rhoaphi(const RVector & rho, const RVector & thk) { // after mtmod.c by R.-U. Boerner
+    Index nperiods = periods_.size();
+    RVector ret(nperiods * 2);
+    if (nperiods > 0) rhoaphi_(rho, thk, &ret[0], &ret[nperiods]);
+    return ret;
+}
+
+RVector MT1dModelling::response_mt(const RVector & model, Index i) const {
+    if (model.size() != nlay_ * 2 - 1) return EXIT_VECTOR_SIZE_INVALID;
+    Index nperiods = periods_.size();
+    RVector ret(nperiods * 2);
+    if (nperiods > 0) {
+        rhoaphi_(model(nlay_ - 1, 2 * nlay_ - 1), model(0, nlay_ - 1),
+                 &ret[0], &ret[nperiods]);
+    }
+    return ret;
+}
+
+class MT1dMultiMT : public BaseCalcMT{
+public:
+    MT1dMultiMT(const MT1dModelling & fop, const RMatrix & models,
+                RMatrix & resp, bool verbose)
+    : BaseCalcMT(1, verbose), fop_(&fop), models_(&models), resp_(&resp){ }
+
+    virtual ~MT1dMultiMT(){}
+
+    virtual void calc(Index tNr=0){
+        for (Index i = start_; i < end_; i ++){
+            (*resp_)[i] = fop_->response_mt((*models_)[i]);
         }
-        rhoa[i] = abs(z[0]) * abs(z[0]) * my0 / omega;
-        phi[i] = std::atan(imag(z[0]) / real(z[0]));
     }
-    return cat(rhoa, phi);
+
+protected:
+    const MT1dModelling * fop_;
+    const RMatrix       * models_;
+    RMatrix             * resp_;
+};
+
+RMatrix MT1dModelling::responses(const RMatrix & models, Index nThreads) const {
+    RMatrix resp(models.rows(), periods_.size() * 2);
+    distributeCalc(MT1dMultiMT(*this, models, resp, verbose_), models.rows(),
+                   max((Index)1, min(nThreads, models.rows())), verbose_);
+    return resp;
+}
+
+void MT1dModelling::rhoaphiDeriv(const RVector & rho, const RVector & thk,
+                                 RMatrix & J){
+    Index nperiods = periods_.size();
+    Index nl = rho.size();
+    Index nPar = nl * 2 - 1;
+    J.resize(nperiods * 2, nPar);
+
+    double my0 = PI * 4e-7;
+    Complex i_unit(0.0 , 1.0);
+    CVector dz(nPar);
+    for (Index i = 0 ; i < nperiods ; i++) {
+        double omega = 2.0 * PI / periods_[i];
+        Complex z(sqrt(i_unit * omega * rho[nl - 1] / my0));
+        dz *= Complex(0.0);
+        dz[nPar - 1] = z / (2.0 * rho[nl - 1]);
+
+        for (int k = nl - 2 ; k >= 0 ; k--) {
+            Complex adm(sqrt(my0 / (rho[k] * i_unit * omega)));
+            Complex alpha(thk[k] * sqrt(i_unit * my0 * omega / rho[k]));
+            Complex t(sinh(alpha) / cosh(alpha));
+            Complex w(adm * z);
+            Complex D(w * t + 1.0);
+            Complex zNew((w + t) / D / adm);
+
+            //** d zNew / d z, d t, d adm
+            Complex dzdz((Complex(1.0) - t * t) / (D * D));
+            Complex dzdt((Complex(1.0) - w * w) / (D * D) / adm);
+            Complex dzda(dzdz * z / adm - zNew / adm);
+            Complex dtda(Complex(1.0) - t * t); // d t / d alpha
+
+            for (Index p = k + 1; p < nl - 1; p ++) dz[p] *= dzdz;
+            for (Index p = nl + k; p < nPar; p ++) dz[p] *= dzdz;
+            //** alpha / thk without the division, thk may be zero
+            dz[k] = dzdt * dtda * sqrt(i_unit * my0 * omega / rho[k]);
+            dz[nl - 1 + k] = (dzdt * dtda * alpha + dzda * adm) / (-2.0 * rho[k]);
+            z = zNew;
+        }
+        double z2 = real(z) * real(z) + imag(z) * imag(z);
+        for (Index p = 0; p < nPar; p ++){
+            J[i][p] = 2.0 * real(conj(z) * dz[p]) * my0 / omega;
+            J[i + nperiods][p] = (real(z) * imag(dz[p]) -
+                                  imag(z) * real(dz[p])) / z2;
+        }
+    }
+}
+
+void MT1dModelling::createJacobian(const RVector & model){
+    if (model.size() != nlay_ * 2 - 1){
+        throwLengthError(1, WHERE_AM_I + " model size invalid: " +
+                         str(model.size()) + " != " + str(nlay_ * 2 - 1));
+    }
+    if (!jacobian_) this->initJacobian();
+    RMatrix * J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J) throwError(1, WHERE_AM_I + " Jacobian is not a dense matrix.");
+    rhoaphiDeriv(model(nlay_ - 1, nlay_ * 2 - 1), model(0, nlay_ - 1), *J);
+}
+
+void MT1dRhoModelling::createJacobian(const RVector & rho){
+    if (!jacobian_) this->initJacobian();
+    RMatrix * J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J) throwError(1, WHERE_AM_I + " Jacobian is not a dense matrix.");
+    RMatrix Jfull;
+    rhoaphiDeriv(rho, thk_, Jfull);
+    J->resize(Jfull.rows(), rho.size());
+    for (Index i = 0; i < J->rows(); i ++){
+        (*J)[i] = Jfull[i](thk_.size(), Jfull.cols());
+    }
 }
 
 RVector MT1dModelling::rhoa(const RVector & model){ //! app. res. for thk/res vector
@@ -111,9 +295,33 @@ void FDEM1dModelling::init(){
     double zp = ze_ + zs_;
     RVector rpq(coilspacing_ * coilspacing_ + zp * zp);
     freeAirSolution_ = (rpq - zp * zp * 3.0) / rpq / rpq / sqrt(rpq) / 4.0 / PI;
+    initHankelTable_();
 }
 
-Complex btp(double u, double f, RVector rho, RVector d){
+void FDEM1dModelling::initHankelTable_(){
+    Index n = nfr_ * HANKEL_NC;
+    hankelU_.resize(n);
+    hankelFak_.resize(n);
+    hankelOmegaMu_.resize(n);
+
+    double q = 0.1 * std::log(10.0);
+    double mu0 = 4e-7 * PI;
+    for (Index i = 0; i < nfr_; i ++){
+        for (int ii = 0; ii < HANKEL_NC; ii ++){
+            Index j = i * HANKEL_NC + ii;
+            double ui = std::exp(q * (HANKEL_NC - ii - HANKEL_NC0)) / coilspacing_[i];
+            hankelU_[j] = ui;
+            hankelOmegaMu_[j] = mu0 * 2.0 * PI * freqs_[i];
+            //** free air field, filter weight and normalization in per cent
+            hankelFak_[j] = std::exp(ui * ze_) * std::exp(ui * zs_) * ui * ui
+                            * hankelJ0[HANKEL_NC - ii - 1]
+                            / (PI * 4.0 * coilspacing_[i])
+                            / freeAirSolution_[i] * 100.0;
+        }
+    }
+}
+
+Complex btp(double u, double f, const RVector & rho, const RVector & d){
     size_t nl = rho.size();
     double mu0 = 4e-7 * PI;
     Complex c(0.0, mu0 * 2. * PI * f);
@@ -130,80 +338,257 @@ Complex btp(double u, double f, RVector rho, RVector d){
     return b;
 }
 
-RVector FDEM1dModelling::calc(const RVector & rho, const RVector & thk){
-    double hankelJ0[100]={
-        2.89878288E-07,3.64935144E-07,4.59426126E-07,5.78383226E-07,
-        7.28141338E-07,9.16675639E-07,1.15402625E-06,1.45283298E-06,
-        1.82900834E-06,2.30258511E-06,2.89878286E-06,3.64935148E-06,
-        4.59426119E-06,5.78383236E-06,7.28141322E-06,9.16675664E-06,
-        1.15402621E-05,1.45283305E-05,1.82900824E-05,2.30258527E-05,
-        2.89878259E-05,3.64935186E-05,4.59426051E-05,5.78383329E-05,
-        7.28141144E-05,9.16675882E-05,1.15402573E-04,1.45283354E-04,
-        1.82900694E-04,2.30258630E-04,2.89877891E-04,3.64935362E-04,
-        4.59424960E-04,5.78383437E-04,7.28137738E-04,9.16674828E-04,
-        1.15401453E-03,1.45282561E-03,1.82896826E-03,2.30254535E-03,
-        2.89863979E-03,3.64916703E-03,4.59373308E-03,5.78303238E-03,
-        7.27941497E-03,9.16340705E-03,1.15325691E-02,1.45145832E-02,
-        1.82601199E-02,2.29701042E-02,2.88702619E-02,3.62691810E-02,
-        4.54794031E-02,5.69408192E-02,7.09873072E-02,8.80995426E-02,
-        1.08223889E-01,1.31250483E-01,1.55055715E-01,1.76371506E-01,
-        1.85627738E-01,1.69778044E-01,1.03405245E-01,-3.02583233E-02,
-        -2.27574393E-01,-3.62173217E-01,-2.05500446E-01,3.37394873E-01,
-        3.17689897E-01,-5.13762160E-01,3.09130264E-01,-1.26757592E-01,
-        4.61967890E-02,-1.80968674E-02,8.35426050E-03,-4.47368304E-03,
-        2.61974783E-03,-1.60171357E-03,9.97717882E-04,-6.26275815E-04,
-        3.94338818E-04,-2.48606354E-04,1.56808604E-04,-9.89266288E-05,
-        6.24152398E-05,-3.93805393E-05,2.48472358E-05,-1.56774945E-05,
-        9.89181741E-06,-6.24131160E-06,3.93800058E-06,-2.48471018E-06,
-        1.56774609E-06,-9.89180896E-07,6.24130948E-07,-3.93800005E-07,
-        2.48471005E-07,-1.56774605E-07,9.89180888E-08,-6.24130946E-08};
-
-    //** extract resistivity and thickness
-    RVector inph(nfr_), outph(nfr_);//** inphase and quadrature components
-    int nc = 100, nc0 = 60; // number of coefficients
-    RVector::ValType q=0.1*std::log(10.0);
-    for (size_t i = 0 ; i < nfr_ ; i++) {
-        Complex aux(0.0, 0.0);
-        for (int ii = 0 ; ii < nc ; ii++) {
-            RVector::ValType ui=std::exp(q * (nc - ii - nc0)) / coilspacing_[i];
-            Complex bti(btp(ui, freqs_[i], rho, thk));
-            Complex delta((bti - ui) / (bti + ui) * std::exp(ui * ze_) * std::exp(ui * zs_));
-            aux += delta * ui * ui * hankelJ0[nc - ii - 1];
+/*! btp and its derivatives db with respect to [d, rho] */
+Complex btpDeriv(double u, double f, const RVector & rho, const RVector & d,
+                 CVector & db){
+    Index nl = rho.size();
+    Index nPar = nl * 2 - 1;
+    double mu0 = 4e-7 * PI;
+    Complex c(0.0, mu0 * 2. * PI * f);
+
+    db.resize(nPar);
+    db *= Complex(0.0);
+    Complex b(std::sqrt(c / rho[nl-1] + u*u));
+    db[nPar - 1] = -c / (rho[nl - 1] * rho[nl - 1] * 2.0 * b);
+
+    for (int nn = nl - 2; nn >= 0 ; nn--){
+        Complex alpha(std::sqrt(c / rho[nn] + u*u));
+        Complex cth(std::exp(alpha * d[nn] * -2.0));
+        cth = (Complex(1.0) - cth) / (cth + 1.0);
+        Complex N(alpha * cth + b);
+        Complex D(cth * b / alpha + 1.0);
+
+        //** d bNew / d b, d cth, d alpha (cth fixed)
+        Complex dbdb((Complex(1.0) - cth * cth) / (D * D));
+        Complex dbdc((alpha - b * b / alpha) / (D * D));
+        Complex dbda((cth * D + N * cth * b / (alpha * alpha)) / (D * D));
+        Complex dcdx(Complex(1.0) - cth * cth); // d tanh(x) / d x
+        Complex dadr(-c / (rho[nn] * rho[nn] * 2.0 * alpha));
+
+        for (Index p = nn + 1; p < nl - 1; p ++) db[p] *= dbdb;
+        for (Index p = nl + nn; p < nPar; p ++) db[p] *= dbdb;
+        db[nn] = dbdc * dcdx * alpha;
+        db[nl - 1 + nn] = (dbdc * dcdx * d[nn] + dbda) * dadr;
+        b = N / D;
+    }
+    return b;
+}
+
+void FDEM1dModelling::calcDeriv(const RVector & rho, const RVector & thk,
+                                RMatrix & J){
+    Index nPar = rho.size() * 2 - 1;
+    J.resize(nfr_ * 2, nPar);
+
+    CVector db, daux(nPar);
+    for (Index i = 0 ; i < nfr_ ; i++) {
+        daux *= Complex(0.0);
+        for (Index j = i * HANKEL_NC; j < (i + 1) * HANKEL_NC; j ++) {
+            double ui = hankelU_[j];
+            Complex bti(btpDeriv(ui, freqs_[i], rho, thk, db));
+            Complex fak(hankelFak_[j] * 2.0 * ui / ((bti + ui) * (bti + ui)));
+            for (Index p = 0; p < nPar; p ++) daux[p] += db[p] * fak;
         }
+        for (Index p = 0; p < nPar; p ++) {
+            J[i][p] = real(daux[p]);
+            J[i + nfr_][p] = imag(daux[p]);
+        }
+    }
+}
+
+void FDEM1dModelling::createJacobian(const RVector & model){
+    if (model.size() != nlay_ * 2 - 1){
+        throwLengthError(1, WHERE_AM_I + " model size invalid: " +
+                         str(model.size()) + " != " + str(nlay_ * 2 - 1));
+    }
+    if (!jacobian_) this->initJacobian();
+    RMatrix * J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J) throwError(1, WHERE_AM_I + " Jacobian is not a dense matrix.");
+    calcDeriv(model(nlay_ - 1, nlay_ * 2 - 1), model(0, nlay_ - 1), *J);
+}
+
+void FDEM1dRhoModelling::createJacobian(const RVector & rho){
+    if (!jacobian_) this->initJacobian();
+    RMatrix * J = dynamic_cast< RMatrix * >(jacobian_);
+    if (!J) throwError(1, WHERE_AM_I + " Jacobian is not a dense matrix.");
+    RMatrix Jfull;
+    calcDeriv(rho, thk_, Jfull);
+    J->resize(Jfull.rows(), rho.size());
+    for (Index i = 0; i < J->rows(); i ++){
+        (*J)[i] = Jfull[i](thk_.size(), Jfull.cols());
+    }
+}
 
-        aux /= PI * 4.0 * coilspacing_[i];
-        // normalize by free air solution in per cent
-        inph[i]  = real(aux) / freeAirSolution_[i] * 100.0;
-        outph[i] = imag(aux) / freeAirSolution_[i] * 100.0;
+RVector FDEM1dModelling::calc(const RVector & rho, const RVector & thk) const {
+    Index nl = rho.size();
+    Index n = hankelU_.size();
+
+    //** recursion for all frequencies and filter points at once
+    CVector b(n);
+    for (Index j = 0; j < n; j ++){
+        b[j] = std::sqrt(Complex(hankelU_[j] * hankelU_[j],
+                                 hankelOmegaMu_[j] / rho[nl - 1]));
+    }
+    for (int nn = nl - 2; nn >= 0 ; nn--){
+        double r = rho[nn];
+        double d2 = thk[nn] * -2.0;
+        for (Index j = 0; j < n; j ++){
+            Complex alpha(std::sqrt(Complex(hankelU_[j] * hankelU_[j],
+                                            hankelOmegaMu_[j] / r)));
+            Complex cth(std::exp(alpha * d2));
+            cth = (1.0 - cth) / (cth + 1.0);
+            b[j] = (alpha * cth + b[j]) / (cth * b[j] / alpha + 1.0);
+        }
+    }
+
+    //** inphase and quadrature components normalized by the free air solution
+    RVector inph(nfr_), outph(nfr_);
+    for (Index i = 0 ; i < nfr_ ; i++) {
+        Complex aux(0.0, 0.0);
+        for (Index j = i * HANKEL_NC; j < (i + 1) * HANKEL_NC; j ++) {
+            aux += (b[j] - hankelU_[j]) / (b[j] + hankelU_[j]) * hankelFak_[j];
+        }
+        inph[i]  = real(aux);
+        outph[i] = imag(aux);
     }
-    //** paste together both components and
     return cat(inph, outph);
 }
 
+RVector FDEM1dModelling::response_mt(const RVector & model, Index i) const {
+    RVector thk(model, 0, nlay_ - 1), rho(model, nlay_ - 1, 2 * nlay_ - 1);
+    return calc(rho, thk);
+}
+
 RVector FDEM1dModelling::response(const RVector & model){
     RVector thk(model, 0, nlay_ - 1), rho(model, nlay_ - 1, 2 * nlay_ - 1);
     return calc(rho, thk);
 }
 
-RVector MRSModelling::response(const RVector & model) {
-    RVector outreal(*KR_ * model);
-    RVector outimag(*KI_ * model);
-    return RVector(sqrt(outreal * outreal + outimag * outimag));
+/*! Amplitude of one complex kernel row (real and imaginary parts every
+ * step values) and, if Jrow is given, its derivatives. */
+template < class T > inline double mrsRow(const T * re, const T * im, Index step,
+                                          const RVector & model, double * Jrow){
+    Index n = model.size();
+    double sr = 0.0, si = 0.0;
+    for (Index j = 0; j < n; j ++){
+        sr += re[j * step] * model[j];
+        si += im[j * step] * model[j];
+    }
+    double amp = std::sqrt(sr * sr + si * si);
+    if (Jrow){
+        double fr = 0.0, fi = 0.0;
+        if (amp > 0.0) { fr = sr / amp; fi = si / amp; }
+        for (Index j = 0; j < n; j ++){
+            Jrow[j] = re[j * step] * fr + im[j * step] * fi;
+        }
+    }
+    return amp;
 }
 
-void MRSModelling::createJacobian(const RVector & model) {
-    RVector ddr(*KR_ * model);
-    RVector ddi(*KI_ * model);
-    RVector dda(sqrt(ddr * ddr + ddi * ddi));
+/*! Amplitudes and Jacobian of rows [start, end) of the kernel given by
+ * the real and imaginary matrices. */
+static void mrsAmplitude(const RMatrix & KR, const RMatrix & KI,
+                         const RVector & model, RVector & amp, RMatrix * J,
+                         Index start, Index end){
+    for (Index i = start; i < end; i ++){
+        amp[i] = mrsRow(&KR[i][0], &KI[i][0], 1, model, J ? &(*J)[i][0] : 0);
+    }
+}
 
-    RMatrix * jacobian = dynamic_cast < RMatrix * >(jacobian_);
-    jacobian->resize(dda.size(), model.size());
+MRSKernel::MRSKernel(const RMatrix & KR, const RMatrix & KI, bool singlePrecision)
+    : rows_(KR.rows()), cols_(KR.cols()), single_(singlePrecision){
+    if (KI.rows() != rows_ || KI.cols() != cols_){
+        throwLengthError(1, WHERE_AM_I + " real and imaginary kernel sizes differ.");
+    }
+    if (single_) valsF_.resize(rows_ * cols_ * 2);
+    else valsD_.resize(rows_ * cols_ * 2);
+
+    for (Index i = 0; i < rows_; i ++){
+        for (Index j = 0; j < cols_; j ++){
+            Index k = (i * cols_ + j) * 2;
+            if (single_) {
+                valsF_[k] = (float)KR[i][j];
+                valsF_[k + 1] = (float)KI[i][j];
+            } else {
+                valsD_[k] = KR[i][j];
+                valsD_[k + 1] = KI[i][j];
+            }
+        }
+    }
+}
 
-    for (size_t i = 0 ; i < KR_->rows() ; i++) {
-        (*jacobian)[i] = ((*KR_)[i] * ddr[i] + (*KI_)[i] * ddi[i]) / dda[i];
+void MRSKernel::amplitude(const RVector & model, RVector & amp, RMatrix * J,
+                          Index start, Index end) const {
+    for (Index i = start; i < end; i ++){
+        double * Jrow = J ? &(*J)[i][0] : 0;
+        Index k = i * cols_ * 2;
+        if (single_) amp[i] = mrsRow(&valsF_[k], &valsF_[k + 1], 2, model, Jrow);
+        else amp[i] = mrsRow(&valsD_[k], &valsD_[k + 1], 2, model, Jrow);
     }
 }
 
+class MRSAmplitudeMT : public BaseCalcMT{
+public:
+    MRSAmplitudeMT(const MRSKernel * kernel, const RMatrix * KR, const RMatrix * KI,
+                   const RVector & model, RVector & amp, RMatrix * J, bool verbose)
+    : BaseCalcMT(1, verbose), kernel_(kernel), KR_(KR), KI_(KI),
+      model_(&model), amp_(&amp), J_(J){ }
+
+    virtual ~MRSAmplitudeMT(){}
+
+    virtual void calc(Index tNr=0){
+        if (kernel_) kernel_->amplitude(*model_, *amp_, J_, start_, end_);
+        else mrsAmplitude(*KR_, *KI_, *model_, *amp_, J_, start_, end_);
+    }
+
+protected:
+    const MRSKernel * kernel_;
+    const RMatrix   * KR_;
+    const RMatrix   * KI_;
+    const RVector   * model_;
+    RVector         * amp_;
+    RMatrix         * J_;
+};
+
+void MRSKernel::amplitude(const RVector & model, RVector & amp, RMatrix * J,
+                          Index nThreads) const {
+    if (model.size() != cols_){
+        throwLengthError(1, WHERE_AM_I + " model size invalid: " +
+                         str(model.size()) + " != " + str(cols_));
+    }
+    amp.resize(rows_);
+    if (J) J->resize(rows_, cols_);
+    distributeCalc(MRSAmplitudeMT(this, 0, 0, model, amp, J, false), rows_,
+                   max((Index)1, min(nThreads, rows_)), false);
+}
+
+void MRSModelling::amplitude_(const RVector & model, RVector & amp, RMatrix * J) const {
+    if (kernel_) {
+        kernel_->amplitude(model, amp, J, nThreads_);
+        return;
+    }
+    if (model.size() != KR_->cols()){
+        throwLengthError(1, WHERE_AM_I + " model size invalid: " +
+                         str(model.size()) + " != " + str(KR_->cols()));
+    }
+    amp.resize(KR_->rows());
+    if (J) J->resize(KR_->rows(), KR_->cols());
+    distributeCalc(MRSAmplitudeMT(0, KR_, KI_, model, amp, J, verbose_),
+                   KR_->rows(), max((Index)1, min(nThreads_, KR_->rows())), verbose_);
+}
+
+RVector MRSModelling::response(const RVector & model) {
+    RVector amp;
+    amplitude_(model, amp, 0);
+    return amp;
+}
+
+void MRSModelling::createJacobian(const RVector & model) {
+    if (!jacobian_) this->initJacobian();
+    RMatrix * jacobian = dynamic_cast < RMatrix * >(jacobian_);
+    RVector amp;
+    amplitude_(model, amp, jacobian);
+}
+
 RVector MRS1dBlockModelling::response(const RVector & model){
         //! extract water content and thickness from model vector
         RVector wc(model, nlay_ - 1 , nlay_ * 2 - 1);
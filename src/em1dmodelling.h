@@ -55,7 +55,28 @@ public:
     /*! the actual (full) forward operator returning app.res.+phase for thickness+resistivity */
     virtual RVector response(const RVector & model);
 
+    /*! Read only response, see \ref response. */
+    virtual RVector response_mt(const RVector & model, Index i=0) const;
+
+    /*! Responses for many soundings (e.g., the stations of a 2D/3D survey
+     * for quasi-1D inversion), one model [thk, rho] per row, calculated
+     * in nThreads threads. Returns one response per row. */
+    RMatrix responses(const RMatrix & models, Index nThreads=1) const;
+
+    using ModellingBase::responses;
+
+    /*! Analytical derivatives of app. res. and phase with respect to
+     * [thk, rho] by differentiation of the impedance recursion. */
+    void rhoaphiDeriv(const RVector & rho, const RVector & thk, RMatrix & J);
+
+    /*! Analytical Jacobian, see \ref rhoaphiDeriv. */
+    virtual void createJacobian(const RVector & model);
+
 protected:
+    /*! app. res. and phase for all periods at once */
+    void rhoaphi_(const RVector & rho, const RVector & thk,
+                  double * rhoa, double * phi) const;
+
     RVector periods_;
     size_t nlay_;
 };
@@ -78,8 +99,17 @@ public:
 
     virtual RVector response(const RVector & rho) { return rhoaphi(rho, thk_); }
 
+    virtual RVector response_mt(const RVector & rho, Index i=0) const {
+        RVector ret(periods_.size() * 2);
+        if (periods_.size() > 0) rhoaphi_(rho, thk_, &ret[0], &ret[periods_.size()]);
+        return ret;
+    }
+
     virtual RVector rhoa(const RVector & rho) { return MT1dModelling::rhoa(rho, thk_); }
 
+    /*! Analytical Jacobian for the resistivities only. */
+    virtual void createJacobian(const RVector & rho);
+
 protected:
     RVector thk_;
 };
@@ -108,8 +138,20 @@ public:
      * instance construction. */
     const RVector & freeAirSolution() const { return freeAirSolution_; }
 
-    RVector calc(const RVector & rho, const RVector & thk);
+    /*! Inphase and quadrature (in per cent of the free air solution) for
+     * all frequencies. The recursion runs over all frequencies and filter
+     * points at once using the tables built by \ref init. Read only, so
+     * many models can be calculated concurrently via \ref responses. */
+    RVector calc(const RVector & rho, const RVector & thk) const;
+
+    virtual RVector response_mt(const RVector & model, Index i=0) const;
 
+    /*! Analytical derivatives of inphase and quadrature with respect to
+     * [thk, rho] by differentiation of the btp recursion. */
+    void calcDeriv(const RVector & rho, const RVector & thk, RMatrix & J);
+
+    /*! Analytical Jacobian, see \ref calcDeriv. */
+    virtual void createJacobian(const RVector & model);
 
 protected:
     size_t nlay_;
@@ -118,6 +160,14 @@ protected:
     double zs_, ze_; // transmitter&receiver heights (minus)
     size_t nfr_;
     RVector freeAirSolution_;
+
+    /*! Per system Hankel tables of size nFreqs x 100 filter points:
+     * wave numbers, i omega mu0 and the model independent factor
+     * (source/receiver heights, filter weight, free air normalization). */
+    void initHankelTable_();
+    RVector hankelU_;
+    RVector hankelOmegaMu_;
+    RVector hankelFak_;
 };
 
 //class MaxMinModelling:FDEMModelling
@@ -143,10 +193,48 @@ public:
 
     RVector response(const RVector & model){ return calc(model, thk_); }
 
+    virtual RVector response_mt(const RVector & model, Index i=0) const {
+        return calc(model, thk_);
+    }
+
+    /*! Analytical Jacobian for the resistivities only. */
+    virtual void createJacobian(const RVector & rho);
+
 protected:
     RVector thk_;
 };
 
+//! Complex MRS kernel
+/*! Complex MRS kernel with interleaved real and imaginary parts per row,
+ * optionally stored in single precision for large 2D/3D kernels.
+ * Sums are accumulated in double. */
+class DLLEXPORT MRSKernel {
+public:
+    MRSKernel(const RMatrix & KR, const RMatrix & KI, bool singlePrecision=false);
+
+    inline Index rows() const { return rows_; }
+
+    inline Index cols() const { return cols_; }
+
+    inline bool singlePrecision() const { return single_; }
+
+    /*! Amplitudes |(KR + i KI) model| and, if J is given, their Jacobian in
+     * one pass over each kernel row, threaded over the rows. */
+    void amplitude(const RVector & model, RVector & amp, RMatrix * J=0,
+                   Index nThreads=1) const;
+
+    /*! Used by the threads of amplitude, rows [start, end). */
+    void amplitude(const RVector & model, RVector & amp, RMatrix * J,
+                   Index start, Index end) const;
+
+protected:
+    Index rows_;
+    Index cols_;
+    bool single_;
+    std::vector < double > valsD_;
+    std::vector < float > valsF_;
+};
+
 /*! Magnetic Resonance Sounding (MRS) modelling */
 /*! classical variant using a fixed parameterization */
 /*! MRSModelling([mesh,] RMatrix KR, KI [, verbose]) */
@@ -154,10 +242,16 @@ class DLLEXPORT MRSModelling : public ModellingBase {
 public:
     //! constructor using a predefined mesh and real/imag matrix
     MRSModelling(Mesh & mesh, RMatrix & KR, RMatrix & KI, bool verbose = false) :
-            ModellingBase(mesh, verbose), KR_(&KR), KI_(&KI) { }
+            ModellingBase(mesh, verbose), KR_(&KR), KI_(&KI), kernel_(0) { }
     //! constructor with real/imag matrix only
     MRSModelling(RMatrix & KR, RMatrix & KI, bool verbose = false) :
-            ModellingBase(verbose), KR_(&KR), KI_(&KI) { }
+            ModellingBase(verbose), KR_(&KR), KI_(&KI), kernel_(0) { }
+    //! constructor using a predefined mesh and a complex kernel
+    MRSModelling(Mesh & mesh, const MRSKernel & kernel, bool verbose = false) :
+            ModellingBase(mesh, verbose), KR_(0), KI_(0), kernel_(&kernel) { }
+    //! constructor with a complex kernel only
+    MRSModelling(const MRSKernel & kernel, bool verbose = false) :
+            ModellingBase(verbose), KR_(0), KI_(0), kernel_(&kernel) { }
     //! destructor
     virtual ~MRSModelling() { }
 
@@ -168,7 +262,11 @@ public:
     void createJacobian(const RVector & model);
 
 protected:
+    /*! Amplitude and Jacobian in one pass, threaded over the rows. */
+    void amplitude_(const RVector & model, RVector & amp, RMatrix * J) const;
+
     RMatrix *KR_, *KI_;
+    const MRSKernel * kernel_;
 };
 
 /*! Magnetic Resonance Sounding (MRS) modelling
@@ -38,6 +38,7 @@ namespace GIMLI{
 static bool __SAVE_PYTHON_GIL__ = false;
 static bool __GIMLI_DEBUG__ = false;
 static Index __GIMLI_THREADCOUNT__ = numberOfCPU();
+static thread_local bool __GIMLI_WORKER_THREAD__ = false;
 
 // //** end forward declaration
 // // static here gives every .cpp its own static bool
@@ -62,6 +63,9 @@ Index threadCount(){
     return __GIMLI_THREADCOUNT__;
 }
 
+void setWorkerThread(bool is){ __GIMLI_WORKER_THREAD__ = is; }
+bool workerThread(){ return __GIMLI_WORKER_THREAD__; }
+
 
 void PythonGILSave::save() {
     if (!saved_) {
@@ -205,6 +205,7 @@ static const uint8 GIMLI_MATRIXBASE_RTTI        = 0;
 static const uint8 GIMLI_MATRIX_RTTI            = 1;
 static const uint8 GIMLI_SPARSEMAPMATRIX_RTTI   = 2;
 static const uint8 GIMLI_BLOCKMATRIX_RTTI       = 3;
+static const uint8 GIMLI_SPARSEROWMATRIX_RTTI   = 4;
 
 /*! Flag load/save Ascii or binary */
 enum IOFormat{Ascii, Binary};
@@ -223,6 +224,7 @@ class Plane;
 class Region;
 class RegionManager;
 class Shape;
+class SparseRowMatrix;
 class Stopwatch;
 
 template < class ValueType > class Pos;
@@ -292,6 +294,11 @@ Default is number of CPU. */
 DLLEXPORT void setThreadCount(Index nThreads);
 DLLEXPORT Index threadCount();
 
+/*! Mark the calling thread as a worker of \ref distributeCalc. Workers do
+not spawn further threads for the vector operations. */
+DLLEXPORT void setWorkerThread(bool is);
+DLLEXPORT bool workerThread();
+
 /*! For some debug purposes only */
 DLLEXPORT void showSizes();
 
@@ -19,38 +19,564 @@
 
 #include "gravimetry.h"
 
+#include "calculateMultiThread.h"
+#include "datacontainer.h"
 #include "integration.h"
 #include "mesh.h"
 #include "pos.h"
 #include "shape.h"
+#include "stopwatch.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace GIMLI {
 
-GravimetryModelling::GravimetryModelling( Mesh & mesh, DataContainer & dataContainer, bool verbose ){
+static const double GRAVITY_CONSTANT_MGAL = 6.67384e-11 * 1e5;
+
+void FloatDenseMatrix::setRow( Index i, const RVector & row ){
+    if ( row.size() != cols_ ) {
+        throwLengthError( 1, WHERE_AM_I + " " + str( row.size() ) + " != " + str( cols_ ) );
+    }
+    float * r = &vals_[ i * cols_ ];
+    for ( Index j = 0; j < cols_; j ++ ) r[ j ] = (float)row[ j ];
+}
+
+RVector FloatDenseMatrix::mult( const RVector & b ) const {
+    if ( b.size() != cols_ ) {
+        throwLengthError( 1, WHERE_AM_I + " " + str( b.size() ) + " != " + str( cols_ ) );
+    }
+    RVector ret( rows_, 0.0 );
+    for ( Index i = 0; i < rows_; i ++ ){
+        const float * r = &vals_[ i * cols_ ];
+        double sum = 0.0;
+        for ( Index j = 0; j < cols_; j ++ ) sum += r[ j ] * b[ j ];
+        ret[ i ] = sum;
+    }
+    return ret;
+}
+
+RVector FloatDenseMatrix::transMult( const RVector & b ) const {
+    if ( b.size() != rows_ ) {
+        throwLengthError( 1, WHERE_AM_I + " " + str( b.size() ) + " != " + str( rows_ ) );
+    }
+    RVector ret( cols_, 0.0 );
+    for ( Index i = 0; i < rows_; i ++ ){
+        const float * r = &vals_[ i * cols_ ];
+        double bi = b[ i ];
+        for ( Index j = 0; j < cols_; j ++ ) ret[ j ] += r[ j ] * bi;
+    }
+    return ret;
+}
+
+GravimetryModelling::GravimetryModelling( Mesh & mesh, DataContainer & dataContainer, bool verbose )
+    : ModellingBase( dataContainer, verbose ), kernel_( NULL ), singlePrecision_( false ),
+      treeAccuracy_( 0.0 ){
+    setMesh( mesh );
+}
+
+GravimetryModelling::~GravimetryModelling(){
+    deleteKernel_( );
+}
+
+void GravimetryModelling::deleteKernel_( ){
+    if ( kernel_ ) {
+        if ( jacobian_ == kernel_ ) jacobian_ = NULL;
+        delete kernel_;
+        kernel_ = NULL;
+    }
+}
+
+void GravimetryModelling::setSinglePrecision( bool single ){
+    if ( single != singlePrecision_ ) deleteKernel_( );
+    singlePrecision_ = single;
+}
+
+void GravimetryModelling::setTreeCode( double accuracy ){
+    if ( accuracy != treeAccuracy_ ) deleteKernel_( );
+    treeAccuracy_ = max( 0.0, accuracy );
 }
 
 RVector GravimetryModelling::createDefaultStartModel( ){
-    RVector ret;
-    THROW_TO_IMPL
+    return RVector( regionManager().parameterCount( ), 0.0 );
+}
+
+/*! Exact kernel of one cell for unit density. */
+static double cellKernel( const Cell & c, const RVector3 & pos, Index dim ){
+    if ( dim == 2 ){
+        // positive for excess mass below the station
+        double Z = 0.0, area2 = 0.0;
+        Index nn = c.nodeCount( );
+        for ( Index j = 0; j < nn; j ++ ){
+            const RVector3 & p1 = c.node( j ).pos( );
+            const RVector3 & p2 = c.node( ( j + 1 ) % nn ).pos( );
+            Z -= 2.0 * lineIntegraldGdz( p1 - pos, p2 - pos );
+            area2 += p1[ 0 ] * p2[ 1 ] - p2[ 0 ] * p1[ 1 ];
+        }
+        // the line integrals assume counterclockwise cells
+        if ( area2 < 0.0 ) Z = -Z;
+        return Z * GRAVITY_CONSTANT_MGAL;
+    }
+    double size = c.shape( ).domainSize( );
+    if ( size == 0.0 ) return 0.0;
+    RVector3 d( pos - c.center( ) );
+    double r = d.abs( );
+    // inside the sphere of equal volume the field decreases linearly to the center
+    double r3 = max( r * r * r, 3.0 * size / ( 4.0 * PI ) );
+    return size * d[ 2 ] / r3 * GRAVITY_CONSTANT_MGAL;
+}
+
+void GravimetryModelling::kernelRow( const RVector3 & pos, RVector & row ) const {
+    const Mesh & mesh = *mesh_;
+    row.resize( mesh.cellCount( ) );
+    for ( Index i = 0; i < mesh.cellCount( ); i ++ ){
+        row[ i ] = cellKernel( mesh.cell( i ), pos, mesh.dim( ) );
+    }
+}
+
+//! Hierarchical (kd-tree) clustering of point sources with multipoles
+/*! Sources are points with an extent (radius). The multipoles of every
+ * node refer to the node center: cartesian up to quadrupole in 3D
+ * (z up) and complex moments up to a given order in 2D (y up). */
+class PotentialFieldTree {
+public:
+    struct Node {
+        Index begin, end;
+        SIndex left, right;
+        RVector3 center;
+        double radius;
+        double srcRadius;
+    };
+
+    PotentialFieldTree( const std::vector< RVector3 > & pos, const RVector & radius,
+                        Index dim, Index order, Index leafSize )
+        : pos_( pos ), dim_( dim ), order_( order ), leafSize_( max( (Index)1, leafSize ) ){
+        nMom_ = ( dim_ == 2 ) ? 2 * ( order_ + 1 ) : 10;
+        perm_.resize( pos.size( ) );
+        for ( Index i = 0; i < perm_.size( ); i ++ ) perm_[ i ] = i;
+        if ( pos.size( ) > 0 ) build_( 0, pos.size( ), radius );
+    }
+
+    /*! Multipole moments for all nodes for source weights w. */
+    void moments( const RVector & w, std::vector< double > & mom ) const {
+        mom.assign( nodes_.size( ) * nMom_, 0.0 );
+        for ( Index n = 0; n < nodes_.size( ); n ++ ){
+            const Node & node = nodes_[ n ];
+            double * m = &mom[ n * nMom_ ];
+            for ( Index k = node.begin; k < node.end; k ++ ){
+                Index i = perm_[ k ];
+                double wi = w[ i ];
+                if ( wi == 0.0 ) continue;
+                RVector3 r( pos_[ i ] - node.center );
+                if ( dim_ == 2 ){
+                    Complex rc( r[ 0 ], r[ 1 ] ), pw( wi, 0.0 );
+                    for ( Index o = 0; o <= order_; o ++ ){
+                        m[ 2 * o ] += pw.real( );
+                        m[ 2 * o + 1 ] += pw.imag( );
+                        pw *= rc;
+                    }
+                } else {
+                    double r2 = r.distSquared( );
+                    m[ 0 ] += wi;
+                    m[ 1 ] += wi * r[ 0 ]; m[ 2 ] += wi * r[ 1 ]; m[ 3 ] += wi * r[ 2 ];
+                    m[ 4 ] += wi * ( 3.0 * r[ 0 ] * r[ 0 ] - r2 );
+                    m[ 5 ] += wi * ( 3.0 * r[ 1 ] * r[ 1 ] - r2 );
+                    m[ 6 ] += wi * ( 3.0 * r[ 2 ] * r[ 2 ] - r2 );
+                    m[ 7 ] += wi * 3.0 * r[ 0 ] * r[ 1 ];
+                    m[ 8 ] += wi * 3.0 * r[ 0 ] * r[ 2 ];
+                    m[ 9 ] += wi * 3.0 * r[ 1 ] * r[ 2 ];
+                }
+            }
+        }
+    }
+
+    /*! Vertical field at t (extent tRadius) from all sources. Nodes with
+     * (node radius + tRadius) < theta * distance and
+     * (largest source radius + tRadius) < eta * distance are taken from the
+     * multipoles (treating single sources as points), all others from
+     * near(sourceIndex). */
+    template < class Near > double eval( const RVector3 & t, double tRadius, double theta, double eta,
+                                         const std::vector< double > & mom, Near & near ) const {
+        double sum = 0.0;
+        if ( nodes_.empty( ) ) return sum;
+        std::vector< Index > stack( 1, 0 );
+        while ( !stack.empty( ) ){
+            Index n = stack.back( );
+            stack.pop_back( );
+            const Node & node = nodes_[ n ];
+            RVector3 d( t - node.center );
+            double dist = d.abs( );
+            if ( node.radius + tRadius < theta * dist && node.srcRadius + tRadius < eta * dist ){
+                sum += farField_( d, &mom[ n * nMom_ ] );
+            } else if ( node.left < 0 ){
+                for ( Index k = node.begin; k < node.end; k ++ ) sum += near( perm_[ k ] );
+            } else {
+                stack.push_back( node.left );
+                stack.push_back( node.right );
+            }
+        }
+        return sum;
+    }
+
+protected:
+    Index build_( Index begin, Index end, const RVector & radius ){
+        RVector3 pMin( pos_[ perm_[ begin ] ] ), pMax( pMin );
+        for ( Index k = begin; k < end; k ++ ){
+            const RVector3 & p = pos_[ perm_[ k ] ];
+            for ( Index j = 0; j < 3; j ++ ){
+                pMin[ j ] = min( pMin[ j ], p[ j ] );
+                pMax[ j ] = max( pMax[ j ], p[ j ] );
+            }
+        }
+        Node node;
+        node.begin = begin;
+        node.end = end;
+        node.left = -1;
+        node.right = -1;
+        node.center = ( pMin + pMax ) / 2.0;
+        node.radius = 0.0;
+        node.srcRadius = 0.0;
+        for ( Index k = begin; k < end; k ++ ){
+            node.radius = max( node.radius, pos_[ perm_[ k ] ].dist( node.center ) + radius[ perm_[ k ] ] );
+            node.srcRadius = max( node.srcRadius, radius[ perm_[ k ] ] );
+        }
+        Index id = nodes_.size( );
+        nodes_.push_back( node );
+
+        if ( end - begin > leafSize_ ){
+            RVector3 ext( pMax - pMin );
+            Index axis = 0;
+            for ( Index j = 1; j < 3; j ++ ) if ( ext[ j ] > ext[ axis ] ) axis = j;
+            Index mid = ( begin + end ) / 2;
+            std::nth_element( perm_.begin( ) + begin, perm_.begin( ) + mid, perm_.begin( ) + end,
+                              AxisLess_( pos_, axis ) );
+            SIndex left = build_( begin, mid, radius );
+            SIndex right = build_( mid, end, radius );
+            nodes_[ id ].left = left;
+            nodes_[ id ].right = right;
+        }
+        return id;
+    }
+
+    double farField_( const RVector3 & d, const double * m ) const {
+        if ( dim_ == 2 ){
+            // gz = -Im( 2G sum_k a_k / d^(k+1) )
+            Complex inv( 1.0 / Complex( d[ 0 ], d[ 1 ] ) ), pw( inv ), sum( 0.0, 0.0 );
+            for ( Index o = 0; o <= order_; o ++ ){
+                sum += Complex( m[ 2 * o ], m[ 2 * o + 1 ] ) * pw;
+                pw *= inv;
+            }
+            return -2.0 * sum.imag( ) * GRAVITY_CONSTANT_MGAL;
+        }
+        double r2 = d.distSquared( ), r = std::sqrt( r2 );
+        double r3 = r2 * r, r5 = r3 * r2, r7 = r5 * r2;
+        double Dd = m[ 1 ] * d[ 0 ] + m[ 2 ] * d[ 1 ] + m[ 3 ] * d[ 2 ];
+        double Qdx = m[ 4 ] * d[ 0 ] + m[ 7 ] * d[ 1 ] + m[ 8 ] * d[ 2 ];
+        double Qdy = m[ 7 ] * d[ 0 ] + m[ 5 ] * d[ 1 ] + m[ 9 ] * d[ 2 ];
+        double Qdz = m[ 8 ] * d[ 0 ] + m[ 9 ] * d[ 1 ] + m[ 6 ] * d[ 2 ];
+        double dQd = Qdx * d[ 0 ] + Qdy * d[ 1 ] + Qdz * d[ 2 ];
+        return ( m[ 0 ] * d[ 2 ] / r3 - m[ 3 ] / r3 + 3.0 * Dd * d[ 2 ] / r5
+                 - Qdz / r5 + 2.5 * dQd * d[ 2 ] / r7 ) * GRAVITY_CONSTANT_MGAL;
+    }
+
+    struct AxisLess_ {
+        AxisLess_( const std::vector< RVector3 > & pos, Index axis ) : pos_( &pos ), axis_( axis ){}
+        bool operator()( Index a, Index b ) const { return ( *pos_ )[ a ][ axis_ ] < ( *pos_ )[ b ][ axis_ ]; }
+        const std::vector< RVector3 > * pos_;
+        Index axis_;
+    };
+
+    std::vector< RVector3 > pos_;
+    Index dim_;
+    Index order_;
+    Index leafSize_;
+    Index nMom_;
+    std::vector< Node > nodes_;
+    std::vector< Index > perm_;
+};
+
+GravimetryTreeOperator::GravimetryTreeOperator( const Mesh & mesh, const std::vector< RVector3 > & stations,
+                                                double accuracy, Index nThreads, bool verbose )
+    : MatrixBase( verbose ), mesh_( &mesh ), stations_( stations ), nThreads_( max( (Index)1, nThreads ) ){
+
+    dim_ = mesh.dim( ) == 2 ? 2 : 3;
+    accuracy = max( 1e-12, accuracy );
+    if ( dim_ == 2 ){
+        //** fixed acceptance, the order of the complex expansion gives the accuracy
+        theta_ = 0.5;
+        order_ = (Index)min( 40.0, max( 2.0, std::ceil( std::log( accuracy ) / std::log( theta_ ) ) ) );
+        //** polygons are expanded as line masses, their shape error is ~ (radius / distance)^2
+        eta_ = std::sqrt( accuracy );
+    } else {
+        //** quadrupole expansion, truncation error ~ theta^3,
+        //** the exact cell kernel is a point mass too
+        order_ = 2;
+        theta_ = min( 0.8, max( 0.1, 2.0 * std::pow( accuracy, 1.0 / 3.0 ) ) );
+        eta_ = MAX_DOUBLE;
+    }
+
+    Index nCells = mesh.cellCount( );
+    cellCenter_.resize( nCells );
+    cellRadius_.resize( nCells );
+    cellSize_.resize( nCells );
+    for ( Index i = 0; i < nCells; i ++ ){
+        const Cell & c = mesh.cell( i );
+        cellCenter_[ i ] = c.center( );
+        cellSize_[ i ] = c.shape( ).domainSize( );
+        double r = 0.0;
+        for ( Index j = 0; j < c.nodeCount( ); j ++ ) r = max( r, c.node( j ).pos( ).dist( cellCenter_[ i ] ) );
+        cellRadius_[ i ] = r;
+    }
+
+    Stopwatch swatch( true );
+    cellTree_ = new PotentialFieldTree( cellCenter_, cellRadius_, dim_, order_, 16 );
+    stationTree_ = new PotentialFieldTree( stations_, RVector( stations_.size( ), 0.0 ), dim_, order_, 16 );
+    if ( verbose_ ) std::cout << "Gravimetry tree code: theta = " << theta_ << " order = " << order_
+                              << " (" << swatch.duration( ) << " s)" << std::endl;
+}
+
+GravimetryTreeOperator::~GravimetryTreeOperator( ){
+    delete cellTree_;
+    delete stationTree_;
+}
+
+struct TreeCellNear {
+    TreeCellNear( const Mesh & mesh, const RVector & density, const RVector3 & pos )
+        : mesh_( &mesh ), density_( &density ), pos_( &pos ){}
+    double operator()( Index c ){
+        double rho = ( *density_ )[ c ];
+        if ( rho == 0.0 ) return 0.0;
+        return rho * cellKernel( mesh_->cell( c ), *pos_, mesh_->dim( ) );
+    }
+    const Mesh * mesh_;
+    const RVector * density_;
+    const RVector3 * pos_;
+};
+
+struct TreeStationNear {
+    TreeStationNear( const Mesh & mesh, const std::vector< RVector3 > & stations, const RVector & b,
+                     Index cell, double scale )
+        : mesh_( &mesh ), stations_( &stations ), b_( &b ), cell_( cell ), scale_( scale ){}
+    double operator()( Index s ){
+        double bs = ( *b_ )[ s ];
+        if ( bs == 0.0 ) return 0.0;
+        return bs * cellKernel( mesh_->cell( cell_ ), ( *stations_ )[ s ], mesh_->dim( ) ) * scale_;
+    }
+    const Mesh * mesh_;
+    const std::vector< RVector3 > * stations_;
+    const RVector * b_;
+    Index cell_;
+    double scale_;
+};
+
+void GravimetryTreeOperator::multRange( const RVector & density, const std::vector< double > & mom,
+                                        RVector & ret, Index start, Index end ) const {
+    for ( Index i = start; i < end; i ++ ){
+        TreeCellNear near( *mesh_, density, stations_[ i ] );
+        ret[ i ] = cellTree_->eval( stations_[ i ], 0.0, theta_, eta_, mom, near );
+    }
+}
+
+void GravimetryTreeOperator::transMultRange( const RVector & b, const std::vector< double > & mom,
+                                             RVector & ret, Index start, Index end ) const {
+    for ( Index c = start; c < end; c ++ ){
+        if ( cellSize_[ c ] == 0.0 ){
+            //** no mass, no kernel, see cellKernel
+            ret[ c ] = 0.0;
+            continue;
+        }
+        //** far: sum_s K(s, c) b_s = -size_c * field of the sources b_s at the cell center,
+        //** so the exact near field is scaled by -1 / size_c
+        double size = -cellSize_[ c ];
+        TreeStationNear near( *mesh_, stations_, b, c, 1.0 / size );
+        ret[ c ] = stationTree_->eval( cellCenter_[ c ], cellRadius_[ c ], theta_, eta_, mom, near ) * size;
+    }
+}
+
+class GravimetryTreeMT : public BaseCalcMT{
+public:
+    GravimetryTreeMT( const GravimetryTreeOperator & op, const RVector & vec,
+                      const std::vector< double > & mom, RVector & ret, bool trans, bool verbose )
+        : BaseCalcMT( 1, verbose ), op_( &op ), vec_( &vec ), mom_( &mom ), ret_( &ret ), trans_( trans ){
+    }
+
+    virtual ~GravimetryTreeMT(){}
+
+    virtual void calc( Index tNr = 0 ){
+        if ( trans_ ) op_->transMultRange( *vec_, *mom_, *ret_, start_, end_ );
+        else op_->multRange( *vec_, *mom_, *ret_, start_, end_ );
+    }
+
+protected:
+    const GravimetryTreeOperator    * op_;
+    const RVector                   * vec_;
+    const std::vector< double >     * mom_;
+    RVector                         * ret_;
+    bool                            trans_;
+};
+
+RVector GravimetryTreeOperator::mult( const RVector & density ) const {
+    if ( density.size( ) != cols( ) ) {
+        throwLengthError( 1, WHERE_AM_I + " " + str( density.size( ) ) + " != " + str( cols( ) ) );
+    }
+    //** far field sources are point masses density * size
+    std::vector< double > mom;
+    cellTree_->moments( density * cellSize_, mom );
+    RVector ret( rows( ), 0.0 );
+    distributeCalc( GravimetryTreeMT( *this, density, mom, ret, false, verbose_ ),
+                    rows( ), max( (Index)1, min( nThreads_, rows( ) ) ), verbose_ );
     return ret;
 }
 
-RVector GravimetryModelling::response( const RVector & model ){
-    RVector ret;
-    THROW_TO_IMPL
+RVector GravimetryTreeOperator::transMult( const RVector & b ) const {
+    if ( b.size( ) != rows( ) ) {
+        throwLengthError( 1, WHERE_AM_I + " " + str( b.size( ) ) + " != " + str( rows( ) ) );
+    }
+    //** stations are point sources with weights b
+    std::vector< double > mom;
+    stationTree_->moments( b, mom );
+    RVector ret( cols( ), 0.0 );
+    distributeCalc( GravimetryTreeMT( *this, b, mom, ret, true, verbose_ ),
+                    cols( ), max( (Index)1, min( nThreads_, cols( ) ) ), verbose_ );
     return ret;
 }
 
-void GravimetryModelling::createJacobian( const RVector & model ){
-    THROW_TO_IMPL
+class GravimetryKernelMT : public BaseCalcMT{
+public:
+    GravimetryKernelMT( const GravimetryModelling & fop, const std::vector< RVector3 > & pos,
+                        MatrixBase * kernel, bool verbose )
+        : BaseCalcMT( 1, verbose ), fop_( &fop ), pos_( &pos ), kernel_( kernel ){
+    }
+
+    virtual ~GravimetryKernelMT(){}
+
+    virtual void calc( Index tNr = 0 ){
+        RVector row;
+        for ( Index i = start_; i < end_; i ++ ){
+            if ( kernel_->rtti( ) == GIMLI_MATRIX_RTTI ){
+                fop_->kernelRow( ( *pos_ )[ i ], ( *dynamic_cast< RMatrix * >( kernel_ ) )[ i ] );
+            } else {
+                fop_->kernelRow( ( *pos_ )[ i ], row );
+                dynamic_cast< FloatDenseMatrix * >( kernel_ )->setRow( i, row );
+            }
+        }
+    }
+
+protected:
+    const GravimetryModelling       * fop_;
+    const std::vector< RVector3 >   * pos_;
+    MatrixBase                      * kernel_;
+};
+
+void GravimetryModelling::calcKernel_( ){
+    if ( !mesh_ ) throwError( 1, WHERE_AM_I + " no mesh given." );
+    if ( !dataContainer_ ) throwError( 1, WHERE_AM_I + " no data given." );
+    deleteKernel_( );
+
+    const std::vector< RVector3 > & pos = dataContainer_->sensorPositions( );
+    Index nCells = mesh_->cellCount( );
+    if ( verbose_ ) std::cout << "Calculate gravimetry kernel " << pos.size( )
+                              << " x " << nCells << " ... ";
+    Stopwatch swatch( true );
+
+    if ( treeAccuracy_ > 0.0 ){
+        kernel_ = new GravimetryTreeOperator( *mesh_, pos, treeAccuracy_, nThreads_, verbose_ );
+        if ( verbose_ ) std::cout << swatch.duration( ) << " s" << std::endl;
+        return;
+    }
+
+    if ( singlePrecision_ ){
+        kernel_ = new FloatDenseMatrix( pos.size( ), nCells );
+    } else {
+        kernel_ = new RMatrix( pos.size( ), nCells );
+    }
+    distributeCalc( GravimetryKernelMT( *this, pos, kernel_, verbose_ ),
+                    pos.size( ), max( (Index)1, min( nThreads_, (Index)pos.size( ) ) ), verbose_ );
+
+    if ( verbose_ ) std::cout << swatch.duration( ) << " s" << std::endl;
+}
+
+const MatrixBase & GravimetryModelling::kernel( ){
+    if ( !kernel_ ) calcKernel_( );
+    return *kernel_;
+}
+
+void GravimetryModelling::prepareResponse_mt( ){
+    if ( !kernel_ ) calcKernel_( );
+}
+
+RVector GravimetryModelling::response( const RVector & density ){
+    if ( !kernel_ ) calcKernel_( );
+    return response_mt( density );
+}
+
+RVector GravimetryModelling::response_mt( const RVector & density, Index i ) const {
+    if ( !kernel_ ) throwError( 1, WHERE_AM_I + " kernel not calculated, call prepareResponse_mt first." );
+    return kernel_->mult( createMappedModel( density, 0.0 ) );
+}
+
+void GravimetryModelling::createJacobian( const RVector & density ){
+    if ( !kernel_ ) calcKernel_( );
+
+    if ( density.size( ) == mesh_->cellCount( ) ){
+        //** kernel is the Jacobian
+        if ( jacobian_ != kernel_ ){
+            if ( jacobian_ && ownJacobian_ ) delete jacobian_;
+            jacobian_ = kernel_;
+            ownJacobian_ = false;
+        }
+        return;
+    }
+
+    //** sum up the cell kernels per model parameter (cell marker)
+    if ( jacobian_ == kernel_ || !jacobian_ || !ownJacobian_ ) {
+        jacobian_ = new RMatrix( );
+        ownJacobian_ = true;
+    }
+    RMatrix * J = dynamic_cast< RMatrix * >( jacobian_ );
+    J->resize( kernel_->rows( ), density.size( ) );
+    *J *= 0.0;
+
+    const RMatrix * Kd = dynamic_cast< const RMatrix * >( kernel_ );
+    const FloatDenseMatrix * Kf = dynamic_cast< const FloatDenseMatrix * >( kernel_ );
+    if ( !Kd && !Kf ){
+        throwError( 1, WHERE_AM_I + " the tree code needs one model value per cell." );
+    }
+    for ( Index i = 0; i < J->rows( ); i ++ ){
+        RVector & Ji = ( *J )[ i ];
+        for ( Index c = 0; c < mesh_->cellCount( ); c ++ ){
+            SIndex marker = mesh_->cell( c ).marker( );
+            if ( marker < 0 ) continue;
+            if ( (Index)marker >= density.size( ) ){
+                throwLengthError( 1, WHERE_AM_I + " marker >= than model.size() " + str( marker )
+                                  + " >= " + str( density.size( ) ) );
+            }
+            Ji[ marker ] += Kd ? ( *Kd )[ i ][ c ] : Kf->val( i, c );
+        }
+    }
 }
 
 void GravimetryModelling::initJacobian( ){
-    THROW_TO_IMPL
+    if ( !kernel_ ) calcKernel_( );
 }
 
+RVector GravimetryModelling::createDepthWeighting( double z0, double beta ) const {
+    if ( !mesh_ ) throwError( 1, WHERE_AM_I + " no mesh given." );
+    Index up = mesh_->dim( ) - 1;
+    double zMax = -MAX_DOUBLE;
+    if ( dataContainer_ ){
+        const std::vector< RVector3 > & pos = dataContainer_->sensorPositions( );
+        for ( Index i = 0; i < pos.size( ); i ++ ) zMax = max( zMax, pos[ i ][ up ] );
+    }
+    if ( zMax == -MAX_DOUBLE ) zMax = 0.0;
+
+    RVector w( mesh_->cellCount( ) );
+    for ( Index i = 0; i < w.size( ); i ++ ){
+        double z = max( 0.0, zMax - mesh_->cell( i ).center( )[ up ] );
+        w[ i ] = std::pow( z + z0, -beta / 2.0 );
+    }
+    return w / max( w );
+}
 
 double lineIntegraldGdz( const RVector3 & p1, const RVector3 & p2 ){
     double x1 = p1[ 0 ], z1 = p1[ 1 ];
@@ -122,32 +648,30 @@ double f_gz( const RVector3 & x, const RVector3 & p ){
 }
 
 RVector calcGCells( const std::vector< RVector3 > & pos, const Mesh & mesh, const RVector & model, uint nInt ){
-    /*! Ensure neighbourInfos() */
-    RMatrix Jacobian( pos.size(), mesh.cellCount() );
-
-    Jacobian *= 0.;
+    RVector ret( pos.size( ), 0.0 );
 
-    for ( uint i = 0; i < pos.size(); i ++ ){
+    for ( uint i = 0; i < pos.size( ); i ++ ){
         for ( std::vector< Cell * >::const_iterator it = mesh.cells().begin(); it != mesh.cells().end(); it ++ ){
             Cell *c = *it;
             double Z = 0.;
             if ( nInt == 0 ){
-                for ( uint j = 0; j < c->nodeCount(); j ++ ){
-                    // negative Z because all cells are numbered counterclockwise
-                    Z -= 2.0 * lineIntegraldGdz( c->node( j ).pos() - pos[ i ], c->node( (j+1)%c->nodeCount() ).pos() - pos[ i ] );
-                }
+                // exact polygon integration, the same kernel as GravimetryModelling
+                Z = cellKernel( *c, pos[ i ], 2 );
             } else {
-                for ( uint j = 0; j < IntegrationRules::instance().triAbscissa( nInt ).size(); j ++ ){
-                    Z += IntegrationRules::instance().triWeights( nInt )[ j ] *
-                                    f_gz( c->shape().xyz( IntegrationRules::instance().triAbscissa( nInt )[ j ] ), pos[ i ] );
+                const R3Vector & x = IntegrationRules::instance().abscissa( c->shape(), nInt );
+                const RVector & w = IntegrationRules::instance().weights( c->shape(), nInt );
+                for ( uint j = 0; j < x.size(); j ++ ){
+                    Z += w[ j ] * f_gz( c->shape().xyz( x[ j ] ), pos[ i ] );
                 }
+                // jacobian determinant of the (affine) cell and 2D line mass factor
+                Z *= 2.0 * c->shape().domainSize() / sum( w ) * GRAVITY_CONSTANT_MGAL;
             }
 
-            Jacobian[ i ][ c->id() ] = -Z;
+            ret[ i ] += Z * model[ c->id() ];
         }
     }
 
-    return Jacobian * model * 6.67384e-11 * 1e5;
+    return ret;
 }
 
 } // namespace GIMLI{
@@ -20,30 +20,172 @@
 #define _GIMLI_GRAVIMETRY__H
 
 #include "gimli.h"
+#include "matrix.h"
 #include "modellingbase.h"
 
 namespace GIMLI {
 
+//! Dense row major matrix with single precision storage
+/*! Dense row major matrix with single precision storage, e.g., for the
+ * kernel of large 3D grids. Products are accumulated in double. */
+class DLLEXPORT FloatDenseMatrix : public MatrixBase {
+public:
+    FloatDenseMatrix( Index rows = 0, Index cols = 0 ) : MatrixBase( ) { resize( rows, cols ); }
+
+    virtual ~FloatDenseMatrix() { }
+
+    void resize( Index rows, Index cols ){
+        rows_ = rows; cols_ = cols;
+        vals_.resize( rows * cols );
+    }
+
+    virtual Index rows() const { return rows_; }
+
+    virtual Index cols() const { return cols_; }
+
+    virtual void clear() { resize( 0, 0 ); }
+
+    inline double val( Index i, Index j ) const { return vals_[ i * cols_ + j ]; }
+
+    /*! Set row i from double values */
+    void setRow( Index i, const RVector & row );
+
+    virtual RVector mult( const RVector & b ) const;
+
+    virtual RVector transMult( const RVector & b ) const;
+
+protected:
+    Index rows_;
+    Index cols_;
+    std::vector < float > vals_;
+};
+
+class PotentialFieldTree;
+
+//! Tree code approximation of the gravimetry kernel
+/*! Matrix free gravimetry kernel (stations x cells) for large station sets
+ * and grids. The cells are clustered in a kd-tree with multipole
+ * expansions (quadrupole in 3D, complex expansion in 2D), clusters that are
+ * well separated from a station are taken from the expansion and all
+ * others exactly by the cell kernel. transMult works the same way with a
+ * tree of the stations. The acceptance ratio theta and the expansion order
+ * are derived from the relative accuracy target. */
+class DLLEXPORT GravimetryTreeOperator : public MatrixBase {
+public:
+    GravimetryTreeOperator( const Mesh & mesh, const std::vector< RVector3 > & stations,
+                            double accuracy = 1e-3, Index nThreads = 1, bool verbose = false );
+
+    virtual ~GravimetryTreeOperator( );
+
+    virtual Index rows() const { return stations_.size( ); }
+
+    virtual Index cols() const { return cellCenter_.size( ); }
+
+    virtual RVector mult( const RVector & density ) const;
+
+    virtual RVector transMult( const RVector & b ) const;
+
+    inline double theta() const { return theta_; }
+
+    inline Index order() const { return order_; }
+
+    /*! Used by the threads of mult, rows [start, end). */
+    void multRange( const RVector & density, const std::vector< double > & mom,
+                    RVector & ret, Index start, Index end ) const;
+
+    /*! Used by the threads of transMult, columns [start, end). */
+    void transMultRange( const RVector & b, const std::vector< double > & mom,
+                         RVector & ret, Index start, Index end ) const;
+
+protected:
+    const Mesh * mesh_;
+    std::vector< RVector3 > stations_;
+    std::vector< RVector3 > cellCenter_;
+    RVector cellRadius_;
+    RVector cellSize_;
+    PotentialFieldTree * cellTree_;
+    PotentialFieldTree * stationTree_;
+    Index dim_;
+    Index order_;
+    double theta_;
+    double eta_;
+    Index nThreads_;
+};
+
 //! Modelling class for gravimetry calculation using polygon integration
-/*! Modelling class for gravimetry calculation using polygon integration */
+/*! Modelling class for gravimetry calculation. The stations are the
+ * sensor positions of the data container. For 2D meshes (y up) the
+ * cell kernels are calculated by polygon integration after Won & Bevis
+ * (1987), for 3D meshes (z up) the cells are approximated by point masses
+ * in their centers, or by spheres of equal volume for stations inside
+ * that sphere. The response in mGal is linear in the density
+ * (contrast) per cell in kg/m^3 (positive for excess mass below the
+ * station), so the kernel is calculated only once per
+ * mesh and station geometry (in parallel over the stations, see
+ * setThreadCount), used as Jacobian and the response is a matrix vector
+ * product. */
 class DLLEXPORT GravimetryModelling : public ModellingBase {
 public:
     GravimetryModelling( Mesh & mesh, DataContainer & dataContainer, bool verbose = false );
 
-    virtual ~GravimetryModelling() { }
+    virtual ~GravimetryModelling();
 
     RVector createDefaultStartModel( );
 
     /*! Interface. Calculate response */
-    virtual RVector response( const RVector & slowness );
+    virtual RVector response( const RVector & density );
+
+    /*! Read only response, the kernel needs to be calculated before, see
+     * \ref prepareResponse_mt. */
+    virtual RVector response_mt( const RVector & density, Index i = 0 ) const;
+
+    /*! Calculates the kernel. */
+    virtual void prepareResponse_mt( );
 
     /*! Interface. */
-    virtual void createJacobian( const RVector & slowness );
+    virtual void createJacobian( const RVector & density );
 
     /*! Interface. */
     virtual void initJacobian( );
 
+    /*! Store the kernel in single precision to halve the memory for large
+     * 3D grids. Default is false. */
+    void setSinglePrecision( bool single );
+
+    inline bool singlePrecision() const { return singlePrecision_; }
+
+    /*! Use the tree code (\ref GravimetryTreeOperator) with the given
+     * relative accuracy instead of the dense kernel, 0 switches it off.
+     * The tree code needs one model value per cell. */
+    void setTreeCode( double accuracy );
+
+    inline double treeCodeAccuracy() const { return treeAccuracy_; }
+
+    /*! Return the kernel (stations x cells), calculated if necessary.
+     * With the tree code it is a matrix free operator. */
+    const MatrixBase & kernel( );
+
+    /*! Depth weighting after Li & Oldenburg (1998) per cell
+     * w = (z + z0)^(-beta/2) normalized to max(w) = 1, with z as the depth
+     * below the highest station. Intended as model weight for the inversion,
+     * i.e., Inversion::setMWeight. */
+    RVector createDepthWeighting( double z0 = 1.0, double beta = 2.0 ) const;
+
+    /*! Calculate the kernel row of one station for all cells. */
+    void kernelRow( const RVector3 & pos, RVector & row ) const;
+
 protected:
+    virtual void updateMeshDependency_( ) { deleteKernel_( ); }
+
+    virtual void updateDataDependency_( ) { deleteKernel_( ); }
+
+    void calcKernel_( );
+
+    void deleteKernel_( );
+
+    MatrixBase * kernel_;
+    bool singlePrecision_;
+    double treeAccuracy_;
 };
 
 
@@ -55,7 +197,11 @@ DLLEXPORT double lineIntegraldGdz( const RVector3 & p1, const RVector3 & p2 );
 /*! Do not use until u know what u do. */
 DLLEXPORT RVector calcGBounds( const std::vector< RVector3 > & pos, const Mesh & mesh, const RVector & model );
 
-/*! Do not use until u know what u do. */
+/*! Vertical gravity in mGal of a 2D mesh (y up) for the densities model in
+ * kg/m^3 at the positions pos, positive for excess mass below the station
+ * as for \ref GravimetryModelling. For nInt == 0 the cells are integrated
+ * exactly (polygon integration after Won & Bevis, 1987), otherwise by
+ * quadrature of order nInt. */
 DLLEXPORT RVector calcGCells( const std::vector< RVector3 > & pos, const Mesh & mesh, const RVector & model, uint nInt = 0 );
 
 } //namespace GIMLI
@@ -22,15 +22,14 @@
 #include "mesh.h"
 #include "node.h"
 #include "shape.h"
+#include "stopwatch.h"
+#include "vectorkernels.h"
+#include "calculateMultiThread.h"
 
 namespace GIMLI{
 
-void interpolate(const Mesh & mesh, const RMatrix & vData,
-                 const R3Vector & ipos, RMatrix & iData,
-                 bool verbose, double fillValue){ ALLOW_PYTHON_THREADS
-
-    R3Vector pos(ipos);
-
+/*! Swap y and z of query positions in the x-z plane for 2D meshes. */
+static void swapYZForMesh__(const Mesh & mesh, R3Vector & pos, bool verbose){
     if (mesh.dim() == 2){
         if ((zVari(pos) || max(abs(z(pos))) > 0.) &&
             (!yVari(pos) && max(abs(y(pos))) < 1e-8)) {
@@ -40,77 +39,158 @@ void interpolate(const Mesh & mesh, const RMatrix & vData,
             swapYZ(pos);
         }
     }
+}
+
+void interpolate(const Mesh & mesh, const RMatrix & vData,
+                 const R3Vector & ipos, RMatrix & iData,
+                 bool verbose, double fillValue){ ALLOW_PYTHON_THREADS
+
+    MeshInterpolator I(mesh, ipos, verbose);
+    I.apply(vData, iData, fillValue);
+}
+
+/*! out[v] = A * in[v] for all v, distributed over the rows of A. */
+class SparseRowMultMT : public BaseCalcMT{
+public:
+    SparseRowMultMT(const SparseRowMatrix & A,
+                    const std::vector< const RVector * > & in,
+                    const std::vector< RVector * > & out)
+        : BaseCalcMT(), A_(&A), in_(&in), out_(&out){
+    }
+
+    virtual ~SparseRowMultMT(){}
+
+    virtual void calc(Index tNr=0){
+        const std::vector < Index > & rowPtr = A_->vecRowPtr();
+        const std::vector < Index > & colIdx = A_->vecColIdx();
+        const std::vector < double > & vals = A_->vecVals();
+        Index nVec = in_->size();
 
-    if (iData.rows() != vData.rows()){
-        iData.resize(vData.rows(), pos.size());
+        for (Index i = start_; i < end_; i ++){
+            for (Index v = 0; v < nVec; v ++){
+                const RVector & a = *(*in_)[v];
+                double s = 0.0;
+                for (Index k = rowPtr[i]; k < rowPtr[i + 1]; k ++){
+                    s += vals[k] * a[colIdx[k]];
+                }
+                (*(*out_)[v])[i] = s;
+            }
+        }
     }
 
-    std::vector < Cell * > cells(pos.size());
-    size_t count = 0;
+protected:
+    const SparseRowMatrix * A_;
+    const std::vector< const RVector * > * in_;
+    const std::vector< RVector * > * out_;
+};
+
+static void sparseRowMult__(const SparseRowMatrix & A,
+                     const std::vector< const RVector * > & in,
+                     const std::vector< RVector * > & out){
+    if (in.empty() || A.rows() == 0) return;
+    Index nThreads = max(Index(1), min(vectorThreadCount(A.nVals() * in.size()),
+                                       A.rows()));
+    distributeCalc(SparseRowMultMT(A, in, out), A.rows(), nThreads);
+}
+
+MeshInterpolator::MeshInterpolator(const Mesh & mesh, const R3Vector & ipos,
+                                   bool verbose)
+    : P_(ipos.size(), mesh.nodeCount()),
+      C_(mesh.nodeCount(), mesh.cellCount()){
 
+    Stopwatch swatch(true);
+    R3Vector pos(ipos);
+    swapYZForMesh__(mesh, pos, verbose);
+
+    size_t count = 0;
     Cell * c = 0;
-    for (uint i = 0; i < pos.size(); i ++) {
-//         __MS(pos[i])
+    RVector N;
+    for (Index i = 0; i < pos.size(); i ++){
         c = mesh.findCell(pos[i], count, false);
-//         if (!c) {
-//             __MS(pos[i])
-// //             c = mesh.findCell(pos[i], count, true);
-// //             if (!c) exit(0);
-//         }
-        cells[i] = c;
-//         if (verbose) std::cout << "\r" << i + 1 << " \t/ " << pos.size()
-//                                << "\t searched: " << count << std::endl;
-    }
-    if (verbose) std::cout << std::endl;
-
-    for (uint i = 0; i < vData.rows(); i ++) {
-        if (verbose) std::cout << "\r" << i + 1 << " \t/ " << vData.rows();
-
-        RVector data;
-
-        if (vData[i].size() != 0){
-
-            if (vData[i].size() == mesh.nodeCount()){
-                data = vData[i];
-            } else if (vData[i].size() == mesh.cellCount()){
-                data = cellDataToPointData(mesh, vData[i]);
-            } else {
-                throwLengthError(EXIT_VECTOR_SIZE_INVALID,
-                                 WHERE_AM_I +
-                                 " data.size not nodeCount and cellCount " +
-                                 toStr(vData[i].size()) + " != " +
-                                 toStr(mesh.nodeCount()) + " != " +
-                                 toStr(mesh.cellCount()));
+        if (c){
+            N.resize(c->nodeCount());
+            c->N(c->shape().rst(pos[i]), N);
+            for (Index j = 0; j < c->nodeCount(); j ++){
+                P_.addVal(i, c->node(j).id(), N[j]);
             }
+        } else {
+            outside_.push_back(i);
+        }
+    }
+    P_.compress();
 
-            for (uint j = 0; j < pos.size(); j ++) {
-                if (cells[j]){
-                    iData[i][j] = cells[j]->pot(pos[j], data);
-
-//              this check is obsolete if the findCell (from above) is working properly
-//                     if (cells[j]->shape().isInside(pos[j])){
-//                         iData[i][j] = cells[j]->pot(pos[j], data);
-//                     } else {
-//                         std::cout << WHERE_AM_I << " here is somethng wrong" << std::endl;
-//                     }
-
-//                    std::cout << j << " " << iData[i][j] << std::endl;
-                    //** return cell data
-//                    iData[i][j] = vData[i][cells[j]->id()];
-                } else {
-                    iData[i][j] = fillValue;
-                    //std::cout << "Cant find cell for " << pos[j]<< std::endl;
-//                     for (uint i = 0; i < mesh.cellCount(); i ++){
-//                     	if (mesh.cell(i).shape().isInside(pos[j], true)){
-//                         	std::cout << mesh.cell(i) << std::endl;
-//                         }
-//                     }
-//                     exit(0);
-                }
-            }
-        } // if vData.size() != 0
-    }  // for each in vData
-    if (verbose) std::cout << std::endl;
+    for (Index i = 0; i < mesh.nodeCount(); i ++){
+        const std::set < Cell * > & cs = mesh.node(i).cellSet();
+        for (std::set < Cell * >::const_iterator it = cs.begin(); it != cs.end(); it ++){
+            C_.addVal(i, (*it)->id(), 1.0 / cs.size());
+        }
+    }
+    C_.compress();
+
+    if (verbose) std::cout << "MeshInterpolator: " << pos.size() << " positions ("
+                           << outside_.size() << " outside), "
+                           << P_.nVals() << " weights, "
+                           << swatch.duration() << " s" << std::endl;
+}
+
+void MeshInterpolator::apply(const RVector & in, RVector & out,
+                             double fillValue) const {
+    RMatrix vIn; vIn.push_back(in);
+    RMatrix vOut;
+    apply(vIn, vOut, fillValue);
+    out = vOut[0];
+}
+
+RVector MeshInterpolator::apply(const RVector & in, double fillValue) const {
+    RVector out;
+    apply(in, out, fillValue);
+    return out;
+}
+
+void MeshInterpolator::apply(const RMatrix & in, RMatrix & out,
+                             double fillValue) const {
+    if (out.rows() != in.rows()) out.resize(in.rows(), size());
+
+    std::vector< const RVector * > nodeIn;
+    std::vector< const RVector * > cellIn;
+    std::vector< RVector * > cellOut;
+    std::vector< RVector * > nodeOut;
+    std::vector< RVector > cellToNode;
+    Index nCellData = 0;
+
+    for (Index i = 0; i < in.rows(); i ++){
+        if (in[i].size() == C_.rows() && in[i].size() > 0) continue;
+        if (in[i].size() == C_.cols() && in[i].size() > 0) nCellData ++;
+    }
+    cellToNode.resize(nCellData, RVector(C_.rows()));
+
+    for (Index i = 0; i < in.rows(); i ++){
+        if (in[i].size() == 0) continue;
+
+        if (in[i].size() == C_.rows()){
+            nodeIn.push_back(&in[i]);
+        } else if (in[i].size() == C_.cols()){
+            cellIn.push_back(&in[i]);
+            cellOut.push_back(&cellToNode[cellOut.size()]);
+            nodeIn.push_back(cellOut.back());
+        } else {
+            throwLengthError(EXIT_VECTOR_SIZE_INVALID,
+                             WHERE_AM_I +
+                             " data.size not nodeCount and cellCount " +
+                             toStr(in[i].size()) + " != " +
+                             toStr(C_.rows()) + " != " +
+                             toStr(C_.cols()));
+        }
+        if (out[i].size() != size()) out[i].resize(size());
+        nodeOut.push_back(&out[i]);
+    }
+
+    sparseRowMult__(C_, cellIn, cellOut);
+    sparseRowMult__(P_, nodeIn, nodeOut);
+
+    for (Index v = 0; v < nodeOut.size(); v ++){
+        for (Index j = 0; j < outside_.size(); j ++) (*nodeOut[v])[outside_[j]] = fillValue;
+    }
 }
 
 void interpolate(const Mesh & mesh, const RVector & data,
@@ -259,10 +339,9 @@ RVector cellDataToPointData(const Mesh & mesh, const RVector & cellData){
 
     RVector ret(mesh.nodeCount());
 
-    std::set < Cell * > cset;
     for (uint i = 0; i < mesh.nodeCount(); i ++){
-        cset = mesh.node(i).cellSet();
-        for (std::set < Cell * >::iterator it = cset.begin(); it != cset.end(); it ++){
+        const std::set < Cell * > & cset = mesh.node(i).cellSet();
+        for (std::set < Cell * >::const_iterator it = cset.begin(); it != cset.end(); it ++){
             ret[i] += cellData[(*it)->id()];
         }
         ret[i] /= cset.size();
@@ -21,6 +21,7 @@
 
 #include "gimli.h"
 #include "matrix.h"
+#include "sparsematrix.h"
 #include <vector>
 
 namespace GIMLI{
@@ -87,6 +88,59 @@ DLLEXPORT void interpolateSurface(const Mesh & srcMesh, Mesh & destMesh,
 DLLEXPORT RVector cellDataToPointData(const Mesh & mesh,
                                       const RVector & cellData);
 
+//! Precomputed interpolation from a mesh to a fixed set of positions.
+/*! Linear operator that interpolates data of a source mesh to a fixed set of
+ * positions, e.g., the nodes or cell centers of another mesh. The cell search
+ * and the shape functions are evaluated once on construction, every
+ * \ref apply is then a sparse matrix product, distributed over threads for
+ * large problems. Node data is interpolated with the shape functions like
+ * \ref interpolate, cell data is averaged to the nodes first like
+ * \ref cellDataToPointData.
+ * Build it once to map many vectors, e.g., of all iterations or time steps,
+ * between the same meshes.
+ * \code
+ * MeshInterpolator I(paraMesh, fineMesh.cellCenters());
+ * for (Index i = 0; i < models.rows(); i ++) fine[i] = I.apply(models[i]);
+ * \endcode */
+class DLLEXPORT MeshInterpolator{
+public:
+    /*! Build the operators from srcMesh to destPos. For 2D meshes, query
+     * positions in the x-z plane are swapped into x-y like \ref interpolate. */
+    MeshInterpolator(const Mesh & srcMesh, const R3Vector & destPos,
+                     bool verbose=false);
+
+    /*! Return the amount of destination positions. */
+    inline Index size() const { return P_.rows(); }
+
+    /*! Return the point interpolation operator of size
+     * destPos.size() x srcMesh.nodeCount(). */
+    inline const SparseRowMatrix & pointOperator() const { return P_; }
+
+    /*! Return the cell to node averaging operator of size
+     * srcMesh.nodeCount() x srcMesh.cellCount(). */
+    inline const SparseRowMatrix & cellOperator() const { return C_; }
+
+    /*! Return the indices of the positions outside of srcMesh. */
+    inline const IndexArray & outside() const { return outside_; }
+
+    /*! Interpolate node or cell data of the source mesh into out.
+     * Positions outside of the source mesh get fillValue. */
+    void apply(const RVector & in, RVector & out, double fillValue=0.0) const;
+
+    /*! Return the interpolated node or cell data of the source mesh. */
+    RVector apply(const RVector & in, double fillValue=0.0) const;
+
+    /*! Interpolate every row of in into the corresponding row of out with
+     * one pass over the operator. out will be resized if necessary. Empty
+     * rows are omitted. */
+    void apply(const RMatrix & in, RMatrix & out, double fillValue=0.0) const;
+
+protected:
+    SparseRowMatrix P_;
+    SparseRowMatrix C_;
+    IndexArray outside_;
+};
+
 DLLEXPORT void triangleMesh_(const Mesh & mesh, Mesh & tmpMesh);
 
 } // namespace GIMLI
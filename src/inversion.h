@@ -33,6 +33,7 @@
 #include "vector.h"
 
 #include "ipcClient.h"
+#include "calculateMultiThread.h"
 
 namespace GIMLI{
 
@@ -41,6 +42,48 @@ namespace GIMLI{
 //#define PLUS_TMP_VECSUFFIX + ".vec"
 #define PLUS_TMP_VECSUFFIX
 
+/*! Solve the inverse sub step for several regularization strengths at once.
+ * Each lambda writes to its own solution only, so the lambdas of an L-curve
+ * can be distributed over several threads (see \ref Inversion::optLambda). */
+template < class Vec > class CGLSLambdaMT : public BaseCalcMT{
+public:
+    CGLSLambdaMT(std::vector < Vec > & x, const std::vector < double > & lambdas,
+                 const MatrixBase & S, const MatrixBase & C,
+                 const Vec & dWeight, const Vec & b,
+                 const Vec & wc, const Vec & wm,
+                 const Vec & tm, const Vec & td, const Vec & roughness,
+                 int maxIter, double tol, bool verbose)
+    : BaseCalcMT(1, verbose), x_(&x), lambdas_(&lambdas), S_(&S), C_(&C),
+      dWeight_(&dWeight), b_(&b), wc_(&wc), wm_(&wm), tm_(&tm), td_(&td),
+      roughness_(&roughness), maxIter_(maxIter), tol_(tol){
+    }
+
+    virtual ~CGLSLambdaMT(){}
+
+    virtual void calc(Index tNr=0){
+        for (Index i = start_; i < end_; i ++){
+            solveCGLSCDWWhtrans(*S_, *C_, *dWeight_, *b_, (*x_)[i], *wc_, *wm_,
+                                *tm_, *td_, (*lambdas_)[i], *roughness_,
+                                maxIter_, tol_, false);
+        }
+    }
+
+protected:
+    std::vector < Vec >         * x_;
+    const std::vector < double >* lambdas_;
+    const MatrixBase            * S_;
+    const MatrixBase            * C_;
+    const Vec * dWeight_;
+    const Vec * b_;
+    const Vec * wc_;
+    const Vec * wm_;
+    const Vec * tm_;
+    const Vec * td_;
+    const Vec * roughness_;
+    int maxIter_;
+    double tol_;
+};
+
 /*! template function for computing L1 norm (robust/blocky) weightings */
 template < class Vec > Vec getIRLSWeights(const Vec & a, double locut = 0.0, double hicut = 0.0) {
     double suabs = sum(abs(a));
@@ -187,6 +230,10 @@ protected:
         dPhiAbortPercent_   = 2.0;
 
         CGLStol_            = -1.0; //** -1 means automatic scaled
+        nThreadsEval_       = 1;
+        precondCGLS_        = false;
+        etaCGLS_            = 0.0;
+        phiLastStep_        = 0.0;
     }
 
 public:
@@ -332,6 +379,14 @@ public:
     inline void setLineSearch(bool linesearch) { useLinesearch_ = linesearch; }
     inline bool lineSearch() const { return useLinesearch_; }
 
+    /*! Set and get the number of threads for the concurrent evaluation of
+     * candidate models, i.e., the L-curve lambdas. 1 is default.
+     * For nThreads > 1 the forward operator needs a read only
+     * \ref ModellingBase::response_mt, which is also used for the parabolic
+     * line search step so that the operator state stays at the full step. */
+    inline void setConcurrentEvaluation(Index nThreads) { nThreadsEval_ = max(nThreads, (Index)1); }
+    inline Index concurrentEvaluation() const { return nThreadsEval_; }
+
     /*! Set and get blocky model behaviour (by L1 reweighting of constraints) */
     inline void setBlockyModel(bool isBlocky) { isBlocky_ = isBlocky; }
     inline bool blockyModel() const { return isBlocky_; }
@@ -374,6 +429,13 @@ public:
     inline void setCGLSTolerance(double tol){ CGLStol_ = tol; }
     inline double maxCGLSTolerance() const { return CGLStol_; }
 
+    /*! Set and get the preconditioned inner solver. If set, the inverse sub
+     * step is solved with a Jacobi preconditioned CGLS, warm started with the
+     * last model update scaled by the misfit reduction and stopped with an
+     * adaptive (Eisenstat-Walker) tolerance instead of the CGLS tolerance. */
+    inline void setPreconditionedCGLS(bool precond){ precondCGLS_ = precond; }
+    inline bool preconditionedCGLS() const { return precondCGLS_; }
+
     /*! Return curent iteration number */
     inline uint iter() const { return iter_; }
 
@@ -697,67 +759,26 @@ public:
     /*! Return last relative RMS misfit */
     inline double relrms() const { return rrms(data_, response_) * 100.; }
 
-    /*! Start with linear interpolation, followed by quadratic fit if linesearch parameter tau is lower than 0.03. Tries to return values between 0.03 and 1 */
-    double linesearch(const Vec & modelNew, const Vec & responseNew) const {
-        Vec phiVector(101, getPhi());
-        Vec phiDVector(101 , getPhiD());
-
-        Vec dModel(tM_->trans(modelNew)    - tM_->trans(model_));
-        Vec dData( tD_->trans(responseNew) - tD_->trans(response_));
-
-        double tau = 0.0, minTau = 0.0;
-        double minPhi = phiVector[ 0 ];
-
-        if (localRegularization_) minPhi = phiDVector[ 0 ];
-
-        double thisPhi = minPhi;
-        for (int i = 1; i < 101; i++) {
-            tau = 0.01 * (double) i;
-            Vec appModel (tM_->update(model_, dModel * tau));
-            Vec appResponse (tD_->update(response_, dData * tau));
-            phiVector[ i ]  = getPhi(appModel, appResponse);
-            phiDVector[ i ] = getPhiD(appResponse);
-            thisPhi = phiVector[ i ]; //! rigorous minimization of the total objective function
-            //** this could also be controlled by another switch (which is enforced by local reg.)
-            if (localRegularization_) thisPhi = phiDVector[ i ];
-            if (thisPhi < minPhi){
-                minPhi = thisPhi;
-                minTau = tau;
-            }
-        }
-        DOSAVE save(phiVector,  "linesearchPhi");
-        DOSAVE save(phiDVector, "linesearchPhiD");
-
-        tau = minTau;
-
-        /*! parabolic line search using step 0, 1 and tauquad to fit parabola */
-        if (tau < 0.03) {
-            double tauquad = 0.3;
-            if (verbose_) std::cout << "tau = " << tau
-                            << ". Trying parabolic line search with step length " << tauquad;
-            RVector modelQuad(tM_->update(model_, dModel * tauquad));
-            RVector responseQuad (forward_->response(modelQuad));
-            tau = linesearchQuad(modelNew, responseNew, modelQuad, responseQuad, tauquad);
-            if (verbose_) std::cout << " ==> tau = " << tau;
-            if (tau > 1.0) { //! too large
-                tau = 1.0;
-                if (verbose_) std::cout << " resetting to " << tau;
-            }
-            if (verbose_) std::cout << std::endl;
-
-            if (tau < 0.03) { //! negative or nearly zero (stucked) -> use small step instead
-                tau = 0.03;
-                if (verbose_) std::cout << " tau < 0.03 ==> tau = " << tau << std::endl;
-            }
-        } // else tau > 0.03
-
-        if (tau < 0.95) { //! only if not nearly one (which saves a forward run
-            if (verbose_) echoStatus(responseNew, modelNew, "LS new");
-        }
+    /*! Return the model for the parabolic line search step tauquad. */
+    Vec linesearchQuadModel(const Vec & modelNew, double tauquad=0.3) const {
+        Vec dModel(tM_->trans(modelNew) - tM_->trans(model_));
+        return tM_->update(model_, dModel * tauquad);
+    }
 
-        if (verbose_) std::cout << "Linesearch tau = " << tau << std::endl;
+    /*! Fill phi and phiD with the total and the data objective function for
+     * the line search steps taus, i.e., for the model tM.update(model, dModel * tau)
+     * and the response tD.update(response, dData * tau), see \ref linesearchPhi_.
+     * dData refers to the transformed current response. */
+    void linesearchPhi(const Vec & dModel, const Vec & dData, const RVector & taus,
+                       Vec & phi, Vec & phiD) const {
+        linesearchPhi_(dModel, dData, taus, tD_->trans(data_), tD_->trans(response_),
+                       phi, phiD);
+    }
 
-        return tau;
+    /*! Start with linear interpolation, followed by quadratic fit if linesearch parameter tau is lower than 0.03. Tries to return values between 0.03 and 1.
+     * See \ref linesearch_. */
+    double linesearch(const Vec & modelNew, const Vec & responseNew) const {
+        return linesearch_(modelNew, responseNew, tD_->trans(data_), tD_->trans(response_));
     }
 
     /*! Compute objective function for old (tau=0), new (tau=1) and another model */
@@ -851,9 +872,169 @@ public:
     /*! Resets this inversion to the given startmodel. */
     void reset(){
         this->setModel(forward_->startModel());
+        etaCGLS_ = 0.0;
+        phiLastStep_ = 0.0;
+        lastDeltaModel_.clear();
     }
 
 protected:
+    /*! Return true if trans(invTrans(t)) reproduces t, i.e., the
+     * transformation does not clamp invTrans(t) at its bounds. */
+    bool transExact_(const Trans< Vec > & tr, const Vec & t) const {
+        Vec a, ta;
+        tr.invTrans_into(t, a);
+        tr.trans_into(a, ta);
+        if (haveInfNaN(ta)) return false;
+        return max(abs(ta - t)) <= TRANSTOL * (1.0 + max(abs(t)));
+    }
+
+    /*! Fill phi and phiD with the total and the data objective function for
+     * the line search steps taus, i.e., for the model tM.update(model, dModel * tau)
+     * and the response tD.update(response, dData * tau).
+     * Since update works in transformed space and both objective functions are
+     * sums of squares there, phi(tau) and phiD(tau) are quadratic polynomials in tau.
+     * Their coefficients are gathered in a single pass over the data and one
+     * constraints multiplication, independent of the number of steps.
+     * This holds only if the transformations reproduce the steps, so phi and
+     * phiD are evaluated explicitly for each step if one of them clamps at
+     * its bounds, e.g., \ref TransLog or \ref TransLogLU near the bounds.
+     * tData and tResponse are the transformed data and current response,
+     * e.g., the ones cached for the current \ref oneStep. */
+    void linesearchPhi_(const Vec & dModel, const Vec & dData, const RVector & taus,
+                        const Vec & tData, const Vec & tResponse,
+                        Vec & phi, Vec & phiD) const {
+        phi.resize(taus.size());
+        phiD.resize(taus.size());
+
+        Vec tModel(tM_->trans(model_));
+        if (!transExact_(*tM_, tModel) || !transExact_(*tM_, tModel + dModel) ||
+            !transExact_(*tD_, tResponse) || !transExact_(*tD_, tResponse + dData)){
+            if (verbose_) std::cout << "linesearch: transformation clamps, explicit phi(tau)" << std::endl;
+            for (Index i = 0; i < taus.size(); i ++){
+                if (taus[i] == 0.0){
+                    phi[i] = getPhi();
+                    phiD[i] = getPhiD();
+                    continue;
+                }
+                Vec appModel(tM_->update(model_, dModel * taus[i]));
+                Vec appResponse(tD_->update(response_, dData * taus[i]));
+                phi[i] = getPhi(appModel, appResponse);
+                phiD[i] = getPhiD(appResponse);
+            }
+            return;
+        }
+
+        Vec err(tD_->error(fixZero(data_, TOLERANCE), error_));
+
+        //** phiD(tau) = |w0 - tau * wd|^2, w = (tData - tResponse - tau * dData) / err
+        double d0 = 0.0, d1 = 0.0, d2 = 0.0;
+        for (Index i = 0, imax = tData.size(); i < imax; i ++){
+            double w0 = (tData[i] - tResponse[i]) / err[i];
+            double wd = dData[i] / err[i];
+            d0 += w0 * w0;
+            d1 += w0 * wd;
+            d2 += wd * wd;
+        }
+
+        //** phiM(tau) = |r0 + tau * rd|^2, rd = C * (dModel * mWeight) * cWeight
+        Vec r0(this->roughness(model_));
+        if (haveReferenceModel_) r0 -= constraintsH_;
+        Vec rd(*forward_->constraints() * Vec(dModel * modelWeight_) * constraintsWeight_);
+        double m0 = dot(r0, r0), m1 = dot(r0, rd), m2 = dot(rd, rd);
+
+        if (isnan(d0 + d1 + d2 + m0 + m1 + m2) || isinf(d0 + d1 + d2 + m0 + m1 + m2)){
+            throwError(1, WHERE_AM_I + " linesearch phi coefficients: " +
+                       str(d0) + " " + str(d1) + " " + str(d2) + " " +
+                       str(m0) + " " + str(m1) + " " + str(m2));
+        }
+
+        double lam = lambda_ * (1.0 - double(localRegularization_));
+        for (Index i = 0; i < taus.size(); i ++){
+            double tau = taus[i];
+            phiD[i] = d0 - 2.0 * tau * d1 + tau * tau * d2;
+            phi[i] = phiD[i] + (m0 + 2.0 * tau * m1 + tau * tau * m2) * lam;
+        }
+    }
+
+    /*! Start with linear interpolation, followed by quadratic fit if linesearch parameter tau is lower than 0.03. Tries to return values between 0.03 and 1.
+     * The forward operator is expected to be at modelNew, i.e., responseNew
+     * comes from \ref ModellingBase::response, and is left there if the
+     * returned tau is >= 0.95. For concurrent evaluation the response of the
+     * parabolic step is read only (\ref ModellingBase::response_mt).
+     * tData and tResponse are the transformed data and current response. */
+    double linesearch_(const Vec & modelNew, const Vec & responseNew,
+                       const Vec & tData, const Vec & tResponse) const {
+        Vec dModel(tM_->trans(modelNew)    - tM_->trans(model_));
+        Vec dData( tD_->trans(responseNew) - tResponse);
+
+        RVector taus(101);
+        for (Index i = 0; i < taus.size(); i ++) taus[i] = 0.01 * (double) i;
+
+        Vec phiVector, phiDVector;
+        linesearchPhi_(dModel, dData, taus, tData, tResponse, phiVector, phiDVector);
+
+        double tau = 0.0, minTau = 0.0;
+        double minPhi = phiVector[ 0 ];
+
+        if (localRegularization_) minPhi = phiDVector[ 0 ];
+
+        double thisPhi = minPhi;
+        for (int i = 1; i < 101; i++) {
+            tau = taus[i];
+            thisPhi = phiVector[ i ]; //! rigorous minimization of the total objective function
+            //** this could also be controlled by another switch (which is enforced by local reg.)
+            if (localRegularization_) thisPhi = phiDVector[ i ];
+            if (thisPhi < minPhi){
+                minPhi = thisPhi;
+                minTau = tau;
+            }
+        }
+        DOSAVE save(phiVector,  "linesearchPhi");
+        DOSAVE save(phiDVector, "linesearchPhiD");
+
+        tau = minTau;
+
+        /*! parabolic line search using step 0, 1 and tauquad to fit parabola */
+        if (tau < 0.03) {
+            double tauquad = 0.3;
+            if (verbose_) std::cout << "tau = " << tau
+                            << ". Trying parabolic line search with step length " << tauquad;
+            RVector modelQuad(linesearchQuadModel(modelNew, tauquad));
+            bool forwardMoved = false;
+            if (nThreadsEval_ > 1){
+                //** read only, the forward operator stays at modelNew
+                forward_->prepareResponse_mt();
+                tau = linesearchQuad(modelNew, responseNew, modelQuad,
+                                     forward_->response_mt(modelQuad), tauquad);
+            } else {
+                tau = linesearchQuad(modelNew, responseNew, modelQuad,
+                                     forward_->response(modelQuad), tauquad);
+                forwardMoved = true;
+            }
+            if (verbose_) std::cout << " ==> tau = " << tau;
+            if (tau > 1.0) { //! too large
+                tau = 1.0;
+                if (verbose_) std::cout << " resetting to " << tau;
+            }
+            if (verbose_) std::cout << std::endl;
+            //** the full step is taken without a new forward run, so bring
+            //** the operator state, e.g., the DC potentials, back to modelNew
+            if (tau >= 0.95 && forwardMoved) forward_->response(modelNew);
+
+            if (tau < 0.03) { //! negative or nearly zero (stucked) -> use small step instead
+                tau = 0.03;
+                if (verbose_) std::cout << " tau < 0.03 ==> tau = " << tau << std::endl;
+            }
+        } // else tau > 0.03
+
+        if (tau < 0.95) { //! only if not nearly one (which saves a forward run
+            if (verbose_) echoStatus(responseNew, modelNew, "LS new");
+        }
+
+        if (verbose_) std::cout << "Linesearch tau = " << tau << std::endl;
+
+        return tau;
+    }
 
     Vec                   data_;
     ModellingBase       * forward_;
@@ -881,6 +1062,14 @@ protected:
     Vec  deltaDataIter_;
     Vec  deltaModelIter_;
 
+    /*! Per step caches of the transformed data/response and the
+     * transformation derivatives, filled by oneStep (the derivatives also
+     * by optLambda) and only valid within it. Public members recompute them. */
+    Vec  tData_;
+    Vec  tResponse_;
+    Vec  tmDeriv_;
+    Vec  tdDeriv_;
+
     int maxiter_;
     int iter_;
     int maxCGLSIter_;
@@ -895,6 +1084,11 @@ protected:
     bool isRobust_;
     bool isRunning_;
     bool useLinesearch_;
+    Index nThreadsEval_;
+    bool precondCGLS_;
+    double etaCGLS_;
+    double phiLastStep_;
+    Vec  lastDeltaModel_;
     bool optimizeLambda_;
     bool abort_;
     bool stopAtChi1_;
@@ -934,6 +1128,8 @@ const Vector < ModelValType > & Inversion< ModelValType >::start(){
 /*! Run inversion with current model. */
 template < class ModelValType >
 const Vector < ModelValType > & Inversion< ModelValType >::run(){ ALLOW_PYTHON_THREADS
+    //** reuse the storage of the many full size temporaries of each iteration
+    VectorArenaScope arena;
 
     if (model_.size() == 0) setModel(forward_->startModel());
 
@@ -954,6 +1150,11 @@ const Vector < ModelValType > & Inversion< ModelValType >::run(){ ALLOW_PYTHON_T
     //! () clear the model history
     modelHist_.clear();
 
+    //** no warm start of the inner CGLS from a previous run
+    etaCGLS_ = 0.0;
+    phiLastStep_ = 0.0;
+    lastDeltaModel_.clear();
+
     //! validate and rebuild the data error if necessary
     this->checkError();
 
@@ -1073,18 +1274,25 @@ const Vector < ModelValType > & Inversion< ModelValType >::run(){ ALLOW_PYTHON_T
         if (lambdaFactor_ > 0.0) max(lambdaMin_, lambda_ *= lambdaFactor_);
 
     } //** while iteration;
+    if (debug()) std::cout << "Vector arena: " << arena.stats() << std::endl;
     isRunning_ = false;
     ipc_.setBool("running", false);
     return model_;
 } //** run
 
 template < class Vec > bool Inversion< Vec>::oneStep() {
+    VectorArenaScope arena;
     iter_++;
     ipc_.setInt("Iter", iter_);
 
     deltaModelIter_.resize(model_.size());
     deltaModelIter_ *= 0.0;
-    deltaDataIter_ = (tD_->trans(data_) - tD_->trans(response_));
+    //** transformed data and derivatives are fixed during one step
+    tD_->trans_into(data_, tData_);
+    tD_->trans_into(response_, tResponse_);
+    deltaDataIter_ = tData_ - tResponse_;
+    tM_->deriv_into(model_, tmDeriv_);
+    tD_->deriv_into(response_, tdDeriv_);
 
     if (sum(abs(deltaDataIter_)) < TOLERANCE) {
         if (verbose_) std::cout << "sum(abs(deltaDataIter_)) == Zero" << std::endl;
@@ -1136,8 +1344,8 @@ template < class Vec > bool Inversion< Vec>::oneStep() {
 //        DOSAVE echoMinMax(deltaModel0, "dM0");
         DOSAVE echoMinMax(constraintsH_, "constraintsH");
         DOSAVE save(constraintsH_, "constraintsH");
-        DOSAVE save(tM_->deriv(model_), "modelTrans");
-        DOSAVE save(tD_->deriv(response_), "responseTrans");
+        DOSAVE save(tmDeriv_, "modelTrans");
+        DOSAVE save(tdDeriv_, "responseTrans");
 
         if (doBroydenUpdate_) { //!!! h-variante
            if (verbose_) std::cout << "solve CGLSCDWW with lambda = " << lambda_ << std::endl;
@@ -1158,12 +1366,41 @@ template < class Vec > bool Inversion< Vec>::oneStep() {
 //             solveCGLSCDWWhtransWB(scaledJacobian, weightedConstraints, dataWeight_, deltaDataIter_, deltaModelIter_,
 //                                    lambda_, roughness, maxCGLSIter_, verbose_);
 
-            solveCGLSCDWWhtrans(*forward_->jacobian(), *forward_->constraints(),
+            if (precondCGLS_){
+                //** Eisenstat-Walker forcing term (choice 2) from the misfit reduction
+                double phi = getPhi();
+                double eta = 0.1;
+                if (phiLastStep_ > 0.0) {
+                    eta = 0.9 * phi / phiLastStep_;
+                    double etaSafe = 0.9 * etaCGLS_ * etaCGLS_;
+                    if (etaSafe > 0.1) eta = max(eta, etaSafe);
+
+                    //** warm start with the last update, scaled like the misfit
+                    if (lastDeltaModel_.size() == deltaModelIter_.size()){
+                        deltaModelIter_ = lastDeltaModel_ * std::sqrt(min(phi / phiLastStep_, 1.0));
+                    }
+                }
+                etaCGLS_ = min(max(eta, 1e-4), 0.5);
+                phiLastStep_ = phi;
+
+                int nIter = solveCGLSCDWWhtransPrecond(*forward_->jacobian(),
+                                *forward_->constraints(),
                                 dataWeight_, deltaDataIter_, deltaModelIter_,
                                 constraintsWeight_, modelWeight_,
-                                tM_->deriv(model_), tD_->deriv(response_),
-                                lambda_, roughness, maxCGLSIter_, CGLStol_,
+                                tmDeriv_, tdDeriv_,
+                                lambda_, roughness, maxCGLSIter_, etaCGLS_,
                                 dosave_);
+                if (verbose_) std::cout << "preconditioned CGLS: " << nIter
+                                        << " iterations (eta = " << etaCGLS_
+                                        << ")" << std::endl;
+            } else {
+                solveCGLSCDWWhtrans(*forward_->jacobian(), *forward_->constraints(),
+                                    dataWeight_, deltaDataIter_, deltaModelIter_,
+                                    constraintsWeight_, modelWeight_,
+                                    tmDeriv_, tdDeriv_,
+                                    lambda_, roughness, maxCGLSIter_, CGLStol_,
+                                    dosave_);
+            }
         } // else no broyden
     } // else no optimization
 
@@ -1181,11 +1418,12 @@ template < class Vec > bool Inversion< Vec>::oneStep() {
     }
 
     Vec responseLast(response_);
+    //** not read only, a full step keeps the operator state, e.g., for the jacobian
     responseNew = forward_->response(modelNew);
 
     double tau = 1.0;
     if (useLinesearch_){
-        tau = linesearch(modelNew, responseNew);
+        tau = linesearch_(modelNew, responseNew, tData_, tResponse_);
     }
 
     if (tau >= 0.95){ //! full step possible;
@@ -1195,6 +1433,8 @@ template < class Vec > bool Inversion< Vec>::oneStep() {
         response_ = forward_->response(modelNew);
     }
 
+    if (precondCGLS_) lastDeltaModel_ = deltaModelIter_ * tau;
+
     model_ = modelNew;
     if (saveModelHistory_) save(model_, "model_" + toStr(iter_) PLUS_TMP_VECSUFFIX);
 
@@ -1238,6 +1478,9 @@ ALLOW_PYTHON_THREADS
     Vec tModel(tM_->trans(model_));
     Vec tResponse(tM_->trans(response_));
     Vec roughness(constraintsH_.size(), 0.0);
+    //** derivatives are the same for all lambdas
+    tM_->deriv_into(model_, tmDeriv_);
+    tD_->deriv_into(response_, tdDeriv_);
 
     if (!localRegularization_) {
         DOSAVE echoMinMax(model_, "model: ");
@@ -1261,7 +1504,7 @@ ALLOW_PYTHON_THREADS
     solveCGLSCDWWhtrans(*forward_->jacobian(), *forward_->constraints(),
                         dataWeight_, deltaDataIter_, deltaModel,
                         constraintsWeight_, modelWeight_,
-                        tM_->deriv(model_), tD_->deriv(response_),
+                        tmDeriv_, tdDeriv_,
                         lambda_, roughness, maxCGLSIter_, dosave_);
 
     Vec appModelStart(tM_->invTrans(tModel + deltaModel));
@@ -1277,6 +1520,9 @@ ALLOW_PYTHON_THREADS
     phiD.push_back(std::log(getPhiD())); phiDNorm = 1.0;
     if(verbose_) std::cout << "lambda(0) = inf" << " PhiD = " << phiD.back() << " PhiM = " << phiM.back()  << std::endl;
 
+    std::vector < Vec > batchDModel;
+    Index batchIdx = 0;
+
     int lambdaIter = 0;
     while (lambdaIter < 30) {
         lambdaIter++;
@@ -1284,11 +1530,35 @@ ALLOW_PYTHON_THREADS
 //        solveCGLSCDWWtrans(*J_, forward_->constraints(), dataWeight_, deltaData, deltaModel, constraintsWeight_,
 //                          modelWeight_, tM_->deriv(model_), tD_->deriv(response_),
 //                          lambda_, deltaModel0, maxCGLSIter_, verbose_);
-        solveCGLSCDWWhtrans(*forward_->jacobian(), *forward_->constraints(),
-                            dataWeight_, deltaDataIter_, deltaModel,
-                            constraintsWeight_, modelWeight_,
-                            tM_->deriv(model_), tD_->deriv(response_),
-                            lambda_, roughness, maxCGLSIter_, dosave_);
+        if (nThreadsEval_ > 1){
+            if (batchIdx == batchDModel.size()){
+                //** solve the next lambdas concurrently, all starting from the last solution
+                std::vector < double > lambdas;
+                double lam = lambda_;
+                for (int i = 0; i < (int)nThreadsEval_ && lambdaIter + i <= 30; i ++){
+                    lambdas.push_back(lam);
+                    lam *= 0.8;
+                }
+                batchDModel = std::vector < Vec >(lambdas.size(), deltaModel);
+                distributeCalc(CGLSLambdaMT< Vec >(batchDModel, lambdas,
+                                                   *forward_->jacobian(),
+                                                   *forward_->constraints(),
+                                                   dataWeight_, deltaDataIter_,
+                                                   constraintsWeight_, modelWeight_,
+                                                   tmDeriv_, tdDeriv_, roughness,
+                                                   maxCGLSIter_, -1.0, verbose_),
+                               lambdas.size(), lambdas.size(), verbose_);
+                batchIdx = 0;
+            }
+            deltaModel = batchDModel[batchIdx];
+            batchIdx ++;
+        } else {
+            solveCGLSCDWWhtrans(*forward_->jacobian(), *forward_->constraints(),
+                                dataWeight_, deltaDataIter_, deltaModel,
+                                constraintsWeight_, modelWeight_,
+                                tmDeriv_, tdDeriv_,
+                                lambda_, roughness, maxCGLSIter_, dosave_);
+        }
 
         Vec appModel(tM_->invTrans(tModel + deltaModel));
         Vec appResponse(tD_->invTrans(tResponse + *forward_->jacobian() * deltaModel));
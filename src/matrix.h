@@ -315,6 +315,8 @@ protected:
 
 //! Simple row-based dense matrix based on \ref Vector
 /*! Simple row-based dense matrix based on \ref Vector */
+template < class ValueType, class A > class __MatrixExpr;
+
 template < class ValueType > class DLLEXPORT Matrix : public MatrixBase {
 public:
     /*! Constructs an empty matrix with the dimension rows x cols. Content of the matrix is zero. */
@@ -344,6 +346,18 @@ public:
     Matrix(const Matrix < ValueType > & mat)
         : MatrixBase() { copy_(mat); }
 
+    /*! Construct from a lazy matrix expression, e.g., diag(d) * A * diag(m).
+     * Each entry is evaluated once without any intermediate matrix. */
+    template < class A > Matrix(const __MatrixExpr< ValueType, A > & expr)
+        : MatrixBase() { assign_(expr); }
+
+    /*! Assignment from a lazy matrix expression. The expression may refer
+     * to this matrix since all expressions are entrywise. */
+    template < class A > Matrix < ValueType > & operator = (const __MatrixExpr< ValueType, A > & expr){
+        assign_(expr);
+        return *this;
+    }
+
     /*! Assignment operator */
     Matrix < ValueType > & operator = (const Matrix< ValueType > & mat){
         if (this != & mat){
@@ -523,7 +537,7 @@ public:
         //ValueType tmpval = 0;
         if (b.size() == cols){
             for (Index i = 0; i < rows; ++i){
-                ret[i] = sum((*this)[i] * b);
+                ret[i] = GIMLI::dot((*this)[i], b);
             }
         } else {
             throwLengthError(1, WHERE_AM_I + " " + toStr(cols) + " != " + toStr(b.size()));
@@ -597,12 +611,117 @@ protected:
         for (Index i = 0; i < mat_.size(); i ++) mat_[i] = mat[i];
     }
 
+    template < class A > void assign_(const __MatrixExpr< ValueType, A > & expr){
+        allocate_(expr.rows(), expr.cols());
+        for (Index i = 0; i < mat_.size(); i ++){
+            ValueType * row = &mat_[i][0];
+            for (Index j = 0, jmax = mat_[i].size(); j < jmax; j ++) row[j] = expr(i, j);
+        }
+    }
+
 	std::vector < Vector< ValueType > > mat_;
 
     /*! BVector flag(rows) for free use, e.g., check if rows are set valid. */
     BVector rowFlag_;
 };
 
+//********************************************************************************
+//** Lazy matrix expressions. The entrywise operators + - * / stay eager,
+//** only the row/column scalings with diag(d) build a small expression
+//** object that is evaluated entry by entry on assignment or in a
+//** matrix-vector product,
+//** e.g., (diag(d) * J * diag(m)) * b never creates a scaled copy of J.
+//** Expressions keep references to their operands, so they must not
+//** outlive them.
+
+/*! Lazy diagonal matrix diag(d) used to scale rows or columns of matrix
+ * expressions. Holds a reference to d. */
+template < class ValueType > class DiagonalView {
+public:
+    DiagonalView(const Vector< ValueType > & d) : d_(&d) { }
+
+    inline const ValueType & operator [] (Index i) const { return (*d_)[i]; }
+
+    inline Index size() const { return d_->size(); }
+
+private:
+    const Vector< ValueType > * d_;
+};
+
+/*! Return the lazy diagonal matrix diag(d), e.g., for diag(d) * A * diag(m).
+ * The view holds a raw pointer to d, so a temporary d, e.g.,
+ * diag(RVector(a * b)), must not outlive the full expression:
+ * Matrix S(diag(a * b) * J) is fine, while keeping the expression or the
+ * view of a temporary beyond the statement leaves a dangling pointer. */
+template < class ValueType >
+DiagonalView< ValueType > diag(const Vector< ValueType > & d){
+    return DiagonalView< ValueType >(d);
+}
+
+template < class ValueType, class A > class __MatrixExpr {
+public:
+    __MatrixExpr(const A & a) : iter_(a) { }
+
+    inline ValueType operator () (Index i, Index j) const { return iter_(i, j); }
+
+    inline Index rows() const { return iter_.rows(); }
+
+    inline Index cols() const { return iter_.cols(); }
+
+private:
+    A iter_;
+};
+
+template < class ValueType > class __MatrixRef {
+public:
+    __MatrixRef(const Matrix< ValueType > & a) : a_(&a) { }
+
+    inline ValueType operator () (Index i, Index j) const { return (*a_)[i][j]; }
+
+    inline Index rows() const { return a_->rows(); }
+
+    inline Index cols() const { return a_->cols(); }
+
+private:
+    const Matrix< ValueType > * a_;
+};
+
+/*! diag(d) * A */
+template < class ValueType, class A > class __MatrixRowScaleOp {
+public:
+    __MatrixRowScaleOp(const DiagonalView< ValueType > & d, const A & a) : iter_(a), d_(d) {
+        ASSERT_EQUAL(d.size(), a.rows())
+    }
+
+    inline ValueType operator () (Index i, Index j) const { return d_[i] * iter_(i, j); }
+
+    inline Index rows() const { return iter_.rows(); }
+
+    inline Index cols() const { return iter_.cols(); }
+
+private:
+    A iter_;
+    DiagonalView< ValueType > d_;
+};
+
+/*! A * diag(d) */
+template < class ValueType, class A > class __MatrixColScaleOp {
+public:
+    __MatrixColScaleOp(const A & a, const DiagonalView< ValueType > & d) : iter_(a), d_(d) {
+        ASSERT_EQUAL(a.cols(), d.size())
+    }
+
+    inline ValueType operator () (Index i, Index j) const { return iter_(i, j) * d_[j]; }
+
+    inline Index rows() const { return iter_.rows(); }
+
+    inline Index cols() const { return iter_.cols(); }
+
+private:
+    A iter_;
+    DiagonalView< ValueType > d_;
+};
+
 #define DEFINE_BINARY_OPERATOR__(OP, NAME) \
 template < class ValueType > \
 Matrix < ValueType > operator OP (const Matrix < ValueType > & A, const Matrix < ValueType > & B) { \
@@ -620,6 +739,66 @@ DEFINE_BINARY_OPERATOR__(*, MULT)
 
 #undef DEFINE_BINARY_OPERATOR__
 
+template < class T >
+__MatrixExpr< T, __MatrixRowScaleOp< T, __MatrixRef< T > > >
+operator * (const DiagonalView< T > & d, const Matrix< T > & a){
+    typedef __MatrixRowScaleOp< T, __MatrixRef< T > > ExprT;
+    return __MatrixExpr< T, ExprT >(ExprT(d, __MatrixRef< T >(a)));
+}
+
+template < class T, class A >
+__MatrixExpr< T, __MatrixRowScaleOp< T, __MatrixExpr< T, A > > >
+operator * (const DiagonalView< T > & d, const __MatrixExpr< T, A > & a){
+    typedef __MatrixRowScaleOp< T, __MatrixExpr< T, A > > ExprT;
+    return __MatrixExpr< T, ExprT >(ExprT(d, a));
+}
+
+template < class T >
+__MatrixExpr< T, __MatrixColScaleOp< T, __MatrixRef< T > > >
+operator * (const Matrix< T > & a, const DiagonalView< T > & d){
+    typedef __MatrixColScaleOp< T, __MatrixRef< T > > ExprT;
+    return __MatrixExpr< T, ExprT >(ExprT(__MatrixRef< T >(a), d));
+}
+
+template < class T, class A >
+__MatrixExpr< T, __MatrixColScaleOp< T, __MatrixExpr< T, A > > >
+operator * (const __MatrixExpr< T, A > & a, const DiagonalView< T > & d){
+    typedef __MatrixColScaleOp< T, __MatrixExpr< T, A > > ExprT;
+    return __MatrixExpr< T, ExprT >(ExprT(a, d));
+}
+
+/*! Multiplication (A*b) of a matrix expression, evaluated row by row
+ * without building the matrix. */
+template < class T, class A >
+Vector< T > mult(const __MatrixExpr< T, A > & a, const Vector< T > & b){
+    ASSERT_EQUAL(a.cols(), b.size())
+    Vector< T > ret(a.rows());
+    for (Index i = 0, imax = a.rows(); i < imax; i ++){
+        T s(0);
+        for (Index j = 0, jmax = a.cols(); j < jmax; j ++) s += a(i, j) * b[j];
+        ret[i] = s;
+    }
+    return ret;
+}
+
+template < class T, class A >
+Vector< T > operator * (const __MatrixExpr< T, A > & a, const Vector< T > & b){
+    return mult(a, b);
+}
+
+/*! Transpose multiplication (A^T*b) of a matrix expression, evaluated row
+ * by row without building the matrix. */
+template < class T, class A >
+Vector< T > transMult(const __MatrixExpr< T, A > & a, const Vector< T > & b){
+    ASSERT_EQUAL(a.rows(), b.size())
+    Vector< T > ret(a.cols(), T(0));
+    for (Index i = 0, imax = a.rows(); i < imax; i ++){
+        T bi = b[i];
+        for (Index j = 0, jmax = a.cols(); j < jmax; j ++) ret[j] += a(i, j) * bi;
+    }
+    return ret;
+}
+
 template< class ValueType > class DLLEXPORT Mult{
 public:
     Mult(Vector< ValueType > & x, const Vector< ValueType > & b, const Matrix < ValueType > & A, Index start, Index end) :
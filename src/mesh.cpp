@@ -18,12 +18,14 @@
 
 #include "mesh.h"
 
-#include "kdtreeWrapper.h"
+#include "elementmatrix.h"
+
 #include "memwatch.h"
 #include "meshentities.h"
 #include "node.h"
 #include "shape.h"
 #include "sparsematrix.h"
+#include "spatialindex.h"
 #include "stopwatch.h"
 
 #include <boost/bind.hpp>
@@ -46,6 +48,8 @@ Mesh::Mesh(Index dim)
 
     oldTet10NumberingStyle_ = true;
     cellToBoundaryInterpolationCache_ = 0;
+    cellGradientCache_ = 0;
+    cellGradientCacheValid_ = false;
 }
 
 Mesh::Mesh(const std::string & filename, bool createNeighbourInfos)
@@ -57,6 +61,8 @@ Mesh::Mesh(const std::string & filename, bool createNeighbourInfos)
     dimension_ = 3;
     oldTet10NumberingStyle_ = true;
     cellToBoundaryInterpolationCache_ = 0;
+    cellGradientCache_ = 0;
+    cellGradientCacheValid_ = false;
     load(filename, createNeighbourInfos);
 }
 
@@ -68,6 +74,8 @@ Mesh::Mesh(const Mesh & mesh)
 
     oldTet10NumberingStyle_ = true;
     cellToBoundaryInterpolationCache_ = 0;
+    cellGradientCache_ = 0;
+    cellGradientCacheValid_ = false;
     copy_(mesh);
 }
 
@@ -117,18 +125,35 @@ void Mesh::copy_(const Mesh & mesh){
 
 Mesh::~Mesh(){
     clear();
+    if (cellGradientCache_) delete cellGradientCache_;
 }
 
 void Mesh::setStaticGeometry(bool stat){
     staticGeometry_ = stat;
+    clearGeometryCache_();
 }
 
-void Mesh::clear(){
-    if (tree_) {
-        deletePtr()(tree_);
-        tree_ = NULL;
+void Mesh::clearGeometryCache_() const {
+    //** keep the object, references to it stay valid
+    cellGradientCacheValid_ = false;
+    if (tree_){
+        delete tree_;
+        tree_ = 0;
     }
+}
 
+const CellGradientCache & Mesh::cellGradientCache() const {
+    if (!cellGradientCache_){
+        cellGradientCache_ = new CellGradientCache(*this);
+    } else if (!cellGradientCacheValid_ || !staticGeometry_ ||
+               cellGradientCache_->size() != cellCount()){
+        cellGradientCache_->update(*this);
+    }
+    cellGradientCacheValid_ = true;
+    return *cellGradientCache_;
+}
+
+void Mesh::clear(){
     for_each(cellVector_.begin(), cellVector_.end(), deletePtr());
     cellVector_.clear();
 
@@ -140,7 +165,9 @@ void Mesh::clear(){
 
     if (cellToBoundaryInterpolationCache_){
         delete cellToBoundaryInterpolationCache_;
+        cellToBoundaryInterpolationCache_ = 0;
     }
+    clearGeometryCache_();
 
     rangesKnown_ = false;
     neighboursKnown_ = false;
@@ -172,9 +199,10 @@ Node * Mesh::createNodeWithCheck(const RVector3 & pos, double tol, bool warn){
         fillKDTree_();
         useTree = true;
 
-        Node * refNode = tree_->nearest(pos);
-        if (refNode){
-            if (pos.distance(refNode->pos()) < tol) {
+        if (tree_->size() > 0){
+            double dist = 0.0;
+            Node * refNode = nodeVector_[tree_->nearest(pos, &dist)];
+            if (dist < tol) {
                 if (warn || debug()) log(LogType::Warning,
                     "Duplicated node found for: " + str(pos));
                 return refNode;
@@ -187,10 +215,75 @@ Node * Mesh::createNodeWithCheck(const RVector3 & pos, double tol, bool warn){
     }
 
     Node * newNode = createNode(pos);
-    if (useTree) tree_->insert(newNode);
+    if (useTree) tree_->insert(newNode->pos(), nodeVector_.size() - 1);
     return newNode;
 }
 
+IndexArray Mesh::createNodesWithCheck(const R3Vector & pos, double tol,
+                                      const IVector & markers){
+    if (markers.size() > 0 && markers.size() != pos.size()){
+        throwLengthError(1, WHERE_AM_I + " markers.size() != pos.size() "
+                         + str(markers.size()) + " " + str(pos.size()));
+    }
+    IndexArray ret(pos.size());
+    nodeVector_.reserve(nodeCount() + pos.size());
+
+    if (tol <= -1.0){
+        for (Index i = 0; i < pos.size(); i ++){
+            ret[i] = createNode_(pos[i], markers.size() ? markers[i] : 0, -1)->id();
+        }
+        return ret;
+    }
+
+    //** nearest existing node for all positions at once
+    IndexArray nearest;
+    if (nodeCount() > 0){
+        fillKDTree_();
+        nearest = tree_->nearest(pos);
+    }
+    //** neighbours within the incoming positions, sorted by distance
+    SpatialIndex posTree(pos);
+    std::vector< IndexArray > near(posTree.radius(pos, tol));
+
+    Index nNodes = nodeCount();
+    IndexArray nodeIdx(pos.size(), 0);
+    std::vector< bool > isNew(pos.size(), false);
+
+    for (Index i = 0; i < pos.size(); i ++){
+        double dist = tol;
+        Node * n = 0;
+        if (nearest.size()){
+            double d = pos[i].distance(nodeVector_[nearest[i]]->pos());
+            if (d < dist){
+                dist = d;
+                n = nodeVector_[nearest[i]];
+            }
+        }
+        //** the nearest previous position that created a node
+        for (Index j = 0; j < near[i].size(); j ++){
+            Index k = near[i][j];
+            if (k < i && isNew[k]){
+                double d = pos[i].distance(pos[k]);
+                if (d < dist) n = nodeVector_[nodeIdx[k]];
+                break;
+            }
+        }
+
+        if (!n){
+            n = createNode_(pos[i], markers.size() ? markers[i] : 0, -1);
+            nodeIdx[i] = nodeVector_.size() - 1;
+            isNew[i] = true;
+        }
+        ret[i] = n->id();
+    }
+
+    if (debug() && nodeCount() - nNodes < pos.size()){
+        log(LogType::Warning, "Duplicated nodes found: "
+            + str(pos.size() - (nodeCount() - nNodes)));
+    }
+    return ret;
+}
+
 Boundary * Mesh::createBoundary(const IndexArray & idx, int marker, bool check){
     std::vector < Node * > nodes(idx.size());
     for (Index i = 0; i < idx.size(); i ++ ) nodes[i] = &this->node(idx[i]);
@@ -348,6 +441,42 @@ Boundary * Mesh::copyBoundary(const Boundary & bound, double tol, bool check){
 }
 
 
+IndexArray Mesh::merge(const Mesh & mesh, double tol, bool copyBoundaries){
+    Index nNodes = nodeCount();
+    IndexArray nodeMap(createNodesWithCheck(mesh.positions(), tol,
+                                            mesh.nodeMarkers()));
+
+    for (Index i = 0; i < nodeMap.size(); i ++){
+        if (nodeMap[i] < nNodes && mesh.node(i).marker() != 0){
+            nodeVector_[nodeMap[i]]->setMarker(mesh.node(i).marker());
+        }
+    }
+
+    cellVector_.reserve(cellCount() + mesh.cellCount());
+    std::vector < Node * > nodes;
+    for (Index i = 0; i < mesh.cellCount(); i ++){
+        const Cell & cell = mesh.cell(i);
+        nodes.resize(cell.nodeCount());
+        for (Index j = 0; j < nodes.size(); j ++){
+            nodes[j] = nodeVector_[nodeMap[cell.node(j).id()]];
+        }
+        Cell * c = createCell(nodes, cell.marker());
+        c->setAttribute(cell.attribute());
+    }
+
+    if (copyBoundaries){
+        for (Index i = 0; i < mesh.boundaryCount(); i ++){
+            const Boundary & bound = mesh.boundary(i);
+            nodes.resize(bound.nodeCount());
+            for (Index j = 0; j < nodes.size(); j ++){
+                nodes[j] = nodeVector_[nodeMap[bound.node(j).id()]];
+            }
+            createBoundary(nodes, bound.marker(), true);
+        }
+    }
+    return nodeMap;
+}
+
 void Mesh::deleteCells(const std::vector < Cell * > & cells){
     THROW_TO_IMPL
 }
@@ -424,7 +553,20 @@ void Mesh::createHull(const Mesh & mesh){
 
 Index Mesh::findNearestNode(const RVector3 & pos){
     fillKDTree_();
-    return tree_->nearest(pos)->id();
+    if (tree_->size() == 0){
+        throwError(1, WHERE_AM_I + " no nearest node to pos. This is a empty mesh");
+    }
+    return nodeVector_[tree_->nearest(pos)]->id();
+}
+
+IndexArray Mesh::findNearestNode(const R3Vector & pos){
+    fillKDTree_();
+    if (tree_->size() == 0){
+        throwError(1, WHERE_AM_I + " no nearest node to pos. This is a empty mesh");
+    }
+    IndexArray ret(tree_->nearest(pos));
+    for (Index i = 0; i < ret.size(); i ++) ret[i] = nodeVector_[ret[i]]->id();
+    return ret;
 }
 
 IndexArray cellIDX__;
@@ -441,7 +583,7 @@ Cell * Mesh::findCellBySlopeSearch_(const RVector3 & pos, Cell * start,
         } else {
             cell->tag();
             cellIDX__.push_back(cell->id());
-            RVector sf;
+            int exitFace = -1;
 
 //             std::cout << cellIDX__.size() << " testpos: " << pos << std::endl;
 //             std::cout << "cell: " << *cell << " touch: " << cell->shape().isInside(pos, true) << std::endl;
@@ -449,7 +591,7 @@ Cell * Mesh::findCellBySlopeSearch_(const RVector3 & pos, Cell * start,
 //                 std::cout << cell->node(i)<< std::endl;
 //             }
 
-            if (cell->shape().isInside(pos, sf, false)) {
+            if (cell->shape().isInsideOrExit(pos, exitFace)) {
                 return cell;
             } else {
 
@@ -468,7 +610,13 @@ Cell * Mesh::findCellBySlopeSearch_(const RVector3 & pos, Cell * start,
 //                     }
 //                 }
 
-                cell = cell->neighbourCell(sf);
+                if (exitFace > -1 && exitFace < (int)cell->neighbourCellCount()){
+                    cell = cell->neighbourCell(exitFace);
+                } else {
+                    RVector sf;
+                    cell->shape().isInside(pos, sf, false);
+                    cell = cell->neighbourCell(sf);
+                }
 
 //                 std::cout << "sf: " << sf << std::endl;
 //                 std::cout << "neighCell " << cell << std::endl;
@@ -518,7 +666,8 @@ Cell * Mesh::findCell(const RVector3 & pos, size_t & count,
         cellIDX__.clear();
         count = 0;
         fillKDTree_();
-        Node * refNode = tree_->nearest(pos);
+        Node * refNode = 0;
+        if (tree_->size() > 0) refNode = nodeVector_[tree_->nearest(pos)];
 
         if (!refNode){
             std::cout << "pos: " << pos << std::endl;
@@ -1910,6 +2059,7 @@ Mesh & Mesh::scale(const RVector3 & s){
                   boost::bind(& RVector3::scale, _1, boost::ref(s)));
 
     rangesKnown_ = false;
+    clearGeometryCache_();
     return *this;
 }
 
@@ -1922,6 +2072,7 @@ Mesh & Mesh::translate(const RVector3 & t){
                   boost::bind(& RVector3::translate, _1, boost::ref(t)));
 
     rangesKnown_ = false;
+    clearGeometryCache_();
     return *this;
 }
 
@@ -1934,6 +2085,7 @@ Mesh & Mesh::rotate(const RVector3 & r){
                   boost::bind(& RVector3::rotate, _1, boost::ref(r)));
 
     rangesKnown_ = false;
+    clearGeometryCache_();
     return *this;
 }
 
@@ -1945,6 +2097,7 @@ void Mesh::swapCoordinates(Index i, Index j){
                 nodeVector_[n]->at(i) = nodeVector_[n]->at(j);
                 nodeVector_[n]->at(j) = tmp;
             }
+            clearGeometryCache_();
         }
     }
 }
@@ -1975,6 +2128,7 @@ void Mesh::relax(){
 
 void Mesh::smooth(bool nodeMoving, bool edgeSliding, uint smoothFunction, uint smoothIteration){
     createNeighbourInfos();
+    clearGeometryCache_();
 
     for (Index j = 0; j < smoothIteration; j++){
 //         if (edgeSwapping) {
@@ -2039,21 +2193,15 @@ void Mesh::smooth(bool nodeMoving, bool edgeSliding, uint smoothFunction, uint s
 }
 
 void Mesh::fillKDTree_() const {
+    if (!tree_) tree_ = new SpatialIndex();
 
-    if (!tree_) tree_ = new KDTreeWrapper();
-
+    //** the index holds the position in nodeVector_, so any change of the
+    //** node count invalidates it
     if (tree_->size() != nodeCount()){
-        if (tree_->size() == 0){
-//            for (Index i = 0; i < nodeCount(); i ++) tree_->insert(nodeVector_[i]);
-            for_each(nodeVector_.begin(), nodeVector_.end(), boost::bind(&KDTreeWrapper::insert, tree_, _1));
-
-            tree_->tree()->optimize();
-        } else {
-            throwError(1, WHERE_AM_I + toStr(this) + " kd-tree is only partially filled: this should no happen: nodeCount = " + toStr(nodeCount())
-                                      + " tree-size() " + toStr(tree_->size()));
-        }
+        R3Vector pos(nodeCount());
+        for (Index i = 0; i < nodeCount(); i ++) pos[i] = nodeVector_[i]->pos();
+        tree_->build(pos);
     }
-
 }
 
 void Mesh::addRegionMarker(const RegionMarker & reg){
@@ -32,7 +32,8 @@
 
 namespace GIMLI{
 
-class KDTreeWrapper;
+class SpatialIndex;
+class CellGradientCache;
 
 template < class T > class DLLEXPORT BoundingBox;
 typedef BoundingBox< double > RBoundingBox;
@@ -177,6 +178,14 @@ public:
     Node * createNodeWithCheck(const RVector3 & pos, double tol=1e-6,
                                bool warn=false);
 
+    /*! Bulk version of \ref createNodeWithCheck for all pos. A node is
+     * reused if it already exists, or was created for a previous pos, within
+     * the tolerance distance tol. tol=-1 disables the duplication check.
+     * The new nodes get the corresponding markers if given.
+     * Returns the node index for every pos. */
+    IndexArray createNodesWithCheck(const R3Vector & pos, double tol=1e-6,
+                                    const IVector & markers=IVector(0));
+
     Boundary * createBoundary(std::vector < Node * > & nodes, int marker=0, bool check=true);
     /*! Create a boundary from the given node indieces */
     Boundary * createBoundary(const IndexArray & nodes, int marker=0, bool check=true);
@@ -209,6 +218,13 @@ public:
      * tol=-1 disables this duplication check. */
     Boundary * copyBoundary(const Boundary & bound, double tol=1e-6, bool check=true);
 
+    /*! Copy all cells and, if copyBoundaries is set, all boundaries of mesh
+     * into this mesh. The nodes of mesh are snapped to the existing nodes in
+     * one pass, see \ref createNodesWithCheck. Reused nodes take the marker
+     * of the copied node if it is not 0. Returns the index of the
+     * corresponding node in this mesh for every node of mesh. */
+    IndexArray merge(const Mesh & mesh, double tol=1e-6, bool copyBoundaries=true);
+
     /*! Delete all given cells from the given mesh. Warning will be really deleted.*/
     void deleteCells(const std::vector < Cell * > & cells);
 
@@ -325,6 +341,14 @@ public:
     /*! Return the reference to a RVector of all boundary sizes. Cached for static geometry. */
     RVector & boundarySizes() const;
 
+    /*! Return the per-cell stiffness matrices and shape function gradients,
+     * see \ref CellGradientCache. Build on first call, in parallel. For static
+     * geometry it is kept until the geometry changes, else rebuild on every
+     * call. The rebuild happens in place, so the reference stays valid for
+     * the lifetime of the mesh and shows the content of the latest call.
+     * The cell ids need to be [0, cellCount). Not thread safe. */
+    const CellGradientCache & cellGradientCache() const;
+
     /*! Return the reference to the vector of scaled normal directions for each boundary.
      * Cached for static geometry and will be build on first call. Not thread safe, perhaps not python GC safe.
      Return \f$ \{A_i \vec{n}_i\} \forall i = [0..N_B]\f$.
@@ -378,6 +402,10 @@ public:
     /*! Return the index to the node of this mesh with the smallest distance to pos. */
     Index findNearestNode(const RVector3 & pos);
 
+    /*! Return the indices to the nearest nodes for all positions. The
+     * queries are distributed over \ref threadCount() threads. */
+    IndexArray findNearestNode(const R3Vector & pos);
+
     /*! Return vector of cell ptrs with marker match the range [from .. to). \n
         For single marker match to is set to 0, for open end set to = -1 */
     std::vector < Cell * > findCellByMarker(int from, int to=0) const;
@@ -453,6 +481,7 @@ public:
 //                        bind2nd(std::mem_fun(&Node::pos().transform), mat));
         for (uint i = 0; i < nodeVector_.size(); i ++) nodeVector_[i]->pos().transform(mat);
         rangesKnown_ = false;
+        clearGeometryCache_();
         return *this;
     }
 
@@ -688,6 +717,9 @@ protected:
 
     void findRange_() const ;
 
+    /*! Invalidate the \ref CellGradientCache and drop the node search tree after geometry changes. */
+    void clearGeometryCache_() const;
+
     Node * createNode_(const RVector3 & pos, int marker, int id);
 
     template < class B > Boundary * createBoundary_(
@@ -745,7 +777,7 @@ protected:
 
     bool neighboursKnown_;
 
-    mutable KDTreeWrapper * tree_;
+    mutable SpatialIndex * tree_;
 
     /*! A static geometry mesh caches geometry informations. */
     bool staticGeometry_;
@@ -754,6 +786,8 @@ protected:
     mutable R3Vector boundarySizedNormCache_;
 
     mutable RSparseMapMatrix * cellToBoundaryInterpolationCache_;
+    mutable CellGradientCache * cellGradientCache_;
+    mutable bool cellGradientCacheValid_;
 
     bool oldTet10NumberingStyle_;
 
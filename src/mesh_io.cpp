@@ -1461,13 +1461,11 @@ void Mesh::importSTL(const std::string & fileName, bool isBinary ){
         fclose(file);
     } // end import binary STL format
 
-    Node *n1, *n2, *n3;
     if (allVerts.size() % 3 == 0 && allVerts.size() > 0){
+        IndexArray idx(createNodesWithCheck(allVerts, tolerance));
         for (uint i = 0; i < allVerts.size() / 3; i ++){
-            n1 = createNodeWithCheck(allVerts[i * 3], tolerance);
-            n2 = createNodeWithCheck(allVerts[i * 3 + 1], tolerance);
-            n3 = createNodeWithCheck(allVerts[i * 3 + 2], tolerance);
-            this->createTriangleFace(*n1, *n2, *n3, 0);
+            this->createTriangleFace(node(idx[i * 3]), node(idx[i * 3 + 1]),
+                                     node(idx[i * 3 + 2]), 0);
         }
     } else {
         throwError(1,  WHERE_AM_I + " there is something wrong in ascii-stl-format "
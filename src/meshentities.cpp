@@ -292,6 +292,24 @@ RVector MeshEntity::dNdL(const RVector3 & rst, uint i) const {
 
 
 double MeshEntity::pot(const RVector3 & xyz, const RVector & u) const {
+    //** closed-form barycentric interpolation for linear triangles and tetrahedrons
+    if (shape_->nodeCount() == this->nodeCount()){
+        if (shape_->rtti() == MESH_SHAPE_TRIANGLE_RTTI){
+            double L[3];
+            static_cast< const TriangleShape * >(shape_)->barycentric(xyz, L);
+            return L[0] * u[nodeVector_[0]->id()] +
+                   L[1] * u[nodeVector_[1]->id()] +
+                   L[2] * u[nodeVector_[2]->id()];
+        }
+        if (shape_->rtti() == MESH_SHAPE_TETRAHEDRON_RTTI){
+            double L[4];
+            static_cast< const TetrahedronShape * >(shape_)->barycentric(xyz, L);
+            return L[0] * u[nodeVector_[0]->id()] +
+                   L[1] * u[nodeVector_[1]->id()] +
+                   L[2] * u[nodeVector_[2]->id()] +
+                   L[3] * u[nodeVector_[3]->id()];
+        }
+    }
     return sum(u(this->ids()) * this->N(shape().rst(xyz)));
 }
 
@@ -361,8 +379,9 @@ Boundary * Cell::boundaryTo(const RVector & sf){
     double maxSF = max(sf);
     double minSF = min(sf);
 
-    IndexArray maxIdx(find(sf == maxSF));
-    IndexArray minIdx(find(sf == minSF));
+    //** equal shape functions may differ by rounding
+    IndexArray maxIdx(find(abs(sf - maxSF) < TOLERANCE));
+    IndexArray minIdx(find(abs(sf - minSF) < TOLERANCE));
 
     std::set < Boundary * > common;
 
@@ -152,14 +152,6 @@ public:
 //
 //   inline std::vector < Node * >::iterator * end() { return nodeVector_.end(); }
 
-//    void setUxCache(const ElementMatrix < double >  & mat) const { uxCache_ = mat; }
-
- //   const ElementMatrix < double > & uxCache() const { return uxCache_; }
-
-    void setUxCache(const RMatrix & mat) const { uxCache_ = mat; }
-
-    const RMatrix & uxCache() const { return uxCache_; }
-
 protected:
     void fillShape_();
 
@@ -171,10 +163,6 @@ protected:
 
     std::vector < Node * > nodeVector_;
 
-    /*! Cache for derivation matrixes */
-    //mutable ElementMatrix < double > uxCache_; // to expensive maybe, lightweight baseclass here
-    mutable RMatrix uxCache_;
-
 protected:
     /*! do not copy a mesh entity at all */
     MeshEntity(const MeshEntity & ent){
@@ -59,6 +59,7 @@ ModellingBase::~ModellingBase() {
     if (mesh_) delete mesh_;
     if (jacobian_ && ownJacobian_) delete jacobian_;
     if (constraints_ && ownConstraints_) delete constraints_;
+    if (constraintsMap_) delete constraintsMap_;
 }
 
 void ModellingBase::init_() {
@@ -68,6 +69,7 @@ void ModellingBase::init_() {
     mesh_               = 0;
     jacobian_           = 0;
     constraints_        = 0;
+    constraintsMap_     = 0;
     dataContainer_      = 0;
 
     nThreads_           = numberOfCPU();
@@ -221,9 +223,62 @@ void ModellingBase::setMultiThreadJacobian(Index nThreads){
     nThreadsJacobian_ = max(1, nThreads);
 }
 
+void ModellingBase::prepareResponse_mt(){
+    if (mesh_) mesh_->createNeighbourInfos();
+}
+
+class ResponseBaseMT : public GIMLI::BaseCalcMT{
+public:
+    ResponseBaseMT(std::vector < RVector > * resps,
+                   const ModellingBase & fop,
+                   const std::vector < RVector > & models,
+                   Index count,
+                   bool verbose)
+    : BaseCalcMT(count, verbose), resps_(resps), fop_(&fop), models_(&models){
+    }
+
+    virtual ~ResponseBaseMT(){}
+
+    virtual void calc(Index tNr=0){
+        for (Index i = start_; i < end_; i ++){
+            //** each thread writes its own responses only
+            (*resps_)[i] = fop_->response_mt((*models_)[i], tNr);
+        }
+    }
+
+protected:
+    std::vector < RVector >         * resps_;
+    const ModellingBase             * fop_;
+    const std::vector < RVector >   * models_;
+};
+
+std::vector < RVector > ModellingBase::responses(const std::vector < RVector > & models,
+                                                 Index nThreads){
+    std::vector < RVector > resps(models.size());
+    if (models.size() == 0) return resps;
+
+    nThreads = min(max(nThreads, (Index)1), (Index)models.size());
+
+    if (nThreads == 1){
+        for (Index i = 0; i < models.size(); i ++) resps[i] = this->response(models[i]);
+        return resps;
+    }
+
+    Stopwatch swatch(true);
+    this->prepareResponse_mt();
+
+    ALLOW_PYTHON_THREADS
+    distributeCalc(ResponseBaseMT(&resps, *this, models, 1, verbose_),
+                   models.size(), nThreads, verbose_);
+
+    if (verbose_) std::cout << models.size() << " responses (mt, " << nThreads
+                            << " threads) ... " << swatch.duration() << " s." << std::endl;
+    return resps;
+}
+
 class JacobianBaseMT : public GIMLI::BaseCalcMT{
 public:
-    JacobianBaseMT(MatrixBase * J,
+    JacobianBaseMT(RMatrix * J,
                    const ModellingBase & fop,
                    const RVector & resp,
                    const RVector & model,
@@ -237,17 +292,23 @@ public:
     virtual ~JacobianBaseMT(){}
 
     virtual void calc(Index tNr=0){
-        RVector modelChange(*model_);
-        modelChange[tNr] *= 1.05;
-        __MS(tNr)
-        fop_->response_mt(modelChange, tNr);
-//         RVector respChange();
-
-        //J_->setCol(tNr, (respChange - *resp_)/(modelChange[tNr] - (*model_)[tNr]));
+        for (Index i = start_; i < end_; i ++){
+            RVector modelChange(*model_);
+            modelChange[i] *= 1.05;
+
+            double dModel = modelChange[i] - (*model_)[i];
+            if (::fabs(dModel) > TOLERANCE){
+                RVector respChange(fop_->response_mt(modelChange, tNr));
+                //** each thread writes its own columns only
+                J_->setCol(i, (respChange - *resp_) / dModel);
+            } else {
+                J_->setCol(i, RVector(resp_->size(), 0.0));
+            }
+        }
     }
 
 protected:
-    MatrixBase              * J_;
+    RMatrix                 * J_;
     const ModellingBase     * fop_;
     const RVector           * resp_;
     const RVector           * model_;
@@ -256,11 +317,9 @@ protected:
 
 void ModellingBase::createJacobian_mt(const RVector & model,
                                       const RVector & resp){
-    THROW_TO_IMPL
     if (verbose_) std::cout << "Create Jacobian matrix (brute force, mt) ...";
 
     Stopwatch swatch(true);
-    double fak = 1.05;
 
     if (!jacobian_){
         this->initJacobian();
@@ -268,10 +327,13 @@ void ModellingBase::createJacobian_mt(const RVector & model,
     RMatrix *J = dynamic_cast< RMatrix * >(jacobian_);
     if (J->rows() != resp.size()){ J->resize(resp.size(), model.size()); }
 
+    this->prepareResponse_mt();
 
     ALLOW_PYTHON_THREADS
-    distributeCalc(JacobianBaseMT(jacobian_, *this, resp, model, 0, verbose_),
-                   jacobian_->rows(), nThreadsJacobian_, verbose_);
+    distributeCalc(JacobianBaseMT(J, *this, resp, model, 1, verbose_),
+                   model.size(),
+                   max(Index(1), min(nThreadsJacobian_, model.size())),
+                   verbose_);
     swatch.stop();
     if (verbose_) std::cout << " ... " << swatch.duration() << " s." << std::endl;
 }
@@ -319,6 +381,7 @@ void ModellingBase::createJacobian(const RVector & model,
 void ModellingBase::createJacobian(const RVector & model){
     RVector resp;
     if (nThreadsJacobian_ > 1){
+        this->prepareResponse_mt();
         resp = response_mt(model);
     } else {
         resp = response(model);
@@ -343,7 +406,7 @@ void ModellingBase::createJacobian(const RVector & model){
 
 void ModellingBase::initConstraints(){
     if (constraints_ == 0){
-        constraints_ = new RSparseMapMatrix(0, 0, 0);
+        constraints_ = new SparseRowMatrix(0, 0);
         ownConstraints_ = true;
     }
 }
@@ -354,15 +417,22 @@ void ModellingBase::setConstraints(MatrixBase * C){
     }
     constraints_ = C;
     ownConstraints_ = false;
+    if (constraintsMap_) { delete constraintsMap_; constraintsMap_ = 0; }
 }
 
 void ModellingBase::createConstraints(){
 //     __MS(constraints_->rtti())
-    this->regionManager().fillConstraints(constraintsRef());
+    if (constraints_ && constraints_->rtti() == GIMLI_SPARSEROWMATRIX_RTTI){
+        this->regionManager().fillConstraints(*dynamic_cast < SparseRowMatrix *>(constraints_));
+    } else {
+        this->regionManager().fillConstraints(constraintsRef());
+    }
+    if (constraintsMap_) { delete constraintsMap_; constraintsMap_ = 0; }
 }
 
 void ModellingBase::clearConstraints(){
     if (constraints_) constraints_->clear();
+    if (constraintsMap_) { delete constraintsMap_; constraintsMap_ = 0; }
 }
 
 MatrixBase * ModellingBase::constraints() {
@@ -375,12 +445,19 @@ MatrixBase * ModellingBase::constraints() const {
 
 RSparseMapMatrix & ModellingBase::constraintsRef() const {
     if (!constraints_) throwError(1, WHERE_AM_I + " constraints matrix is not initialized.");
+    if (constraints_->rtti() == GIMLI_SPARSEROWMATRIX_RTTI){
+        //** read-only copy of the compressed constraints
+        if (!constraintsMap_){
+            constraintsMap_ = new RSparseMapMatrix(0, 0, 0);
+            dynamic_cast < SparseRowMatrix *>(constraints_)->toSparseMapMatrix(*constraintsMap_);
+        }
+        return *constraintsMap_;
+    }
     return *dynamic_cast < RSparseMapMatrix *>(constraints_);
 }
 
 RSparseMapMatrix & ModellingBase::constraintsRef() {
-    if (!constraints_) throwError(1, WHERE_AM_I + " constraints matrix is not initialized.");
-    return *dynamic_cast < RSparseMapMatrix *>(constraints_);
+    return static_cast< const ModellingBase & >(*this).constraintsRef();
 }
 
 RVector ModellingBase::createMappedModel(const RVector & model, double background) const{
@@ -393,7 +470,6 @@ RVector ModellingBase::createMappedModel(const RVector & model, double backgroun
 
     int marker = -1;
     std::vector< Cell * > emptyList;
-    mesh_->createNeighbourInfos();
 
     for (Index i = 0, imax = mesh_->cellCount(); i < imax; i ++){
         marker = mesh_->cell(i).marker();
@@ -428,6 +504,11 @@ RVector ModellingBase::createMappedModel(const RVector & model, double backgroun
     }
 
     if (background != 0.0){
+        if (background == -1.0 && !mesh_->neighboursKnown()){
+            // no write access to the mesh here, see prepareResponse_mt
+            throwError(1, WHERE_AM_I + " prolongation needs the neighbour "
+                       "infos of the mesh. Call prepareResponse_mt() first.");
+        }
         mesh_->prolongateEmptyCellsValues(cellAtts, background);
     }
 
@@ -450,66 +531,10 @@ RVector ModellingBase::createMappedModel(const RVector & model, double backgroun
 }
 
 void ModellingBase::mapModel(const RVector & model, double background){
-    // implement "readonly version"!!!!!!!!!!!
-    mesh_->setCellAttributes(createMappedModel(model, background));
-
-    return;
-
-    mesh_->setCellAttributes(RVector(mesh_->cellCount(), 0.0));
-
-    int marker = -1;
-    std::vector< Cell * > emptyList;
-    mesh_->createNeighbourInfos();
-
-    for (Index i = 0, imax = mesh_->cellCount(); i < imax; i ++){
-        marker = mesh_->cell(i).marker();
-        if (marker >= 0) {
-            if ((size_t)marker >= model.size()){
-                mesh_->exportVTK("mapModelfail");
-                std::cerr << WHERE_AM_I << std::endl
-                          << "Wrong mesh here .. see mapModelfail.vtk" << std::endl
-                          << *mesh_ << std::endl
-                          << "mesh contains " << unique(sort(mesh_->cellMarkers())).size() << " unique marker. " << std::endl;
-                throwLengthError(1, WHERE_AM_I + " marker greater = then model.size() " + toStr(marker)
-                       + " >= " + toStr(model.size()));
-            }
-            if (model[marker] < TOLERANCE){
-                emptyList.push_back(&mesh_->cell(i));
-            }
-            mesh_->cell(i).setAttribute(model[marker]);
-
-        } else {
-            // general background without fixed values, fixed values will be set at the end
-            if (marker == -1) {
-                mesh_->cell(i).setAttribute(0.0);
-                emptyList.push_back(&mesh_->cell(i));
-            }
-        }
-    }
-
-    // if background == 0.0 .. empty cells are allowed
-    if (emptyList.size() == mesh_->cellCount() && background != 0.0){
-        throwLengthError(1, WHERE_AM_I + " too many empty cells" + toStr(emptyList.size())
-                       + " == " + toStr(mesh_->cellCount()));
-    }
-
-    if (background != 0.0){
-        mesh_->fillEmptyCells(emptyList, background);
-    }
-
-    // setting fixed values
-    if (regionManagerInUse_){
-        for (Index i = 0, imax = mesh_->cellCount(); i < imax; i ++){
-            if (abs(mesh_->cell(i).attribute()) < TOLERANCE){
-                if (mesh_->cell(i).marker() <= MARKER_FIXEDVALUE_REGION){
-                    SIndex regionMarker = -(mesh_->cell(i).marker() - MARKER_FIXEDVALUE_REGION);
-                    double val = regionManager_->region(regionMarker)->fixValue();
-//                     __MS("fixing region: " << regionMarker << " to: " << val)
-                    mesh_->cell(i).setAttribute(val);
-                }
-            }
-        }
+    if (mesh_ && background == -1.0 && !mesh_->neighboursKnown()){
+        mesh_->createNeighbourInfos();
     }
+    mesh_->setCellAttributes(createMappedModel(model, background));
 }
 
 void ModellingBase::initRegionManager() {
@@ -62,6 +62,19 @@ public:
         return RVector(0);
     }
 
+    /*! Prepare everything that \ref response_mt needs but cannot create
+     * itself since it is read only, e.g., the neighbour infos for the
+     * prolongation in \ref createMappedModel. Call this once from the main
+     * thread before concurrent calls of response_mt. */
+    virtual void prepareResponse_mt();
+
+    /*! Calculate the responses for a set of models, e.g., line search or
+     * L-curve candidates. For nThreads > 1 the models are dispatched
+     * concurrently via \ref response_mt, which needs to be implemented then.
+     * Otherwise \ref response is called for one model after another. */
+    std::vector < RVector > responses(const std::vector < RVector > & models,
+                                      Index nThreads=1);
+
     inline RVector operator() (const RVector & model){ return response(model); }
 
     /*! Change the associated data container */
@@ -159,17 +172,25 @@ public:
 
     virtual MatrixBase * constraints() const;
 
+    /*! Return the constraints as sparse map matrix. For the default
+     * \ref SparseRowMatrix this is a copy and changes are not applied. */
     virtual RSparseMapMatrix & constraintsRef() const;
 
     virtual RSparseMapMatrix & constraintsRef();
 
     const RMatrix & solution() const { return solutions_; }
 
+    /*! Map the model to the cell attributes of the mesh.
+     * See \ref createMappedModel for a read only variant. */
     void mapModel(const RVector & model, double background=0);
 
     /*! Read only extrapolation of model values given per cell marker to
      values given per cell. Exterior values will be set to background or
-     prolongated for background != -1.
+     prolongated for background == -1.
+     The mesh stays untouched, so the result can be given directly to
+     assembling or graph building methods from concurrent threads.
+     The prolongation needs the neighbour infos of the mesh, so it throws if
+     they are unknown, see \ref prepareResponse_mt.
      */
     RVector createMappedModel(const RVector & model, double background=-1) const;
 
@@ -233,6 +254,7 @@ protected:
 
     MatrixBase              * constraints_;
     bool                    ownConstraints_;
+    mutable RSparseMapMatrix * constraintsMap_;
 
     RMatrix                 solutions_;
 
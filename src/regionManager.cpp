@@ -273,7 +273,7 @@ Index Region::constraintCount() const {
     return bounds_.size();
 }
 
-void Region::fillConstraints(RSparseMapMatrix & C, Index startConstraintsID){
+void Region::fillConstraints(SparseRowMatrix & C, Index startConstraintsID){
     if (isBackground_) return;
 
     if (isSingle_ && constraintType_ == 1) return;
@@ -282,13 +282,15 @@ void Region::fillConstraints(RSparseMapMatrix & C, Index startConstraintsID){
     if (constraintType_ == 10 || constraintType_ == 20) cMixRatio = 1.0; //**retrieve from properties!!!
     if (constraintType_ == 0 || constraintType_ == 20){ //purely 0th or mixed 2nd+0th
         for (size_t i = 0; i < parameterCount_; i++) {
-            C[startConstraintsID + i][startParameter_ + i] = cMixRatio;
+            C.addVal(startConstraintsID + i, startParameter_ + i, cMixRatio);
         }
         if (constraintType_ == 0) return;
     }
 
     SIndex leftParaId = -1, rightParaId = -1;
     if (constraintType_ == 2 || constraintType_ == 20) { //** 2nd order constraints (opt. mixed with 0th)
+        //** neighbours are coupled once, the diagonal counts all boundaries
+        std::set< std::pair< SIndex, SIndex > > neighbours;
         for (std::vector < Boundary * >::iterator it = bounds_.begin(), itmax = bounds_.end();
             it != itmax; it ++){
             leftParaId = -1;
@@ -298,17 +300,21 @@ void Region::fillConstraints(RSparseMapMatrix & C, Index startConstraintsID){
             if (leftParaId >= (int)startParameter_ && leftParaId < (int)endParameter_ &&
                  rightParaId >= (int)startParameter_ && rightParaId < (int)endParameter_ &&
                     leftParaId != rightParaId){
-                C[leftParaId][rightParaId] = -1;
-                C[rightParaId][leftParaId] = -1;
-                C[leftParaId][leftParaId] += 1;
-                C[rightParaId][rightParaId] += 1;
+                if (neighbours.insert(std::pair< SIndex, SIndex >(leftParaId, rightParaId)).second){
+                    C.addVal(leftParaId, rightParaId, -1.0);
+                }
+                if (neighbours.insert(std::pair< SIndex, SIndex >(rightParaId, leftParaId)).second){
+                    C.addVal(rightParaId, leftParaId, -1.0);
+                }
+                C.addVal(leftParaId, leftParaId, 1.0);
+                C.addVal(rightParaId, rightParaId, 1.0);
             }
         }
         return;
     }
     //** 1st order constraints (opt. combined with 0th order)
     Index cID = startConstraintsID;
-         for (std::vector < Boundary * >::iterator it = bounds_.begin(), itmax = bounds_.end();
+    for (std::vector < Boundary * >::iterator it = bounds_.begin(), itmax = bounds_.end();
         it != itmax; it ++){
 
         leftParaId = -1;
@@ -316,18 +322,17 @@ void Region::fillConstraints(RSparseMapMatrix & C, Index startConstraintsID){
         if ((*it)->leftCell() ) leftParaId  = (*it)->leftCell()->marker();
         if ((*it)->rightCell()) rightParaId = (*it)->rightCell()->marker();
 
-        //if ( leftParaId > -1 && rightParaId > -1 && leftParaId != rightParaId) {
         if (leftParaId >= (int)startParameter_ && leftParaId < (int)endParameter_ &&
              rightParaId >= (int)startParameter_ && rightParaId < (int)endParameter_ &&
                 leftParaId != rightParaId){
-            C[cID][leftParaId] = 1;
-            C[cID][rightParaId] = -1;
+            C.addVal(cID, leftParaId, 1.0);
+            C.addVal(cID, rightParaId, -1.0);
         }
         cID ++;
     }
     if (constraintType_ == 10) { //** combination with 0th order
         for (size_t i = 0; i < parameterCount_; i++) {
-            C[cID][startParameter_ + i] = cMixRatio;
+            C.addVal(cID, startParameter_ + i, cMixRatio);
             cID++;
         }
 
@@ -907,26 +912,23 @@ Index RegionManager::interRegionConstraintsCount() const {
     return count;
 }
 
-void RegionManager::fillConstraints(RSparseMapMatrix & C){
+void RegionManager::fillConstraints(SparseRowMatrix & C){
 //     __MS(&C)
 //     __MS(C.rtti())
 
     Index nModel  = parameterCount();
     Index nConstr = constraintCount();
 
-    C.clear();
-
     //!** no regions: fill 0th-order constraints
     if (regionMap_.empty() || nConstr == 0){
-        C.setCols(nModel);
-        C.setRows(nModel);
+        C.resize(nModel, nModel);
 
-        for (size_t i = 0; i < parameterCount(); i++) C[i][i] = 1;
+        for (size_t i = 0; i < parameterCount(); i++) C.addVal(i, i, 1.0);
+        C.compress();
         return;
     }
 
-    C.setRows(nConstr);
-    C.setCols(nModel);
+    C.resize(nConstr, nModel);
 
     Index consCount = 0;
 
@@ -975,8 +977,8 @@ void RegionManager::fillConstraints(RSparseMapMatrix & C){
                     }
 //                    std::cout << lMarker << " " << rMarker << " " << lMarker - lStart << " " << rMarker - rStart << std::endl;
 
-                    C[consCount][lMarker] = +1.0 / (*lMC)[size_t(lMarker - lStart)];
-                    C[consCount][rMarker] = -1.0 / (*rMC)[size_t(rMarker - rStart)];
+                    C.addVal(consCount, lMarker, +1.0 / (*lMC)[size_t(lMarker - lStart)]);
+                    C.addVal(consCount, rMarker, -1.0 / (*rMC)[size_t(rMarker - rStart)]);
                     consCount ++;
 
                     if (regionMap_.find(it->first.first )->second->isSingle() &&
@@ -987,7 +989,13 @@ void RegionManager::fillConstraints(RSparseMapMatrix & C){
             }
         }
     }
-//     __MS(C.rtti())
+    C.compress();
+}
+
+void RegionManager::fillConstraints(RSparseMapMatrix & C){
+    SparseRowMatrix S;
+    fillConstraints(S);
+    S.toSparseMapMatrix(C);
 }
 
 std::vector < RVector3 > RegionManager::boundaryNorm() const {
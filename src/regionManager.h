@@ -105,8 +105,9 @@ public:
         For single region (startConstraintsID, startParameter_) = 1, \n
         for constraintstype == 0 fill  (startConstraintsID + i, startParameter_ + i) = 1, i=1..constraintCount()\n
         else fill (startConstraintsID + i, Boundary_i_leftNeightbourParameterID) = 1,
-                  (startConstraintsID + i, Boundary_i_rightNeightbourParameterID) = -1, i = 1..nBoundaries.*/
-    void fillConstraints(RSparseMapMatrix & C, Index startConstraintsID);
+                  (startConstraintsID + i, Boundary_i_rightNeightbourParameterID) = -1, i = 1..nBoundaries.\n
+        The values are collected in C and need a final C.compress(). */
+    void fillConstraints(SparseRowMatrix & C, Index startConstraintsID);
 
     /*! Set region wide constant constraints weight, (default = 1). If this method is called background is forced to false. */
     void setConstraintsWeight(double bc);
@@ -337,6 +338,10 @@ public:
 
     /*! Fill global constraints-matrix
         no regions: fill with 0th-order constraints */
+    void fillConstraints(SparseRowMatrix & C);
+
+    /*! Fill global constraints-matrix as sparse map matrix.
+        Built as \ref SparseRowMatrix and copied. */
     void fillConstraints(RSparseMapMatrix & C);
 
     /*! Syntactic sugar: set zweight/constraintType to all regions. */
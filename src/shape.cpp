@@ -371,7 +371,31 @@ RVector3 Shape::rst(Index i) const {
 }
 
 bool Shape::isInside(const RVector3 & xyz, bool verbose) const {
-     RVector sf; return isInside(xyz, sf, verbose);
+    if (!verbose){
+        int exitFace;
+        return isInsideOrExit(xyz, exitFace);
+    }
+    RVector sf; return isInside(xyz, sf, verbose);
+}
+
+/*! Return true if all n local distances c to the faces are >= 0 within
+ * the touch tolerance, else set exitFace to the face with the smallest one. */
+inline bool insideOrExit__(const RVector3 & xyz, const double * c, int n,
+                           int & exitFace){
+    int minIdx = 0;
+    for (int i = 1; i < n; i ++) if (c[i] < c[minIdx]) minIdx = i;
+
+    if (c[minIdx] > 0.0) return true; //** inside
+    if (std::fabs(c[minIdx]) < max(TOUCH_TOLERANCE, TOUCH_TOLERANCE * xyz.abs())) return true; //** on boundary
+
+    exitFace = minIdx;
+    return false;
+}
+
+bool Shape::isInsideOrExit(const RVector3 & xyz, int & exitFace) const {
+    exitFace = -1;
+    RVector sf;
+    return isInside(xyz, sf, false);
 }
 
 bool Shape::isInside(const RVector3 & xyz, RVector & sf, bool verbose) const {
@@ -419,6 +443,13 @@ RVector3 EdgeShape::norm() const {
     return nodeVector_[0]->pos().normXY(nodeVector_[1]->pos());
 }
 
+bool EdgeShape::isInsideOrExit(const RVector3 & xyz, int & exitFace) const {
+    RVector3 r(Shape::rst(xyz));
+    //** face i is opposite to node i
+    double c[2] = {1.0 - r[0], r[0]};
+    return insideOrExit__(xyz, c, 2, exitFace);
+}
+
 RVector3 EdgeShape::rst(Index i) const{
     if (i < nodeCount())
         return RVector3(EdgeCoordinates[i][0],
@@ -485,6 +516,28 @@ void TriangleShape::xyz2rst(const RVector3 & pos, RVector3 & rst ) const {
     rst[1] = (x21 * yp1 - y21 * xp1) / J; // s
 }
 
+void TriangleShape::barycentric(const RVector3 & xyz, double * L) const {
+    RVector3 r(0.0, 0.0, 0.0);
+    TriangleShape::xyz2rst(xyz, r);
+    L[0] = 1.0 - r[0] - r[1];
+    L[1] = r[0];
+    L[2] = r[1];
+}
+
+bool TriangleShape::isInsideOrExit(const RVector3 & xyz, int & exitFace) const {
+    //** face i is opposite to node i
+    double L[3];
+    barycentric(xyz, L);
+    return insideOrExit__(xyz, L, 3, exitFace);
+}
+
+bool QuadrangleShape::isInsideOrExit(const RVector3 & xyz, int & exitFace) const {
+    RVector3 r(Shape::rst(xyz));
+    //** face i connects node i and i + 1
+    double c[4] = {r[1], 1.0 - r[0], 1.0 - r[1], r[0]};
+    return insideOrExit__(xyz, c, 4, exitFace);
+}
+
 RVector3 QuadrangleShape::rst(Index i) const{
     if (i < nodeCount()) return RVector3(QuadCoordinates[i][0], QuadCoordinates[i][1], QuadCoordinates[i][2]);
     THROW_TO_IMPL; return RVector3(0.0, 0.0, 0.0);
@@ -571,6 +624,22 @@ void TetrahedronShape::xyz2rst(const RVector3 & pos, RVector3 & rst ) const {
                     xp1 * (y21 * z31 - y31 * z21)) / J;
 }
 
+void TetrahedronShape::barycentric(const RVector3 & xyz, double * L) const {
+    RVector3 r(0.0, 0.0, 0.0);
+    TetrahedronShape::xyz2rst(xyz, r);
+    L[0] = 1.0 - r[0] - r[1] - r[2];
+    L[1] = r[0];
+    L[2] = r[1];
+    L[3] = r[2];
+}
+
+bool TetrahedronShape::isInsideOrExit(const RVector3 & xyz, int & exitFace) const {
+    //** face i is opposite to node i, see TetrahedronFacesID
+    double L[4];
+    barycentric(xyz, L);
+    return insideOrExit__(xyz, L, 4, exitFace);
+}
+
 double TetrahedronShape::volume() const {
     RVector3 a(nodeVector_[1]->pos() - nodeVector_[0]->pos());
     RVector3 b(nodeVector_[2]->pos() - nodeVector_[0]->pos());
@@ -586,6 +655,13 @@ void TetrahedronShape::setNodes(Node * n0, Node * n1, Node * n2, Node * n3){
     setNode(0, *n0); setNode(1, *n1); setNode(2, *n2); setNode(3, *n3);
 }
 
+bool HexahedronShape::isInsideOrExit(const RVector3 & xyz, int & exitFace) const {
+    RVector3 r(Shape::rst(xyz));
+    //** faces in the order of HexahedronFacesID
+    double c[6] = {1.0 - r[0], 1.0 - r[1], r[0], r[1], 1.0 - r[2], r[2]};
+    return insideOrExit__(xyz, c, 6, exitFace);
+}
+
 RVector3 HexahedronShape::rst(Index i) const{
     if (i < nodeCount()) return RVector3(HexCoordinates[i][0], HexCoordinates[i][1], HexCoordinates[i][2]);
     THROW_TO_IMPL; return RVector3(0.0, 0.0, 0.0);
@@ -620,6 +696,13 @@ bool HexahedronShape::enforcePositiveDirection(){
     return false;
 }
 
+bool TriPrismShape::isInsideOrExit(const RVector3 & xyz, int & exitFace) const {
+    RVector3 r(Shape::rst(xyz));
+    //** faces in the order of TriPrismFacesID
+    double c[5] = {1.0 - r[0] - r[1], r[0], r[1], 1.0 - r[2], r[2]};
+    return insideOrExit__(xyz, c, 5, exitFace);
+}
+
 RVector3 TriPrismShape::rst(Index i) const{
     if (i < nodeCount()) return RVector3(PrismCoordinates[i][0], PrismCoordinates[i][1], PrismCoordinates[i][2]);
     THROW_TO_IMPL;
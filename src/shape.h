@@ -294,6 +294,16 @@ public:
     virtual bool isInside(const RVector3 & xyz, RVector & sf,
                           bool verbose=false) const;
 
+    /*! Return true if the Cartesian coordinates xyz are inside the shape,
+     * on boundary means inside too, see \ref isInside.
+     * Otherwise exitFace is set to the local index of the boundary, in the
+     * order of Cell::boundaryNodes, behind which xyz lies. This is the face
+     * to cross for the next neighbor. Triangles and tetrahedrons use
+     * closed-form barycentric coordinates without any allocation, edges,
+     * quadrangles, hexahedrons and prisms their local coordinates.
+     * Other shapes set exitFace to -1. */
+    virtual bool isInsideOrExit(const RVector3 & xyz, int & exitFace) const;
+
     /*! Get the domain size of this shape, i.e., length, area or volume */
     double domainSize() const;
 
@@ -373,6 +383,9 @@ public:
     /*! See Shape::rst */
     virtual RVector3 rst(Index i) const;
 
+    /*! See Shape::isInsideOrExit */
+    virtual bool isInsideOrExit(const RVector3 & xyz, int & exitFace) const;
+
 //     /*! See Shape::N. */
 //     virtual void N(const RVector3 & L, RVector & n) const;
 //
@@ -435,6 +448,13 @@ public:
     /*! See Shape::xyz2rst. this is a specialized override for speedup. */
     virtual void xyz2rst(const RVector3 & pos, RVector3 & rst) const;
 
+    /*! Fill L with the barycentric coordinates of xyz, i.e., the values of
+     * the three linear shape functions. Closed-form without allocation. */
+    void barycentric(const RVector3 & xyz, double * L) const;
+
+    /*! See Shape::isInsideOrExit */
+    virtual bool isInsideOrExit(const RVector3 & xyz, int & exitFace) const;
+
     void setNodes(Node * n0, Node * n1, Node * n2);
 
     double area() const;
@@ -483,6 +503,9 @@ public:
     /*! See Shape::rst */
     virtual RVector3 rst(Index i) const;
 
+    /*! See Shape::isInsideOrExit */
+    virtual bool isInsideOrExit(const RVector3 & xyz, int & exitFace) const;
+
     double area() const;
 
 //     virtual std::vector < PolynomialFunction < double > > createShapeFunctions() const;
@@ -528,6 +551,13 @@ public:
     /*! See Shape::xyz2rst. Specialization for speedup */
     void xyz2rst(const RVector3 & pos, RVector3 & rst) const;
 
+    /*! Fill L with the barycentric coordinates of xyz, i.e., the values of
+     * the four linear shape functions. Closed-form without allocation. */
+    void barycentric(const RVector3 & xyz, double * L) const;
+
+    /*! See Shape::isInsideOrExit */
+    virtual bool isInsideOrExit(const RVector3 & xyz, int & exitFace) const;
+
     void setNodes(Node * n0, Node * n1, Node * n2, Node * n3);
 
 //     /*! See Shape::N. */
@@ -600,6 +630,9 @@ public:
 
     virtual std::string name() const { return "HexahedronShape"; }
 
+    /*! See Shape::isInsideOrExit */
+    virtual bool isInsideOrExit(const RVector3 & xyz, int & exitFace) const;
+
     double volume() const;
 
     /*! Special version of since simple order reverse isn't enough here.
@@ -659,6 +692,9 @@ public:
     /*! See Shape::rst */
     virtual RVector3 rst(Index i) const;
 
+    /*! See Shape::isInsideOrExit */
+    virtual bool isInsideOrExit(const RVector3 & xyz, int & exitFace) const;
+
     virtual std::vector < PolynomialFunction < double > > createShapeFunctions() const;
 
     double volume() const;
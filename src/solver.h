@@ -22,6 +22,7 @@
 
 #include "gimli.h"
 #include "matrix.h"
+#include "sparsematrix.h"
 #include "vectortemplates.h"
 
 namespace GIMLI{
@@ -34,6 +35,7 @@ int solveCGLSCDWWhtrans(const MatrixBase & S, const MatrixBase & C,
                         double lambda, const Vec & roughness,
                         int maxIter=200, double tol=-1.0,
                         bool verbose=false){ //ALLOW_PYTHON_THREADS
+    VectorArenaScope arena;
 
     uint nData = b.size();
     uint nModel = x.size();
@@ -104,7 +106,81 @@ int solveCGLSCDWWhtrans(const MatrixBase & S, const MatrixBase & C,
 #ifdef _WIN32
     if (verbose) std::cout << "[ " << count << "/" << normR2 << "]\t" << std::endl;
 #endif
-    return 1;
+    return count;
+}
+
+/*! Return the squared column norms of diag(l) * A * diag(r), i.e., the
+ * diagonal of the normal equations matrix. Only dense, sparse map and sparse
+ * row matrices are supported, all other matrix types return an empty vector. */
+template < class Vec >
+Vec colNormSquares(const MatrixBase & A, const Vec & l, const Vec & r){
+    Vec ret(A.cols(), 0.0);
+    if (A.rtti() == GIMLI_MATRIX_RTTI){
+        const Matrix < double > & M = dynamic_cast< const Matrix < double > & >(A);
+        for (Index i = 0; i < M.rows(); i ++){
+            ret += (M[i] * l[i]) * (M[i] * l[i]);
+        }
+    } else if (A.rtti() == GIMLI_SPARSEMAPMATRIX_RTTI){
+        const SparseMapMatrix < double, Index > & M =
+            dynamic_cast< const SparseMapMatrix < double, Index > & >(A);
+        for (SparseMapMatrix < double, Index >::const_iterator it = M.begin();
+             it != M.end(); it ++){
+            double v = M.val(it) * l[M.idx1(it)];
+            ret[M.idx2(it)] += v * v;
+        }
+    } else if (A.rtti() == GIMLI_SPARSEROWMATRIX_RTTI){
+        const SparseRowMatrix & M = dynamic_cast< const SparseRowMatrix & >(A);
+        for (Index i = 0; i < M.rows(); i ++){
+            for (Index k = M.vecRowPtr()[i]; k < M.vecRowPtr()[i + 1]; k ++){
+                double v = M.vecVals()[k] * l[i];
+                ret[M.vecColIdx()[k]] += v * v;
+            }
+        }
+    } else {
+        return Vec(0);
+    }
+    return ret * r * r;
+}
+
+/*! Jacobi (column scaling) preconditioned variant of \ref solveCGLSCDWWhtrans.
+ * The columns are scaled by the diagonal of the normal equations
+ * J^T J + lambda C^T C of the weighted and transformed system, x is used as
+ * start vector (warm start) and the iteration stops if the residual of the
+ * normal equations is reduced by relTol. Returns the number of iterations.
+ * Falls back to unit scaling for matrix types without element access. */
+template < class Vec >
+int solveCGLSCDWWhtransPrecond(const MatrixBase & S, const MatrixBase & C,
+                               const Vec & dWeight, const Vec & b, Vec & x,
+                               const Vec & wc, const Vec & wm,
+                               const Vec & tm, const Vec & td,
+                               double lambda, const Vec & roughness,
+                               int maxIter=200, double relTol=1e-4,
+                               bool verbose=false){
+    Vec d(colNormSquares(S, Vec(dWeight * td), Vec(1.0 / tm)));
+    Vec dC(colNormSquares(C, wc, wm));
+
+    if (d.size() != x.size() || dC.size() != x.size()){
+        d.resize(x.size()); d.fill(1.0);
+    } else {
+        d += dC * lambda;
+        for (Index i = 0; i < d.size(); i ++){
+            if (d[i] > TOLERANCE) d[i] = 1.0 / std::sqrt(d[i]); else d[i] = 1.0;
+        }
+    }
+
+    //** same system for y = x / d, i.e., with scaled transformations
+    Vec tmD(tm / d);
+    Vec wmD(wm * d);
+    Vec y(x / d);
+
+    Vec r0(transMult(S, Vec(b * dWeight * dWeight * td)) / tmD -
+           transMult(C, Vec(wc * roughness)) * wmD * lambda);
+    double tol = max(TOLERANCE, relTol * relTol * dot(r0, r0));
+
+    int count = solveCGLSCDWWhtrans(S, C, dWeight, b, y, wc, wmD, tmD, td,
+                                    lambda, roughness, maxIter, tol, verbose);
+    x = y * d;
+    return count;
 }
 
 template < class Vec >
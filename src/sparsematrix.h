@@ -663,6 +663,199 @@ void rank1Update(SparseMapMatrix< double, Index > & S, const Vec & u, const Vec
     return;
 }
 
+//! Rectangular sparse matrix in compressed row storage (CSR)
+/*! Rectangular sparse matrix of doubles in compressed row storage (CSR).
+ * Entries are collected with \ref addVal in any order and \ref compress
+ * sorts them into rows, duplicates are summed. Cheaper to build and to
+ * apply than \ref SparseMapMatrix, e.g., for constraint matrices that are
+ * multiplied twice in every CGLS iteration. */
+class DLLEXPORT SparseRowMatrix : public MatrixBase {
+public:
+    /*! Default constructor. Builds an empty rows x cols matrix. */
+    SparseRowMatrix(Index rows=0, Index cols=0)
+        : MatrixBase(), rows_(rows), cols_(cols), rowPtr_(rows + 1, 0) { }
+
+    virtual ~SparseRowMatrix() { }
+
+    virtual uint rtti() const { return GIMLI_SPARSEROWMATRIX_RTTI; }
+
+    virtual Index rows() const { return rows_; }
+
+    virtual Index cols() const { return cols_; }
+
+    /*! Return the number of stored values. */
+    inline Index nVals() const { return colIdx_.size(); }
+
+    /*! Resize to rows x cols and remove all values. */
+    virtual void resize(Index rows, Index cols){
+        clear();
+        rows_ = rows;
+        cols_ = cols;
+        rowPtr_.assign(rows_ + 1, 0);
+    }
+
+    virtual void clear(){
+        rows_ = 0; cols_ = 0;
+        rowPtr_.assign(1, 0);
+        colIdx_.clear(); vals_.clear();
+        tripI_.clear(); tripJ_.clear(); tripV_.clear();
+    }
+
+    virtual void clean(){ std::fill(vals_.begin(), vals_.end(), 0.0); }
+
+    /*! Collect the value v for (i, j). Becomes valid with \ref compress. */
+    inline void addVal(Index i, Index j, double v){
+        if (i >= rows_ || j >= cols_){
+            throwLengthError(EXIT_SPARSE_SIZE, WHERE_AM_I +
+                             " i = " + toStr(i) + " max_row = " + toStr(rows_) +
+                             " j = " + toStr(j) + " max_col = " + toStr(cols_));
+        }
+        tripI_.push_back(i); tripJ_.push_back(j); tripV_.push_back(v);
+    }
+
+    /*! Sort all collected values into rows, with ascending column
+     * indices per row and summed duplicates. Already compressed values are
+     * kept. */
+    void compress(){
+        for (Index i = 0; i < rows_; i ++){
+            for (Index k = rowPtr_[i]; k < rowPtr_[i + 1]; k ++){
+                tripI_.push_back(i);
+                tripJ_.push_back(colIdx_[k]);
+                tripV_.push_back(vals_[k]);
+            }
+        }
+        //** counting sort by rows
+        std::vector < Index > ptr(rows_ + 1, 0);
+        for (Index k = 0; k < tripI_.size(); k ++) ptr[tripI_[k] + 1] ++;
+        for (Index i = 0; i < rows_; i ++) ptr[i + 1] += ptr[i];
+
+        std::vector < Index > pos(ptr.begin(), ptr.end() - 1);
+        std::vector < Index > cIdx(tripI_.size());
+        std::vector < double > v(tripI_.size());
+        for (Index k = 0; k < tripI_.size(); k ++){
+            Index p = pos[tripI_[k]] ++;
+            cIdx[p] = tripJ_[k];
+            v[p] = tripV_[k];
+        }
+        tripI_.clear(); tripJ_.clear(); tripV_.clear();
+
+        //** sort columns of each row and merge duplicates
+        rowPtr_.assign(rows_ + 1, 0);
+        colIdx_.clear(); vals_.clear();
+        colIdx_.reserve(cIdx.size()); vals_.reserve(cIdx.size());
+        std::vector < std::pair< Index, double > > row;
+        for (Index i = 0; i < rows_; i ++){
+            row.clear();
+            for (Index k = ptr[i]; k < ptr[i + 1]; k ++){
+                row.push_back(std::pair< Index, double >(cIdx[k], v[k]));
+            }
+            std::sort(row.begin(), row.end(), lesserPairFirst_);
+            for (Index k = 0; k < row.size(); k ++){
+                if (colIdx_.size() > rowPtr_[i] && row[k].first == colIdx_.back()){
+                    vals_.back() += row[k].second;
+                } else {
+                    colIdx_.push_back(row[k].first);
+                    vals_.push_back(row[k].second);
+                }
+            }
+            rowPtr_[i + 1] = colIdx_.size();
+        }
+    }
+
+    /*! Return this * a  */
+    virtual RVector mult(const RVector & a) const {
+        checkCompressed_();
+        if (a.size() != cols_){
+            throwLengthError(1, WHERE_AM_I + " " + toStr(cols_) + " != " + toStr(a.size()));
+        }
+        RVector ret(rows_);
+        for (Index i = 0; i < rows_; i ++){
+            double s = 0.0;
+            for (Index k = rowPtr_[i]; k < rowPtr_[i + 1]; k ++){
+                s += vals_[k] * a[colIdx_[k]];
+            }
+            ret[i] = s;
+        }
+        return ret;
+    }
+
+    /*! Return this.T * a */
+    virtual RVector transMult(const RVector & a) const {
+        checkCompressed_();
+        if (a.size() != rows_){
+            throwLengthError(1, WHERE_AM_I + " " + toStr(rows_) + " != " + toStr(a.size()));
+        }
+        RVector ret(cols_, 0.0);
+        for (Index i = 0; i < rows_; i ++){
+            double ai = a[i];
+            if (ai == 0.0) continue;
+            for (Index k = rowPtr_[i]; k < rowPtr_[i + 1]; k ++){
+                ret[colIdx_[k]] += vals_[k] * ai;
+            }
+        }
+        return ret;
+    }
+
+    /*! Copy into a sparse map matrix, e.g., for element wise access. */
+    void toSparseMapMatrix(SparseMapMatrix< double, Index > & S) const {
+        checkCompressed_();
+        S.clear();
+        S.setRows(rows_);
+        S.setCols(cols_);
+        for (Index i = 0; i < rows_; i ++){
+            for (Index k = rowPtr_[i]; k < rowPtr_[i + 1]; k ++){
+                S[i][colIdx_[k]] = vals_[k];
+            }
+        }
+    }
+
+    /*! Save in the same row, col, val format as \ref SparseMapMatrix. */
+    virtual void save(const std::string & filename) const {
+        std::fstream file; openOutFile(filename, &file);
+        for (Index i = 0; i < rows_; i ++){
+            for (Index k = rowPtr_[i]; k < rowPtr_[i + 1]; k ++){
+                file << i << " " << colIdx_[k] << " " << vals_[k] << std::endl;
+            }
+        }
+        file.close();
+    }
+
+    inline const std::vector < Index > & vecRowPtr() const { return rowPtr_; }
+    inline const std::vector < Index > & vecColIdx() const { return colIdx_; }
+    inline const std::vector < double > & vecVals() const { return vals_; }
+
+protected:
+    static bool lesserPairFirst_(const std::pair< Index, double > & a,
+                                 const std::pair< Index, double > & b){
+        return a.first < b.first;
+    }
+
+    inline void checkCompressed_() const {
+        if (!tripI_.empty()){
+            throwError(EXIT_SPARSE_INVALID, WHERE_AM_I + " " + toStr(tripI_.size()) +
+                       " values are not compressed yet.");
+        }
+    }
+
+    Index rows_;
+    Index cols_;
+    std::vector < Index > rowPtr_;
+    std::vector < Index > colIdx_;
+    std::vector < double > vals_;
+
+    std::vector < Index > tripI_;
+    std::vector < Index > tripJ_;
+    std::vector < double > tripV_;
+};
+
+inline RVector operator * (const SparseRowMatrix & A, const RVector & b){
+    return A.mult(b);
+}
+
+inline RVector transMult(const SparseRowMatrix & A, const RVector & b){
+    return A.transMult(b);
+}
+
 // template < class ValueType, class IndexType, class V2, class T, class A >
 // Vector < V2 > operator * (const SparseMapMatrix< ValueType, IndexType > & S,
 //                            const VectorExpr< T, A > & a) {
@@ -875,6 +1068,17 @@ public:
         return *this;
     }
 
+    template < Index N > SparseMatrix< ValueType > & add(const ElementKernel< N > & A,
+                                                         ValueType scale){
+        if (!valid_) SPARSE_NOT_VALID;
+        for (Index i = 0; i < N; i++){
+            for (Index j = 0; j < N; j++){
+                addVal(A.idx(i), A.idx(j), scale * A.getVal(i, j));
+            }
+        }
+        return *this;
+    }
+
     void clean(){ for (Index i = 0, imax = nVals(); i < imax; i++) vals_[i] = (ValueType)(0); }
 
     void clear(){
@@ -0,0 +1,399 @@
+/******************************************************************************
+ *   Copyright (C) 2007-2018 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#include "spatialindex.h"
+
+#include "calculateMultiThread.h"
+#include "vector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace GIMLI{
+
+struct SpatialIndexPoint__{
+    double c[3];
+    Index id;
+};
+
+struct SpatialIndexCoordLess__{
+    SpatialIndexCoordLess__(Index dim) : dim_(dim){}
+    bool operator()(const SpatialIndexPoint__ & a,
+                    const SpatialIndexPoint__ & b) const {
+        return a.c[dim_] < b.c[dim_];
+    }
+    Index dim_;
+};
+
+struct SpatialIndex::Tree{
+    struct Node{
+        double lo[3];
+        double hi[3];
+        Index begin;
+        Index end;
+        Index left;  //** 0 for leaves, the root is never a child
+        Index right;
+    };
+
+    Index size() const { return id.size(); }
+
+    void build(std::vector< SpatialIndexPoint__ > & pts){
+        nodes.clear();
+        nodes.reserve(4 * (pts.size() / SPATIALINDEX_LEAFSIZE + 1));
+        if (!pts.empty()) buildNode_(pts, 0, pts.size());
+
+        x.resize(pts.size()); y.resize(pts.size()); z.resize(pts.size());
+        id.resize(pts.size());
+        for (Index i = 0; i < pts.size(); i ++){
+            x[i] = pts[i].c[0];
+            y[i] = pts[i].c[1];
+            z[i] = pts[i].c[2];
+            id[i] = pts[i].id;
+        }
+    }
+
+    void points(std::vector< SpatialIndexPoint__ > & pts) const {
+        for (Index i = 0; i < size(); i ++){
+            SpatialIndexPoint__ p;
+            p.c[0] = x[i]; p.c[1] = y[i]; p.c[2] = z[i]; p.id = id[i];
+            pts.push_back(p);
+        }
+    }
+
+    inline double boxDist2(const Node & n, const double * p) const {
+        double d2 = 0.0;
+        for (Index k = 0; k < 3; k ++){
+            double d = 0.0;
+            if (p[k] < n.lo[k]) d = n.lo[k] - p[k];
+            else if (p[k] > n.hi[k]) d = p[k] - n.hi[k];
+            d2 += d * d;
+        }
+        return d2;
+    }
+
+    /*! Visit all leaves with a box distance to p not larger than the
+     * current bound of the visitor, nearer boxes first. */
+    template < class Visitor > void traverse(const double * p, Visitor & v) const {
+        if (nodes.empty()) return;
+        //** depth of a median split tree is below 2 log2(n)
+        std::pair< Index, double > stack[256];
+        Index top = 0;
+        stack[top ++] = std::pair< Index, double >(0, boxDist2(nodes[0], p));
+
+        while (top > 0){
+            std::pair< Index, double > s = stack[-- top];
+            if (s.second > v.bound()) continue;
+            const Node & n = nodes[s.first];
+
+            if (n.left == 0){
+                for (Index i = n.begin; i < n.end; i ++){
+                    double dx = x[i] - p[0];
+                    double dy = y[i] - p[1];
+                    double dz = z[i] - p[2];
+                    v.visit(dx * dx + dy * dy + dz * dz, id[i]);
+                }
+            } else {
+                double dl = boxDist2(nodes[n.left], p);
+                double dr = boxDist2(nodes[n.right], p);
+                if (dl < dr){
+                    stack[top ++] = std::pair< Index, double >(n.right, dr);
+                    stack[top ++] = std::pair< Index, double >(n.left, dl);
+                } else {
+                    stack[top ++] = std::pair< Index, double >(n.left, dl);
+                    stack[top ++] = std::pair< Index, double >(n.right, dr);
+                }
+            }
+        }
+    }
+
+    std::vector< double > x;
+    std::vector< double > y;
+    std::vector< double > z;
+    std::vector< Index > id;
+    std::vector< Node > nodes;
+
+protected:
+    Index buildNode_(std::vector< SpatialIndexPoint__ > & pts,
+                     Index begin, Index end){
+        Index nIdx = nodes.size();
+        nodes.push_back(Node());
+
+        Node n;
+        n.begin = begin; n.end = end; n.left = 0; n.right = 0;
+        for (Index k = 0; k < 3; k ++){
+            n.lo[k] = pts[begin].c[k];
+            n.hi[k] = pts[begin].c[k];
+        }
+        for (Index i = begin + 1; i < end; i ++){
+            for (Index k = 0; k < 3; k ++){
+                n.lo[k] = std::min(n.lo[k], pts[i].c[k]);
+                n.hi[k] = std::max(n.hi[k], pts[i].c[k]);
+            }
+        }
+
+        if (end - begin > SPATIALINDEX_LEAFSIZE){
+            Index dim = 0;
+            for (Index k = 1; k < 3; k ++){
+                if (n.hi[k] - n.lo[k] > n.hi[dim] - n.lo[dim]) dim = k;
+            }
+            Index mid = begin + (end - begin) / 2;
+            std::nth_element(pts.begin() + begin, pts.begin() + mid,
+                             pts.begin() + end, SpatialIndexCoordLess__(dim));
+            n.left = buildNode_(pts, begin, mid);
+            n.right = buildNode_(pts, mid, end);
+        }
+        nodes[nIdx] = n;
+        return nIdx;
+    }
+};
+
+/*! Nearest point, ties are resolved by the smaller id. */
+class SpatialIndexNearest__{
+public:
+    SpatialIndexNearest__()
+        : d2_(std::numeric_limits< double >::max()), id_(0), found_(false){}
+
+    inline double bound() const { return d2_; }
+
+    inline void visit(double d2, Index id){
+        if (d2 < d2_ || (d2 == d2_ && id < id_)){
+            d2_ = d2; id_ = id; found_ = true;
+        }
+    }
+
+    double d2_;
+    Index id_;
+    bool found_;
+};
+
+/*! k nearest points in a max heap. */
+class SpatialIndexKNearest__{
+public:
+    SpatialIndexKNearest__(Index k) : k_(k){ heap_.reserve(k + 1); }
+
+    inline double bound() const {
+        if (heap_.size() < k_) return std::numeric_limits< double >::max();
+        return heap_.front().first;
+    }
+
+    inline void visit(double d2, Index id){
+        if (heap_.size() < k_){
+            heap_.push_back(std::pair< double, Index >(d2, id));
+            std::push_heap(heap_.begin(), heap_.end());
+        } else if (std::pair< double, Index >(d2, id) < heap_.front()){
+            std::pop_heap(heap_.begin(), heap_.end());
+            heap_.back() = std::pair< double, Index >(d2, id);
+            std::push_heap(heap_.begin(), heap_.end());
+        }
+    }
+
+    Index k_;
+    std::vector< std::pair< double, Index > > heap_;
+};
+
+/*! All points within a squared distance. */
+class SpatialIndexRadius__{
+public:
+    SpatialIndexRadius__(double r2) : r2_(r2){}
+
+    inline double bound() const { return r2_; }
+
+    inline void visit(double d2, Index id){
+        if (d2 <= r2_) hits_.push_back(std::pair< double, Index >(d2, id));
+    }
+
+    double r2_;
+    std::vector< std::pair< double, Index > > hits_;
+};
+
+SpatialIndex::SpatialIndex(){
+}
+
+SpatialIndex::SpatialIndex(const R3Vector & pos){
+    build(pos);
+}
+
+SpatialIndex::~SpatialIndex(){
+    clear();
+}
+
+void SpatialIndex::clear(){
+    for (Index i = 0; i < trees_.size(); i ++) delete trees_[i];
+    trees_.clear();
+}
+
+void SpatialIndex::build(const R3Vector & pos){
+    IndexArray ids(pos.size());
+    for (Index i = 0; i < ids.size(); i ++) ids[i] = i;
+    build(pos, ids);
+}
+
+void SpatialIndex::build(const R3Vector & pos, const IndexArray & ids){
+    ASSERT_EQUAL(pos.size(), ids.size())
+    clear();
+    std::vector< SpatialIndexPoint__ > pts(pos.size());
+    for (Index i = 0; i < pos.size(); i ++){
+        pts[i].c[0] = pos[i][0];
+        pts[i].c[1] = pos[i][1];
+        pts[i].c[2] = pos[i][2];
+        pts[i].id = ids[i];
+    }
+    trees_.push_back(new Tree());
+    trees_.back()->build(pts);
+}
+
+void SpatialIndex::insert(const RVector3 & pos, Index id){
+    std::vector< SpatialIndexPoint__ > pts(1);
+    pts[0].c[0] = pos[0];
+    pts[0].c[1] = pos[1];
+    pts[0].c[2] = pos[2];
+    pts[0].id = id;
+    trees_.push_back(new Tree());
+    trees_.back()->build(pts);
+    merge_();
+}
+
+void SpatialIndex::merge_(){
+    while (trees_.size() > 1 &&
+           trees_[trees_.size() - 2]->size() <= 2 * trees_.back()->size()){
+        Tree * a = trees_.back(); trees_.pop_back();
+        Tree * b = trees_.back(); trees_.pop_back();
+
+        std::vector< SpatialIndexPoint__ > pts;
+        pts.reserve(a->size() + b->size());
+        b->points(pts);
+        a->points(pts);
+        delete a;
+        delete b;
+
+        trees_.push_back(new Tree());
+        trees_.back()->build(pts);
+    }
+}
+
+Index SpatialIndex::size() const {
+    Index n = 0;
+    for (Index i = 0; i < trees_.size(); i ++) n += trees_[i]->size();
+    return n;
+}
+
+Index SpatialIndex::nearest(const RVector3 & pos, double * dist) const {
+    double p[3] = {pos[0], pos[1], pos[2]};
+    SpatialIndexNearest__ v;
+    for (Index i = 0; i < trees_.size(); i ++) trees_[i]->traverse(p, v);
+
+    if (!v.found_){
+        throwError(1, WHERE_AM_I + " spatial index is empty.");
+    }
+    if (dist) *dist = std::sqrt(v.d2_);
+    return v.id_;
+}
+
+void SpatialIndex::nearest(const RVector3 & pos, Index k,
+                           IndexArray & ids, RVector & dists) const {
+    double p[3] = {pos[0], pos[1], pos[2]};
+    SpatialIndexKNearest__ v(k);
+    if (k > 0){
+        for (Index i = 0; i < trees_.size(); i ++) trees_[i]->traverse(p, v);
+    }
+    std::sort_heap(v.heap_.begin(), v.heap_.end());
+
+    ids.resize(v.heap_.size());
+    dists.resize(v.heap_.size());
+    for (Index i = 0; i < v.heap_.size(); i ++){
+        ids[i] = v.heap_[i].second;
+        dists[i] = std::sqrt(v.heap_[i].first);
+    }
+}
+
+IndexArray SpatialIndex::radius(const RVector3 & pos, double r) const {
+    double p[3] = {pos[0], pos[1], pos[2]};
+    SpatialIndexRadius__ v(r * r);
+    for (Index i = 0; i < trees_.size(); i ++) trees_[i]->traverse(p, v);
+    std::sort(v.hits_.begin(), v.hits_.end());
+
+    IndexArray ids(v.hits_.size());
+    for (Index i = 0; i < v.hits_.size(); i ++) ids[i] = v.hits_[i].second;
+    return ids;
+}
+
+/*! Batched queries, distributed over the positions. */
+class SpatialIndexQueryMT : public BaseCalcMT{
+public:
+    SpatialIndexQueryMT(const SpatialIndex & index, const R3Vector & pos,
+                        Index k, double r,
+                        IndexArray * nearest, std::vector< IndexArray > * ids)
+        : BaseCalcMT(), index_(&index), pos_(&pos), k_(k), r_(r),
+          nearest_(nearest), ids_(ids){
+    }
+
+    virtual ~SpatialIndexQueryMT(){}
+
+    virtual void calc(Index tNr=0){
+        RVector dists;
+        for (Index i = start_; i < end_; i ++){
+            if (nearest_){
+                (*nearest_)[i] = index_->nearest((*pos_)[i]);
+            } else if (k_ > 0){
+                index_->nearest((*pos_)[i], k_, (*ids_)[i], dists);
+            } else {
+                (*ids_)[i] = index_->radius((*pos_)[i], r_);
+            }
+        }
+    }
+
+protected:
+    const SpatialIndex * index_;
+    const R3Vector * pos_;
+    Index k_;
+    double r_;
+    IndexArray * nearest_;
+    std::vector< IndexArray > * ids_;
+};
+
+static Index spatialIndexThreads__(Index nQueries){
+    return max(Index(1), min(threadCount(), nQueries / 256));
+}
+
+IndexArray SpatialIndex::nearest(const R3Vector & pos) const {
+    IndexArray ret(pos.size());
+    if (pos.size() == 0) return ret;
+    if (size() == 0) throwError(1, WHERE_AM_I + " spatial index is empty.");
+    distributeCalc(SpatialIndexQueryMT(*this, pos, 0, 0.0, &ret, NULL),
+                   pos.size(), spatialIndexThreads__(pos.size()));
+    return ret;
+}
+
+std::vector< IndexArray > SpatialIndex::nearest(const R3Vector & pos, Index k) const {
+    std::vector< IndexArray > ret(pos.size());
+    if (pos.size() == 0 || k == 0) return ret;
+    distributeCalc(SpatialIndexQueryMT(*this, pos, k, 0.0, NULL, &ret),
+                   pos.size(), spatialIndexThreads__(pos.size()));
+    return ret;
+}
+
+std::vector< IndexArray > SpatialIndex::radius(const R3Vector & pos, double r) const {
+    std::vector< IndexArray > ret(pos.size());
+    if (pos.size() == 0) return ret;
+    distributeCalc(SpatialIndexQueryMT(*this, pos, 0, r, NULL, &ret),
+                   pos.size(), spatialIndexThreads__(pos.size()));
+    return ret;
+}
+
+} // namespace GIMLI
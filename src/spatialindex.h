@@ -0,0 +1,105 @@
+/******************************************************************************
+ *   Copyright (C) 2007-2018 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef _GIMLI_SPATIALINDEX__H
+#define _GIMLI_SPATIALINDEX__H
+
+#include "gimli.h"
+#include "pos.h"
+
+#include <vector>
+
+namespace GIMLI{
+
+//! Flat static kd-tree for nearest neighbor and radius search in three dimensions.
+/*! Flat static kd-tree for nearest neighbor and radius search in three
+ * dimensions. The points are bulk-built into contiguous coordinate arrays,
+ * sorted in tree order, with a bounding box for every tree node and buckets
+ * of \ref SPATIALINDEX_LEAFSIZE points per leaf that are scanned linearly.
+ * Points are identified by an id, by default their index on build.
+ * Single points can be inserted later, they are collected in a logarithmic
+ * sequence of static trees, so inserting n points costs O(n log^2 n).
+ * All queries are const and may be called from several threads; the
+ * batched queries distribute the positions over \ref threadCount() threads. */
+class DLLEXPORT SpatialIndex{
+public:
+    /*! Create an empty index. */
+    SpatialIndex();
+
+    /*! Build the index for all pos with the ids [0, pos.size()). */
+    SpatialIndex(const R3Vector & pos);
+
+    ~SpatialIndex();
+
+    /*! Remove all points. */
+    void clear();
+
+    /*! Rebuild the index for all pos with the ids [0, pos.size()). */
+    void build(const R3Vector & pos);
+
+    /*! Rebuild the index for all pos with the corresponding ids. */
+    void build(const R3Vector & pos, const IndexArray & ids);
+
+    /*! Add a single point with id. */
+    void insert(const RVector3 & pos, Index id);
+
+    /*! Return the amount of points. */
+    Index size() const;
+
+    /*! Return the id of the point nearest to pos. If dist is given it is set
+     * to the distance. Throws if the index is empty. */
+    Index nearest(const RVector3 & pos, double * dist=NULL) const;
+
+    /*! Fill ids with the ids of the k points nearest to pos and dists with
+     * their distances, sorted by ascending distance. */
+    void nearest(const RVector3 & pos, Index k,
+                 IndexArray & ids, RVector & dists) const;
+
+    /*! Return the ids of all points with a distance <= r to pos, sorted by
+     * ascending distance. */
+    IndexArray radius(const RVector3 & pos, double r) const;
+
+    /*! Return the id of the nearest point for every position. */
+    IndexArray nearest(const R3Vector & pos) const;
+
+    /*! Return the ids of the k nearest points for every position. */
+    std::vector< IndexArray > nearest(const R3Vector & pos, Index k) const;
+
+    /*! Return the ids of all points within r for every position. */
+    std::vector< IndexArray > radius(const R3Vector & pos, double r) const;
+
+    /*! One static kd-tree in flat arrays. */
+    struct Tree;
+
+protected:
+    /*! Merge the trees as long as a tree is not larger than twice its successor. */
+    void merge_();
+
+    std::vector< Tree * > trees_;
+
+private:
+    SpatialIndex(const SpatialIndex &);
+    SpatialIndex & operator = (const SpatialIndex &);
+};
+
+/*! Maximal amount of points in a leaf of \ref SpatialIndex. */
+#define SPATIALINDEX_LEAFSIZE 16
+
+} // namespace GIMLI
+
+#endif // _GIMLI_SPATIALINDEX__H
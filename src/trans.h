@@ -73,6 +73,30 @@ public:
     /*! Return derivative \f$ \frac{\partial f}{\partial x}(x) \f$ */
     virtual Vec deriv(const Vec & x) const { return Vec(x.size(), 1.0); }
 
+    /*! Allocation free variant of \ref trans for the range [start, end) of
+     * x into the same range of f. f is resized to x.size() if necessary,
+     * end < 0 means x.size(). Vector valued parameters of a transformation
+     * refer to the range start. The default falls back to \ref trans. */
+    virtual void trans_into(const Vec & x, Vec & f,
+                            Index start=0, SIndex end=-1) const {
+        Index e = range_(x, f, start, end);
+        f.setVal(this->trans(x(start, e)), start, e);
+    }
+
+    /*! Allocation free variant of \ref invTrans, see \ref trans_into. */
+    virtual void invTrans_into(const Vec & f, Vec & x,
+                               Index start=0, SIndex end=-1) const {
+        Index e = range_(f, x, start, end);
+        x.setVal(this->invTrans(f(start, e)), start, e);
+    }
+
+    /*! Allocation free variant of \ref deriv, see \ref trans_into. */
+    virtual void deriv_into(const Vec & x, Vec & d,
+                            Index start=0, SIndex end=-1) const {
+        Index e = range_(x, d, start, end);
+        d.setVal(this->deriv(x(start, e)), start, e);
+    }
+
     /*! Update parameter by df: invTrans(f(a) + df). \n
     intrinsic function that have never to be overloaded. */
     Vec update(const Vec & a, const Vec & b) const {
@@ -91,6 +115,18 @@ public:
     Vec error_brute(const Vec & a, const Vec & daBya) const {
         return abs(trans(a * (daBya + 1.0)) - trans(a));
     }
+
+protected:
+    /*! Resize out to in.size() if necessary and return the range end. */
+    inline Index range_(const Vec & in, Vec & out, Index start, SIndex end) const {
+        if (out.size() != in.size()) out.resize(in.size());
+        Index e = in.size();
+        if (end >= 0 && (Index)end < e) e = (Index)end;
+        if (start > e) {
+            throwLengthError(1, WHERE_AM_I + " start > end " + str(start) + " " + str(e));
+        }
+        return e;
+    }
 };
 
 /*! Base class for non-invertible transformations, e.g. transMult and transPlus \n
@@ -146,6 +182,21 @@ public:
     /*! Return \f$ a = \frac{\partial}{\partial x} (b + a * x) \f$ */
     virtual Vec deriv(const Vec & x) const { return factor_; }
 
+    virtual void trans_into(const Vec & x, Vec & f, Index start=0, SIndex end=-1) const {
+        Index e = this->range_(x, f, start, end);
+        for (Index i = start; i < e; i ++) f[i] = x[i] * factor_[i - start] + offset_[i - start];
+    }
+
+    virtual void invTrans_into(const Vec & f, Vec & x, Index start=0, SIndex end=-1) const {
+        Index e = this->range_(f, x, start, end);
+        for (Index i = start; i < e; i ++) x[i] = (f[i] - offset_[i - start]) / factor_[i - start];
+    }
+
+    virtual void deriv_into(const Vec & x, Vec & d, Index start=0, SIndex end=-1) const {
+        Index e = this->range_(x, d, start, end);
+        for (Index i = start; i < e; i ++) d[i] = factor_[i - start];
+    }
+
 protected:
     Vec factor_;
     Vec offset_;
@@ -166,6 +217,21 @@ public:
 
     virtual Vec deriv(const Vec & a) const { return Vec(a.size(), factor_); }
 
+    virtual void trans_into(const Vec & x, Vec & f, Index start=0, SIndex end=-1) const {
+        Index e = this->range_(x, f, start, end);
+        for (Index i = start; i < e; i ++) f[i] = x[i] * factor_ + offset_;
+    }
+
+    virtual void invTrans_into(const Vec & f, Vec & x, Index start=0, SIndex end=-1) const {
+        Index e = this->range_(f, x, start, end);
+        for (Index i = start; i < e; i ++) x[i] = (f[i] - offset_) / factor_;
+    }
+
+    virtual void deriv_into(const Vec & x, Vec & d, Index start=0, SIndex end=-1) const {
+        Index e = this->range_(x, d, start, end);
+        for (Index i = start; i < e; i ++) d[i] = factor_;
+    }
+
 protected:
     double factor_;
     double offset_;
@@ -268,6 +334,27 @@ public:
         return 1.0 / (a - lowerbound_);
     }
 
+    virtual void trans_into(const Vec & x, Vec & f, Index start=0, SIndex end=-1) const {
+        Index e = this->range_(x, f, start, end);
+        double lb1 = lowerbound_ * (1.0 + TRANSTOL);
+        double xMin = clampLower_(x, start, e, lb1);
+        for (Index i = start; i < e; i ++) f[i] = std::log(max(x[i], lb1) - lowerbound_);
+        if (xMin < lb1) warnLower_(xMin);
+    }
+
+    virtual void invTrans_into(const Vec & f, Vec & x, Index start=0, SIndex end=-1) const {
+        Index e = this->range_(f, x, start, end);
+        for (Index i = start; i < e; i ++) x[i] = std::exp(f[i]) + lowerbound_;
+    }
+
+    virtual void deriv_into(const Vec & x, Vec & d, Index start=0, SIndex end=-1) const {
+        Index e = this->range_(x, d, start, end);
+        double lb1 = lowerbound_ * (1.0 + TRANSTOL);
+        double xMin = clampLower_(x, start, e, lb1);
+        for (Index i = start; i < e; i ++) d[i] = 1.0 / (max(x[i], lb1) - lowerbound_);
+        if (xMin < lb1) warnLower_(xMin);
+    }
+
     //** suggested by Friedel(2003), but deactivated since inherited by transLogLU
 //    virtual Vec error(const Vec & a, const Vec & daBya) const { return log(1.0 + daBya); }
 
@@ -276,6 +363,18 @@ public:
     inline double lowerBound() const { return lowerbound_; }
 
 protected:
+    /*! Return the minimum of x in [start, end). */
+    inline double clampLower_(const Vec & x, Index start, Index end, double lb1) const {
+        double xMin = lb1;
+        for (Index i = start; i < end; i ++) xMin = min(xMin, x[i]);
+        return xMin;
+    }
+
+    inline void warnLower_(double xMin) const {
+        std::cerr << WHERE_AM_I << " Warning! " << xMin
+                  << " <=" << lowerbound_ << " lowerbound" << std::endl;
+    }
+
     double lowerbound_;
 };
 
@@ -332,11 +431,65 @@ public:
         return (1.0 / (tmp - this->lowerBound()) + 1.0 / (upperbound_ - tmp));
     }
 
+    virtual void trans_into(const Vec & x, Vec & f, Index start=0, SIndex end=-1) const {
+        if (std::fabs(upperbound_) < TOLERANCE) return TransLog< Vec >::trans_into(x, f, start, end);
+        Index e = this->range_(x, f, start, end);
+        double lb = this->lowerBound();
+        double lb1 = 0.0, ub1 = 0.0;
+        rangeCheck_(x, start, e, lb1, ub1);
+        for (Index i = start; i < e; i ++) {
+            double v = min(max(x[i], lb1), ub1);
+            f[i] = std::log(v - lb) - std::log(upperbound_ - v);
+        }
+    }
+
+    virtual void invTrans_into(const Vec & f, Vec & x, Index start=0, SIndex end=-1) const {
+        if (std::fabs(upperbound_) < TOLERANCE) return TransLog< Vec >::invTrans_into(f, x, start, end);
+        Index e = this->range_(f, x, start, end);
+        double lb = this->lowerBound();
+        for (Index i = start; i < e; i ++) {
+            double ex = std::exp(f[i]);
+            x[i] = (ex * upperbound_ + lb) / (ex + 1.0);
+        }
+    }
+
+    virtual void deriv_into(const Vec & x, Vec & d, Index start=0, SIndex end=-1) const {
+        if (std::fabs(upperbound_) < TOLERANCE) return TransLog< Vec >::deriv_into(x, d, start, end);
+        Index e = this->range_(x, d, start, end);
+        double lb = this->lowerBound();
+        double lb1 = 0.0, ub1 = 0.0;
+        rangeCheck_(x, start, e, lb1, ub1);
+        for (Index i = start; i < e; i ++) {
+            double v = min(max(x[i], lb1), ub1);
+            d[i] = 1.0 / (v - lb) + 1.0 / (upperbound_ - v);
+        }
+    }
+
     inline void setUpperBound(double ub) { upperbound_ = ub; }
 
     inline double upperBound() const { return upperbound_; }
 
 protected:
+    /*! Limits as used by \ref rangify, with its warnings. */
+    void rangeCheck_(const Vec & x, Index start, Index end,
+                     double & lb1, double & ub1) const {
+        lb1 = this->lowerBound() * (1.0 + TRANSTOL);
+        ub1 = upperbound_ * (1.0 - TRANSTOL);
+        double xMin = lb1, xMax = ub1;
+        for (Index i = start; i < end; i ++) {
+            xMin = min(xMin, x[i]);
+            xMax = max(xMax, x[i]);
+        }
+        if (xMin < lb1){
+            std::cerr << WHERE_AM_I << " Warning! " << xMin
+                      << " <=" << this->lowerBound() << " lower bound" << std::endl;
+        }
+        if (xMax > ub1){
+            std::cerr << WHERE_AM_I << " Warning! " << xMax << " > "
+                      << upperbound_ << " upper bound" << std::endl;
+        }
+    }
+
   double upperbound_;
 };
 
@@ -488,6 +641,17 @@ public:
     virtual Vec invTrans(const Vec & a) const { return TransLog< Vec >::invTrans(a) / factor_; }
     virtual Vec deriv(const Vec & a) const { return TransLog< Vec >::deriv(a * factor_) * factor_; }
 
+    /*! The factor is applied by the overloads above, use the generic path. */
+    virtual void trans_into(const Vec & x, Vec & f, Index start=0, SIndex end=-1) const {
+        Trans< Vec >::trans_into(x, f, start, end);
+    }
+    virtual void invTrans_into(const Vec & f, Vec & x, Index start=0, SIndex end=-1) const {
+        Trans< Vec >::invTrans_into(f, x, start, end);
+    }
+    virtual void deriv_into(const Vec & x, Vec & d, Index start=0, SIndex end=-1) const {
+        Trans< Vec >::deriv_into(x, d, start, end);
+    }
+
 protected:
     Vec factor_;
 };
@@ -554,6 +718,17 @@ public:
         return TransLogLU< Vec >::deriv(a * factor_) * factor_;
     }
 
+    /*! The factor is applied by the overloads above, use the generic path. */
+    virtual void trans_into(const Vec & x, Vec & f, Index start=0, SIndex end=-1) const {
+        Trans< Vec >::trans_into(x, f, start, end);
+    }
+    virtual void invTrans_into(const Vec & f, Vec & x, Index start=0, SIndex end=-1) const {
+        Trans< Vec >::invTrans_into(f, x, start, end);
+    }
+    virtual void deriv_into(const Vec & x, Vec & d, Index start=0, SIndex end=-1) const {
+        Trans< Vec >::deriv_into(x, d, start, end);
+    }
+
 protected:
     Vec factor_;
 };
@@ -596,6 +771,32 @@ public:
         return tmp;
     }
 
+    /*! Region wise in place transformation without slicing. Partial ranges
+     * fall back to the base class. */
+    virtual void trans_into(const Vec & x, Vec & f, Index start=0, SIndex end=-1) const {
+        if (!fullRange_(x, start, end)) return Trans< Vec >::trans_into(x, f, start, end);
+        this->range_(x, f, start, end);
+        for (Index i = 0; i < transVec_.size(); i ++){
+            transVec_[i]->trans_into(x, f, bounds_[i].first, bounds_[i].second);
+        }
+    }
+
+    virtual void invTrans_into(const Vec & f, Vec & x, Index start=0, SIndex end=-1) const {
+        if (!fullRange_(f, start, end)) return Trans< Vec >::invTrans_into(f, x, start, end);
+        this->range_(f, x, start, end);
+        for (Index i = 0; i < transVec_.size(); i ++){
+            transVec_[i]->invTrans_into(f, x, bounds_[i].first, bounds_[i].second);
+        }
+    }
+
+    virtual void deriv_into(const Vec & x, Vec & d, Index start=0, SIndex end=-1) const {
+        if (!fullRange_(x, start, end)) return Trans< Vec >::deriv_into(x, d, start, end);
+        this->range_(x, d, start, end);
+        for (Index i = 0; i < transVec_.size(); i ++){
+            transVec_[i]->deriv_into(x, d, bounds_[i].first, bounds_[i].second);
+        }
+    }
+
     Index size() const { return transVec_.size(); }
 
     void clear() { transVec_.clear(); bounds_.clear(); }
@@ -612,6 +813,10 @@ public:
     }
 
 protected:
+    inline bool fullRange_(const Vec & x, Index start, SIndex end) const {
+        return start == 0 && (end < 0 || (Index)end >= x.size());
+    }
+
     std::vector < Trans< Vec > * > transVec_;
     std::vector < std::pair< Index, Index> > bounds_;
 };
@@ -305,14 +305,27 @@ RVector TravelTimeDijkstraModelling::response(const RVector & slowness) {
     this->mapModel(slowness, background_);
 
     dijkstra_.setGraph(createGraph(mesh_->cellAttributes()));
+    return travelTimes_(dijkstra_);
+}
+
+RVector TravelTimeDijkstraModelling::response_mt(const RVector & slowness,
+                                                 Index i) const {
+    double background = background_;
+    if (background < TOLERANCE) background = 1e16;
+
+    Dijkstra dijkstra(createGraph(createMappedModel(slowness, background)));
+    return travelTimes_(dijkstra);
+}
+
+RVector TravelTimeDijkstraModelling::travelTimes_(Dijkstra & dijkstra) const {
     Index nShots = shotNodeId_.size();
     Index nRecei = receNodeId_.size();
     RMatrix dMap(nShots, nRecei);
 
     for (Index shot = 0; shot < nShots; shot ++) {
-        dijkstra_.setStartNode(shotNodeId_[shot]);
+        dijkstra.setStartNode(shotNodeId_[shot]);
         for (Index i = 0; i < nRecei; i ++) {
-            dMap[shot][i] = dijkstra_.distance(receNodeId_[i]);
+            dMap[shot][i] = dijkstra.distance(receNodeId_[i]);
         }
     }
 
@@ -322,10 +335,16 @@ RVector TravelTimeDijkstraModelling::response(const RVector & slowness) {
     RVector resp(nData);
 
     for (Index dataIdx = 0; dataIdx < nData; dataIdx ++) {
-        s = shotsInv_[Index((*dataContainer_)("s")[dataIdx])];
-        g = receiInv_[Index((*dataContainer_)("g")[dataIdx])];
-//         if (dataIdx < 10 ) std::cout << s << " " << (*dataContainer_)("s")[dataIdx] << " "
-//                    << g << " " << (*dataContainer_)("g")[dataIdx] << " " << dMap[s][g] << std::endl;
+        std::map< Index, Index >::const_iterator sIt =
+            shotsInv_.find(Index((*dataContainer_)("s")[dataIdx]));
+        std::map< Index, Index >::const_iterator gIt =
+            receiInv_.find(Index((*dataContainer_)("g")[dataIdx]));
+        if (sIt == shotsInv_.end() || gIt == receiInv_.end()){
+            throwError(1, WHERE_AM_I + " shot or geophone of datum " + str(dataIdx) +
+                       " unknown. Data changed without updating the mesh dependencies?");
+        }
+        s = sIt->second;
+        g = gIt->second;
         resp[dataIdx] = dMap[s][g];
     }
 
@@ -102,6 +102,10 @@ public:
     /*! Interface. Calculate response */
     virtual RVector response(const RVector & slowness);
 
+    /*! Interface. Read only response, the mesh and the internal
+     * Dijkstra remain untouched, so it can be called from several threads. */
+    virtual RVector response_mt(const RVector & slowness, Index i=0) const;
+
     /*! Interface. */
     virtual void createJacobian(const RVector & slowness);
 
@@ -123,6 +127,10 @@ protected:
     /*! Automatically looking for shot and receiver points if the mesh is changed. */
     virtual void updateMeshDependency_();
 
+    /*! Collect the travel times for all data from the shortest paths
+     * of a Dijkstra with valid graph. */
+    RVector travelTimes_(Dijkstra & dijkstra) const;
+
     Dijkstra dijkstra_;
     double background_;
 
@@ -42,6 +42,7 @@
 
 #include "gimli.h"
 #include "expressions.h"
+#include "vectorkernels.h"
 
 #include <string>
 #include <vector>
@@ -53,6 +54,7 @@
 #include <fstream>
 #include <cerrno>
 #include <iterator>
+#include <new>
 
 #ifdef USE_BOOST_BIND
     #include <boost/bind.hpp>
@@ -77,6 +79,29 @@ inline void Dump(const void * mem, unsigned int n) {
 }
 #endif
 
+/*! Inplace a[i] = op(a[i], b[i]). Overloaded for double to use \ref simdApply. */
+template < class T, class Op >
+inline void applyVec_(T * a, const T * b, Index n, Op op){
+    for (Index i = 0; i < n; i ++) a[i] = op(a[i], b[i]);
+}
+
+/*! Inplace a[i] = op(a[i], b). Overloaded for double to use \ref simdApply. */
+template < class T, class Op >
+inline void applyVal_(T * a, const T & b, Index n, Op op){
+    for (Index i = 0; i < n; i ++) a[i] = op(a[i], b);
+}
+
+#define DEFINE_SIMD_APPLY__(FUNCT, OP) \
+inline void applyVec_(double * a, const double * b, Index n, FUNCT){ simdApply(a, b, n, OP); } \
+inline void applyVal_(double * a, const double & b, Index n, FUNCT){ simdApply(a, b, n, OP); } \
+
+DEFINE_SIMD_APPLY__(PLUS, SIMDPlus)
+DEFINE_SIMD_APPLY__(MINUS, SIMDMinus)
+DEFINE_SIMD_APPLY__(MULT, SIMDMult)
+DEFINE_SIMD_APPLY__(DIVID, SIMDDivid)
+
+#undef DEFINE_SIMD_APPLY__
+
 template < class ValueType > class DLLEXPORT VectorIterator {
 public:
     typedef ValueType value_type;
@@ -649,9 +674,9 @@ DEFINE_COMPARE_OPERATOR__(>, std::greater)
 #define DEFINE_UNARY_MOD_OPERATOR__(OP, FUNCT) \
   inline Vector< ValueType > & operator OP##= (const Vector < ValueType > & v) { \
         ASSERT_EMPTY(v) \
-        std::transform(data_, data_ + size_, &v[0], data_, FUNCT()); return *this; } \
+        applyVec_(data_, &v[0], size_, FUNCT()); return *this; } \
   inline Vector< ValueType > & operator OP##= (const ValueType & val) { \
-        for (Index i = 0; i < size_; i ++) data_[i] OP##= val; return *this; } \
+        applyVal_(data_, val, size_, FUNCT()); return *this; } \
 
 DEFINE_UNARY_MOD_OPERATOR__(+, PLUS)
 DEFINE_UNARY_MOD_OPERATOR__(-, MINUS)
@@ -676,7 +701,8 @@ DEFINE_UNARY_MOD_OPERATOR__(*, MULT)
         resize(n, 0);
     }
 
-    /*! Reserve memory. Old data are preserved*/
+    /*! Reserve memory. Old data are preserved. The storage is aligned to
+     * \ref GIMLI_VECTOR_ALIGNMENT bytes. */
     void reserve(Index n){
 
         Index newCapacity = max(1, n);
@@ -688,10 +714,10 @@ DEFINE_UNARY_MOD_OPERATOR__(*, MULT)
 //         __MS(n << " " << capacity_ << " " << newCapacity)
 
         if (newCapacity != capacity_) {
-            ValueType * buffer = new ValueType[newCapacity];
+            ValueType * buffer = allocate_(newCapacity);
 
             std::memcpy(buffer, data_, sizeof(ValueType) * min(capacity_, newCapacity));
-            if (data_)  delete [] data_;
+            deallocate_(data_, capacity_);
             data_  = buffer;
             capacity_ = newCapacity;
             //std::copy(&tmp[0], &tmp[min(tmp.size(), n)], data_);
@@ -882,12 +908,27 @@ tolerance);
 protected:
 
     void free_(){
+        deallocate_(data_, capacity_);
         size_ = 0;
         capacity_ = 0;
-        if (data_)  delete [] data_;
         data_  = NULL;
     }
 
+    /*! Aligned replacement for new ValueType[n]. Draws from the thread
+     * local arena if a \ref VectorArenaScope is open. */
+    static ValueType * allocate_(Index n){
+        ValueType * p = static_cast< ValueType * >(vectorArenaMalloc(sizeof(ValueType) * n));
+        for (Index i = 0; i < n; i ++) new (p + i) ValueType;
+        return p;
+    }
+
+    /*! Aligned replacement for delete [] p. */
+    static void deallocate_(ValueType * p, Index n){
+        if (!p) return;
+        for (Index i = 0; i < n; i ++) p[i].~ValueType();
+        vectorArenaFree(p, sizeof(ValueType) * n);
+    }
+
     void copy_(const Vector< ValueType > & v){
         if (v.size()) {
             resize(v.size());
@@ -932,21 +973,22 @@ void Vector< ValueType >::add(const ElementMatrix < double >& A, const Vector< d
 
 
 
-template< class ValueType, class Iter > class AssignResult{
+/*! Evaluate the expression result into a[start, end). Large vectors are
+ * split over several threads with \ref vectorDistribute. */
+template< class ValueType, class Iter > class AssignResult {
 public:
-    AssignResult(Vector< ValueType > & a, const Iter & result, Index start, Index end)
-     : a_(&a), iter_(result), start_(start), end_(end){
-    }
-    void operator()() {
-        ValueType * iter = a_->begin().ptr();
-        //std::cout << start_ << " " << end_ << std::endl;
-        for (Index i = start_; i < end_; i++) iter[i] = iter_[i];
+    AssignResult(Vector< ValueType > & a, const Iter & result)
+     : a_(&a), iter_(&result){ }
+
+    static void calc(void * data, Index start, Index end) {
+        AssignResult * self = static_cast< AssignResult * >(data);
+        ValueType * iter = self->a_->begin().ptr();
+        Iter result(*self->iter_);
+        for (Index i = start; i < end; i++) iter[i] = result[i];
     }
 
     Vector< ValueType > * a_;
-    Iter iter_;
-    Index start_;
-    Index end_;
+    const Iter * iter_;
 };
 
 struct BINASSIGN { template < class T > inline T operator()(const T & a, const T & b) const { return b; } };
@@ -987,6 +1029,13 @@ template< class ValueType, class Iter > void assignResult(Vector< ValueType > &
 
     #else  // no std algo
         #ifdef EXPRVEC_USE_INDIRECTION
+            Index nThreads = vectorThreadCount(v.size());
+            if (nThreads > 1){
+                AssignResult< ValueType, Iter > assign(v, result2);
+                vectorDistribute(&AssignResult< ValueType, Iter >::calc, &assign,
+                                 v.size(), nThreads);
+                return;
+            }
             ValueType * iter = v.begin().ptr();
 
             // Inlined expression
@@ -1270,6 +1319,16 @@ ValueType dot(const Vector< ValueType > & v1, const Vector< ValueType > & v2){
     return mult(v1,v2);
 }
 
+/*! Return scalar product <v1, v2> with the \ref simdDot kernel. */
+inline double mult(const RVector & v1, const RVector & v2){
+    ASSERT_EQUAL(v1.size(), v2.size())
+    return simdDot(v1.begin().ptr(), v2.begin().ptr(), v1.size());
+}
+
+inline double dot(const RVector & v1, const RVector & v2){
+    return mult(v1, v2);
+}
+
 //template double dot(const RVector & v1, const RVector & v2);
 //template double mult(const RVector & v1, const RVector & v2);
 
@@ -1404,8 +1463,31 @@ template < class T > T sum(const Vector < T > & v){
     //return std::accumulate(v.begin(), v.end(), (T)0.0);
 }
 
-template < class T, class A > T min(const __VectorExpr< T, A > & a){ return min(Vector< T >(a)); }
-template < class T, class A > T max(const __VectorExpr< T, A > & a){ return max(Vector< T >(a)); }
+inline double sum(const RVector & v){
+    return simdSum(v.begin().ptr(), v.size());
+}
+
+/*! Single pass over the expression without a temporary vector. */
+template < class T, class A > T min(const __VectorExpr< T, A > & a){
+    ASSERT_EMPTY(a)
+    T ret = a[0];
+    for (Index i = 1, imax = a.size(); i < imax; i ++){
+        T v = a[i];
+        if (v < ret) ret = v;
+    }
+    return ret;
+}
+
+/*! Single pass over the expression without a temporary vector. */
+template < class T, class A > T max(const __VectorExpr< T, A > & a){
+    ASSERT_EMPTY(a)
+    T ret = a[0];
+    for (Index i = 1, imax = a.size(); i < imax; i ++){
+        T v = a[i];
+        if (v > ret) ret = v;
+    }
+    return ret;
+}
 
 inline Complex max(const CVector & v){
     ASSERT_EMPTY(v)
@@ -1430,6 +1512,16 @@ template < class T > T max(const Vector < T > & v){
     return *std::max_element(&v[0], &v[0] + v.size());
 }
 
+inline double min(const RVector & v){
+    ASSERT_EMPTY(v)
+    return simdMin(v.begin().ptr(), v.size());
+}
+
+inline double max(const RVector & v){
+    ASSERT_EMPTY(v)
+    return simdMax(v.begin().ptr(), v.size());
+}
+
 template < class ValueType >
     ValueType mean(const Vector < ValueType > & a){
         return sum(a) / ValueType(a.size());
@@ -0,0 +1,513 @@
+/******************************************************************************
+ *   Copyright (C) 2007-2018 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+// Explicit kernels need the gcc/clang target attribute to be compiled
+// without global -mavx2 flags. Other compilers use the scalar kernels.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && !defined(GIMLI_NO_SIMD)
+    #define GIMLI_SIMD_X86 1
+    #include <immintrin.h>
+    #define TARGET_AVX2__ __attribute__((target("avx2,fma")))
+    #define TARGET_AVX512__ __attribute__((target("avx512f")))
+#endif
+
+// intrinsic headers first, gimli.h defines macros like __M
+#include "vectorkernels.h"
+#include "calculateMultiThread.h"
+
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#if defined(_WIN32)
+    #include <malloc.h>
+#endif
+
+namespace GIMLI{
+
+void * alignedMalloc(Index bytes){
+    if (bytes == 0) bytes = GIMLI_VECTOR_ALIGNMENT;
+    void * ptr = NULL;
+#if defined(_WIN32)
+    ptr = _aligned_malloc(bytes, GIMLI_VECTOR_ALIGNMENT);
+#else
+    if (posix_memalign(&ptr, GIMLI_VECTOR_ALIGNMENT, bytes) != 0) ptr = NULL;
+#endif
+    if (!ptr) {
+        throwError(1, WHERE_AM_I + " unable to allocate " + str(bytes) + " bytes.");
+    }
+    return ptr;
+}
+
+void alignedFree(void * ptr){
+    if (!ptr) return;
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+/*! Cache of released vector storage, one per thread and outermost scope. */
+struct VectorArena_{
+    VectorArena_(Index maxBytes) : maxBytes(maxBytes), depth(1) {}
+
+    ~VectorArena_(){
+        for (std::map< Index, std::vector< void * > >::iterator it = blocks.begin();
+             it != blocks.end(); it ++){
+            for (Index i = 0; i < it->second.size(); i ++) alignedFree(it->second[i]);
+        }
+    }
+
+    std::map< Index, std::vector< void * > > blocks;
+    Index maxBytes;
+    Index depth;
+    VectorArenaStats stats;
+};
+
+static thread_local VectorArena_ * __GIMLI_VECTOR_ARENA__ = NULL;
+
+std::ostream & operator << (std::ostream & str, const VectorArenaStats & s){
+    str << "hits: " << s.hits << " misses: " << s.misses
+        << " recycled: " << s.recycled << " dropped: " << s.dropped
+        << " peak: " << s.peakBytes / (1024.0 * 1024.0) << " MB";
+    return str;
+}
+
+VectorArenaScope::VectorArenaScope(Index maxBytes){
+    if (__GIMLI_VECTOR_ARENA__){
+        __GIMLI_VECTOR_ARENA__->depth ++;
+    } else {
+        __GIMLI_VECTOR_ARENA__ = new VectorArena_(maxBytes);
+    }
+}
+
+VectorArenaScope::~VectorArenaScope(){
+    if (--__GIMLI_VECTOR_ARENA__->depth == 0){
+        delete __GIMLI_VECTOR_ARENA__;
+        __GIMLI_VECTOR_ARENA__ = NULL;
+    }
+}
+
+VectorArenaStats VectorArenaScope::stats() const {
+    return __GIMLI_VECTOR_ARENA__->stats;
+}
+
+VectorArenaStats vectorArenaStats(){
+    if (__GIMLI_VECTOR_ARENA__) return __GIMLI_VECTOR_ARENA__->stats;
+    return VectorArenaStats();
+}
+
+void * vectorArenaMalloc(Index bytes){
+    VectorArena_ * arena = __GIMLI_VECTOR_ARENA__;
+    if (!arena) return alignedMalloc(bytes);
+
+    std::map< Index, std::vector< void * > >::iterator it = arena->blocks.find(bytes);
+    if (it != arena->blocks.end() && !it->second.empty()){
+        void * ptr = it->second.back();
+        it->second.pop_back();
+        arena->stats.cachedBytes -= bytes;
+        arena->stats.hits ++;
+        return ptr;
+    }
+    arena->stats.misses ++;
+    return alignedMalloc(bytes);
+}
+
+void vectorArenaFree(void * ptr, Index bytes){
+    if (!ptr) return;
+    VectorArena_ * arena = __GIMLI_VECTOR_ARENA__;
+
+    if (!arena) {
+        alignedFree(ptr);
+    } else if (arena->stats.cachedBytes + bytes > arena->maxBytes){
+        arena->stats.dropped ++;
+        alignedFree(ptr);
+    } else {
+        arena->blocks[bytes].push_back(ptr);
+        arena->stats.cachedBytes += bytes;
+        arena->stats.peakBytes = max(arena->stats.peakBytes, arena->stats.cachedBytes);
+        arena->stats.recycled ++;
+    }
+}
+
+static SIMDLevel detectSIMDLevel_(){
+#if GIMLI_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMDAVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SIMDAVX2;
+#endif
+    return SIMDScalar;
+}
+
+// The levels are zero (SIMDScalar) until their dynamic initialization ran,
+// so vectors used by earlier static constructors safely take the scalar path.
+static SIMDLevel __GIMLI_SIMD_CPU__ = detectSIMDLevel_();
+static SIMDLevel __GIMLI_SIMD_LEVEL__ = __GIMLI_SIMD_CPU__;
+static Index __GIMLI_VECTOR_MT_THRESHOLD__ = 1 << 20;
+
+SIMDLevel simdLevel(){ return __GIMLI_SIMD_LEVEL__; }
+
+void setSIMDLevel(SIMDLevel level){
+    __GIMLI_SIMD_LEVEL__ = min(level, __GIMLI_SIMD_CPU__);
+}
+
+void setVectorThreadingThreshold(Index n){ __GIMLI_VECTOR_MT_THRESHOLD__ = n; }
+
+Index vectorThreadingThreshold(){ return __GIMLI_VECTOR_MT_THRESHOLD__; }
+
+Index vectorThreadCount(Index n){
+    if (__GIMLI_VECTOR_MT_THRESHOLD__ == 0 || n < __GIMLI_VECTOR_MT_THRESHOLD__) return 1;
+    // already inside a threaded calculation
+    if (workerThread()) return 1;
+    // at least half a threshold of values per thread
+    return max(Index(1), min(threadCount(),
+                             2 * n / __GIMLI_VECTOR_MT_THRESHOLD__));
+}
+
+//** scalar kernels, four independent accumulators to hide the add latency
+static double sumScalar_(const double * a, Index n){
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    Index i = 0;
+    for (; i + 4 <= n; i += 4){
+        s0 += a[i]; s1 += a[i + 1]; s2 += a[i + 2]; s3 += a[i + 3];
+    }
+    for (; i < n; i ++) s0 += a[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+static double dotScalar_(const double * a, const double * b, Index n){
+    double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+    Index i = 0;
+    for (; i + 4 <= n; i += 4){
+        s0 += a[i] * b[i];         s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2]; s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i ++) s0 += a[i] * b[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+static double minScalar_(const double * a, Index n){
+    double ret = a[0];
+    for (Index i = 1; i < n; i ++) if (a[i] < ret) ret = a[i];
+    return ret;
+}
+
+static double maxScalar_(const double * a, Index n){
+    double ret = a[0];
+    for (Index i = 1; i < n; i ++) if (a[i] > ret) ret = a[i];
+    return ret;
+}
+
+#define APPLY_LOOP__(W, LOAD, STORE, BVAL, VOP, SOP, SVAL) \
+    for (; i + W <= n; i += W) STORE(a + i, VOP(LOAD(a + i), BVAL)); \
+    for (; i < n; i ++) a[i] = a[i] SOP SVAL; \
+
+#define APPLY_SWITCH__(W, LOAD, STORE, BVAL, ADD, SUB, MUL, DIV, SVAL) \
+    Index i = 0; \
+    switch (op){ \
+        case SIMDPlus:  APPLY_LOOP__(W, LOAD, STORE, BVAL, ADD, +, SVAL) break; \
+        case SIMDMinus: APPLY_LOOP__(W, LOAD, STORE, BVAL, SUB, -, SVAL) break; \
+        case SIMDMult:  APPLY_LOOP__(W, LOAD, STORE, BVAL, MUL, *, SVAL) break; \
+        case SIMDDivid: APPLY_LOOP__(W, LOAD, STORE, BVAL, DIV, /, SVAL) break; \
+    } \
+
+static void applyScalar_(double * a, const double * b, Index n, SIMDOp op){
+    Index i = 0;
+    switch (op){
+        case SIMDPlus:  for (; i < n; i ++) a[i] += b[i]; break;
+        case SIMDMinus: for (; i < n; i ++) a[i] -= b[i]; break;
+        case SIMDMult:  for (; i < n; i ++) a[i] *= b[i]; break;
+        case SIMDDivid: for (; i < n; i ++) a[i] /= b[i]; break;
+    }
+}
+
+static void applyScalar_(double * a, double b, Index n, SIMDOp op){
+    Index i = 0;
+    switch (op){
+        case SIMDPlus:  for (; i < n; i ++) a[i] += b; break;
+        case SIMDMinus: for (; i < n; i ++) a[i] -= b; break;
+        case SIMDMult:  for (; i < n; i ++) a[i] *= b; break;
+        case SIMDDivid: for (; i < n; i ++) a[i] /= b; break;
+    }
+}
+
+#if GIMLI_SIMD_X86
+//** AVX2 kernels
+TARGET_AVX2__ static double hsum256_(__m256d v){
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+TARGET_AVX2__ static double sumAVX2_(const double * a, Index n){
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    Index i = 0;
+    for (; i + 8 <= n; i += 8){
+        s0 = _mm256_add_pd(s0, _mm256_loadu_pd(a + i));
+        s1 = _mm256_add_pd(s1, _mm256_loadu_pd(a + i + 4));
+    }
+    double s = hsum256_(_mm256_add_pd(s0, s1));
+    for (; i < n; i ++) s += a[i];
+    return s;
+}
+
+TARGET_AVX2__ static double dotAVX2_(const double * a, const double * b, Index n){
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    Index i = 0;
+    for (; i + 8 <= n; i += 8){
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), s1);
+    }
+    double s = hsum256_(_mm256_add_pd(s0, s1));
+    for (; i < n; i ++) s += a[i] * b[i];
+    return s;
+}
+
+TARGET_AVX2__ static double minAVX2_(const double * a, Index n){
+    if (n < 4) return minScalar_(a, n);
+    __m256d m = _mm256_loadu_pd(a);
+    Index i = 4;
+    for (; i + 4 <= n; i += 4) m = _mm256_min_pd(m, _mm256_loadu_pd(a + i));
+    double t[4]; _mm256_storeu_pd(t, m);
+    double ret = minScalar_(t, 4);
+    for (; i < n; i ++) if (a[i] < ret) ret = a[i];
+    return ret;
+}
+
+TARGET_AVX2__ static double maxAVX2_(const double * a, Index n){
+    if (n < 4) return maxScalar_(a, n);
+    __m256d m = _mm256_loadu_pd(a);
+    Index i = 4;
+    for (; i + 4 <= n; i += 4) m = _mm256_max_pd(m, _mm256_loadu_pd(a + i));
+    double t[4]; _mm256_storeu_pd(t, m);
+    double ret = maxScalar_(t, 4);
+    for (; i < n; i ++) if (a[i] > ret) ret = a[i];
+    return ret;
+}
+
+TARGET_AVX2__ static void applyAVX2_(double * a, const double * b, Index n, SIMDOp op){
+    APPLY_SWITCH__(4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_loadu_pd(b + i),
+                   _mm256_add_pd, _mm256_sub_pd, _mm256_mul_pd, _mm256_div_pd, b[i])
+}
+
+TARGET_AVX2__ static void applyAVX2_(double * a, double b, Index n, SIMDOp op){
+    __m256d bv = _mm256_set1_pd(b);
+    APPLY_SWITCH__(4, _mm256_loadu_pd, _mm256_storeu_pd, bv,
+                   _mm256_add_pd, _mm256_sub_pd, _mm256_mul_pd, _mm256_div_pd, b)
+}
+
+//** AVX-512 kernels
+TARGET_AVX512__ static double hsum512_(__m512d v){
+    double t[8]; _mm512_storeu_pd(t, v);
+    return ((t[0] + t[1]) + (t[2] + t[3])) + ((t[4] + t[5]) + (t[6] + t[7]));
+}
+
+TARGET_AVX512__ static double sumAVX512_(const double * a, Index n){
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    Index i = 0;
+    for (; i + 16 <= n; i += 16){
+        s0 = _mm512_add_pd(s0, _mm512_loadu_pd(a + i));
+        s1 = _mm512_add_pd(s1, _mm512_loadu_pd(a + i + 8));
+    }
+    double s = hsum512_(_mm512_add_pd(s0, s1));
+    for (; i < n; i ++) s += a[i];
+    return s;
+}
+
+TARGET_AVX512__ static double dotAVX512_(const double * a, const double * b, Index n){
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    Index i = 0;
+    for (; i + 16 <= n; i += 16){
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), s0);
+        s1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), s1);
+    }
+    double s = hsum512_(_mm512_add_pd(s0, s1));
+    for (; i < n; i ++) s += a[i] * b[i];
+    return s;
+}
+
+TARGET_AVX512__ static double minAVX512_(const double * a, Index n){
+    if (n < 8) return minScalar_(a, n);
+    __m512d m = _mm512_loadu_pd(a);
+    Index i = 8;
+    //** the full mask with m as pass through, since the unmasked
+    //** _mm512_min_pd passes an undefined register to the builtin
+    for (; i + 8 <= n; i += 8) m = _mm512_mask_min_pd(m, 0xFF, m, _mm512_loadu_pd(a + i));
+    double t[8]; _mm512_storeu_pd(t, m);
+    double ret = minScalar_(t, 8);
+    for (; i < n; i ++) if (a[i] < ret) ret = a[i];
+    return ret;
+}
+
+TARGET_AVX512__ static double maxAVX512_(const double * a, Index n){
+    if (n < 8) return maxScalar_(a, n);
+    __m512d m = _mm512_loadu_pd(a);
+    Index i = 8;
+    //** see minAVX512_
+    for (; i + 8 <= n; i += 8) m = _mm512_mask_max_pd(m, 0xFF, m, _mm512_loadu_pd(a + i));
+    double t[8]; _mm512_storeu_pd(t, m);
+    double ret = maxScalar_(t, 8);
+    for (; i < n; i ++) if (a[i] > ret) ret = a[i];
+    return ret;
+}
+
+TARGET_AVX512__ static void applyAVX512_(double * a, const double * b, Index n, SIMDOp op){
+    APPLY_SWITCH__(8, _mm512_loadu_pd, _mm512_storeu_pd, _mm512_loadu_pd(b + i),
+                   _mm512_add_pd, _mm512_sub_pd, _mm512_mul_pd, _mm512_div_pd, b[i])
+}
+
+TARGET_AVX512__ static void applyAVX512_(double * a, double b, Index n, SIMDOp op){
+    __m512d bv = _mm512_set1_pd(b);
+    APPLY_SWITCH__(8, _mm512_loadu_pd, _mm512_storeu_pd, bv,
+                   _mm512_add_pd, _mm512_sub_pd, _mm512_mul_pd, _mm512_div_pd, b)
+}
+#endif // GIMLI_SIMD_X86
+
+#undef APPLY_SWITCH__
+#undef APPLY_LOOP__
+
+#if GIMLI_SIMD_X86
+    #define DISPATCH__(NAME, ARGS) \
+        switch (__GIMLI_SIMD_LEVEL__){ \
+            case SIMDAVX512: return NAME##AVX512_ ARGS; \
+            case SIMDAVX2: return NAME##AVX2_ ARGS; \
+            default: return NAME##Scalar_ ARGS; \
+        }
+#else
+    #define DISPATCH__(NAME, ARGS) return NAME##Scalar_ ARGS;
+#endif
+
+static double sum_(const double * a, Index n){ DISPATCH__(sum, (a, n)) }
+static double dot_(const double * a, const double * b, Index n){ DISPATCH__(dot, (a, b, n)) }
+static double min_(const double * a, Index n){ DISPATCH__(min, (a, n)) }
+static double max_(const double * a, Index n){ DISPATCH__(max, (a, n)) }
+static void apply_(double * a, const double * b, Index n, SIMDOp op){ DISPATCH__(apply, (a, b, n, op)) }
+static void apply_(double * a, double b, Index n, SIMDOp op){ DISPATCH__(apply, (a, b, n, op)) }
+
+#undef DISPATCH__
+
+/*! Threads work on blocks of values, so every chunk starts at a cache line
+ * boundary relative to the vector start. */
+static const Index VECTOR_KERNEL_BLOCK = 1024;
+
+enum VectorKernelType{KernelSum, KernelDot, KernelMin, KernelMax,
+                      KernelApplyVec, KernelApplyVal};
+
+class VectorKernelMT : public BaseCalcMT{
+public:
+    VectorKernelMT(VectorKernelType type, double * a, const double * b,
+                   double val, Index n, SIMDOp op, std::vector< double > & partial)
+    : BaseCalcMT(1, false), type_(type), a_(a), b_(b), val_(val), n_(n),
+      op_(op), partial_(&partial) {}
+
+    virtual ~VectorKernelMT(){}
+
+    virtual void calc(Index tNr=0){
+        Index start = min(start_ * VECTOR_KERNEL_BLOCK, n_);
+        Index end = min(end_ * VECTOR_KERNEL_BLOCK, n_);
+        Index n = end - start;
+        double & ret = (*partial_)[tNr];
+
+        switch (type_){
+            case KernelSum: ret = sum_(a_ + start, n); break;
+            case KernelDot: ret = dot_(a_ + start, b_ + start, n); break;
+            // empty chunks contribute a[0], which is neutral for min and max
+            case KernelMin: ret = n ? min_(a_ + start, n) : a_[0]; break;
+            case KernelMax: ret = n ? max_(a_ + start, n) : a_[0]; break;
+            case KernelApplyVec: apply_(a_ + start, b_ + start, n, op_); break;
+            case KernelApplyVal: apply_(a_ + start, val_, n, op_); break;
+        }
+    }
+
+protected:
+    VectorKernelType type_;
+    double * a_;
+    const double * b_;
+    double val_;
+    Index n_;
+    SIMDOp op_;
+    std::vector< double > * partial_;
+};
+
+class VectorRangeMT : public BaseCalcMT{
+public:
+    VectorRangeMT(void (*fn)(void *, Index, Index), void * data)
+    : BaseCalcMT(1, false), fn_(fn), data_(data) {}
+
+    virtual ~VectorRangeMT(){}
+
+    virtual void calc(Index tNr=0){ fn_(data_, start_, end_); }
+
+protected:
+    void (*fn_)(void *, Index, Index);
+    void * data_;
+};
+
+void vectorDistribute(void (*fn)(void * data, Index start, Index end),
+                      void * data, Index n, Index nThreads){
+    distributeCalc(VectorRangeMT(fn, data), n, nThreads);
+}
+
+static double run_(VectorKernelType type, double * a, const double * b,
+                   double val, Index n, SIMDOp op){
+    Index nThreads = vectorThreadCount(n);
+    std::vector< double > partial(nThreads, 0.0);
+
+    Index nBlocks = (n + VECTOR_KERNEL_BLOCK - 1) / VECTOR_KERNEL_BLOCK;
+    distributeCalc(VectorKernelMT(type, a, b, val, n, op, partial),
+                   nBlocks, nThreads);
+
+    switch (type){
+        case KernelMin: return minScalar_(&partial[0], nThreads);
+        case KernelMax: return maxScalar_(&partial[0], nThreads);
+        default: return sumScalar_(&partial[0], nThreads);
+    }
+}
+
+double simdSum(const double * a, Index n){
+    if (vectorThreadCount(n) == 1) return sum_(a, n);
+    return run_(KernelSum, const_cast< double * >(a), NULL, 0.0, n, SIMDPlus);
+}
+
+double simdDot(const double * a, const double * b, Index n){
+    if (vectorThreadCount(n) == 1) return dot_(a, b, n);
+    return run_(KernelDot, const_cast< double * >(a), b, 0.0, n, SIMDPlus);
+}
+
+double simdMin(const double * a, Index n){
+    if (vectorThreadCount(n) == 1) return min_(a, n);
+    return run_(KernelMin, const_cast< double * >(a), NULL, 0.0, n, SIMDPlus);
+}
+
+double simdMax(const double * a, Index n){
+    if (vectorThreadCount(n) == 1) return max_(a, n);
+    return run_(KernelMax, const_cast< double * >(a), NULL, 0.0, n, SIMDPlus);
+}
+
+void simdApply(double * a, const double * b, Index n, SIMDOp op){
+    if (vectorThreadCount(n) == 1) return apply_(a, b, n, op);
+    run_(KernelApplyVec, a, b, 0.0, n, op);
+}
+
+void simdApply(double * a, double b, Index n, SIMDOp op){
+    if (vectorThreadCount(n) == 1) return apply_(a, b, n, op);
+    run_(KernelApplyVal, a, NULL, b, n, op);
+}
+
+} // namespace GIMLI
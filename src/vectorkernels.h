@@ -0,0 +1,148 @@
+/******************************************************************************
+ *   Copyright (C) 2007-2018 by the GIMLi development team                    *
+ *   Carsten Rücker carsten@resistivity.net                                   *
+ *                                                                            *
+ *   Licensed under the Apache License, Version 2.0 (the "License");          *
+ *   you may not use this file except in compliance with the License.         *
+ *   You may obtain a copy of the License at                                  *
+ *                                                                            *
+ *       http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                            *
+ *   Unless required by applicable law or agreed to in writing, software      *
+ *   distributed under the License is distributed on an "AS IS" BASIS,        *
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *   See the License for the specific language governing permissions and      *
+ *   limitations under the License.                                           *
+ *                                                                            *
+ ******************************************************************************/
+
+#ifndef GIMLI_VECTORKERNELS__H
+#define GIMLI_VECTORKERNELS__H
+
+#include "gimli.h"
+
+namespace GIMLI{
+
+/*! Byte alignment of the Vector storage. Fits a cache line and one AVX-512 register. */
+#define GIMLI_VECTOR_ALIGNMENT 64
+
+/*! Allocate uninitialized memory of size bytes at a \ref GIMLI_VECTOR_ALIGNMENT boundary.
+ * Throws on failure. Release with \ref alignedFree. */
+DLLEXPORT void * alignedMalloc(Index bytes);
+
+/*! Release memory obtained by \ref alignedMalloc. NULL is ignored. */
+DLLEXPORT void alignedFree(void * ptr);
+
+/*! Counters of the thread local vector arena, see \ref VectorArenaScope. */
+struct DLLEXPORT VectorArenaStats{
+    VectorArenaStats()
+        : hits(0), misses(0), recycled(0), dropped(0), cachedBytes(0), peakBytes(0){}
+    /*! Allocations served from the cache. */
+    Index hits;
+    /*! Allocations passed to \ref alignedMalloc. */
+    Index misses;
+    /*! Released blocks kept in the cache. */
+    Index recycled;
+    /*! Released blocks freed because the cache was full. */
+    Index dropped;
+    /*! Bytes currently held by the cache. */
+    Index cachedBytes;
+    /*! Largest amount of bytes held by the cache. */
+    Index peakBytes;
+};
+
+DLLEXPORT std::ostream & operator << (std::ostream & str, const VectorArenaStats & s);
+
+/*! Opt-in scope for a thread local arena of vector storage.
+ * While a scope lives, storage released by vectors on this thread is kept in
+ * a cache and handed out again to vectors of the same capacity that are
+ * created on this thread. This spares the system allocator the many full
+ * size temporaries of iterative solvers.
+ * Scopes can be nested, the outermost scope owns the cache and frees it on
+ * destruction. The cached blocks are plain \ref alignedMalloc memory, so
+ * vectors may safely outlive the scope or be freed by other threads.
+ * \code
+ * {
+ *     VectorArenaScope arena;
+ *     for (...) { RVector tmp(x / y); ... } // reuses the storage of tmp
+ *     std::cout << arena.stats() << std::endl;
+ * }
+ * \endcode */
+class DLLEXPORT VectorArenaScope{
+public:
+    /*! Open the scope. maxBytes limits the cache of the outermost scope. */
+    VectorArenaScope(Index maxBytes=Index(1) << 30);
+
+    /*! Close the scope. The outermost scope frees all cached blocks. */
+    ~VectorArenaScope();
+
+    /*! Return the counters of the arena of this thread. */
+    VectorArenaStats stats() const;
+
+private:
+    VectorArenaScope(const VectorArenaScope &);
+    VectorArenaScope & operator = (const VectorArenaScope &);
+};
+
+/*! Return the counters of the arena of the calling thread. Returns empty
+ * counters if no \ref VectorArenaScope is open. */
+DLLEXPORT VectorArenaStats vectorArenaStats();
+
+/*! Allocate vector storage of size bytes. Takes a cached block if a
+ * \ref VectorArenaScope is open on this thread, else \ref alignedMalloc. */
+DLLEXPORT void * vectorArenaMalloc(Index bytes);
+
+/*! Release vector storage from \ref vectorArenaMalloc. bytes must be the
+ * requested size. The block is cached if a \ref VectorArenaScope is open. */
+DLLEXPORT void vectorArenaFree(void * ptr, Index bytes);
+
+/*! Instruction set used for the double precision vector kernels. */
+enum SIMDLevel{SIMDScalar = 0, SIMDAVX2 = 1, SIMDAVX512 = 2};
+
+/*! Return the instruction set currently used for the vector kernels.
+ * Defaults to the best one supported by the running cpu. */
+DLLEXPORT SIMDLevel simdLevel();
+
+/*! Force the instruction set for the vector kernels, e.g., SIMDScalar for
+ * debugging. Levels the cpu does not support are lowered to the best supported one. */
+DLLEXPORT void setSIMDLevel(SIMDLevel level);
+
+/*! Set the vector size from which the vector kernels and the expression
+ * assignment are distributed over \ref threadCount() threads. 0 disables threading. */
+DLLEXPORT void setVectorThreadingThreshold(Index n);
+DLLEXPORT Index vectorThreadingThreshold();
+
+/*! Return the amount of threads to use for a vector operation of size n.
+ * Returns 1 inside the worker threads of \ref distributeCalc. */
+DLLEXPORT Index vectorThreadCount(Index n);
+
+/*! Call fn(data, start, end) for the ranges of [0, n) distributed over
+ * nThreads threads. Used by the expression assignment of \ref Vector, so
+ * vector.h does not depend on the thread implementation. */
+DLLEXPORT void vectorDistribute(void (*fn)(void * data, Index start, Index end),
+                                void * data, Index n, Index nThreads);
+
+/*! Elementwise operation for \ref simdApply. */
+enum SIMDOp{SIMDPlus, SIMDMinus, SIMDMult, SIMDDivid};
+
+/*! Return a[0] + ... + a[n-1]. */
+DLLEXPORT double simdSum(const double * a, Index n);
+
+/*! Return a[0] * b[0] + ... + a[n-1] * b[n-1]. */
+DLLEXPORT double simdDot(const double * a, const double * b, Index n);
+
+/*! Return the smallest value of a[0, n). n must be > 0. */
+DLLEXPORT double simdMin(const double * a, Index n);
+
+/*! Return the largest value of a[0, n). n must be > 0. */
+DLLEXPORT double simdMax(const double * a, Index n);
+
+/*! Inplace a[i] = a[i] op b[i] for i in [0, n). */
+DLLEXPORT void simdApply(double * a, const double * b, Index n, SIMDOp op);
+
+/*! Inplace a[i] = a[i] op b for i in [0, n). */
+DLLEXPORT void simdApply(double * a, double b, Index n, SIMDOp op);
+
+} // namespace GIMLI
+
+#endif // GIMLI_VECTORKERNELS__H
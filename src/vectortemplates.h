@@ -249,7 +249,12 @@ template < class Vec > double norml1(const Vec & a) {
 
 template < class Vec > double norml2(const Vec & a) {
   // vector norm \ell^2 nicht L^2
-  return normlp(a, 2);
+  // single pass, pow(abs(a), 2) would create two temporary vectors
+  return std::sqrt(sum(square(abs(a))));
+}
+
+inline double norml2(const RVector & a) {
+  return std::sqrt(dot(a, a));
 }
 template < class Vec > double normlInfinity(const Vec & a) {
   return max(abs(a));
@@ -0,0 +1,176 @@
+#ifndef _GIMLI_TESTBERT__H
+#define _GIMLI_TESTBERT__H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <gimli.h>
+#include <mesh.h>
+#include <meshgenerators.h>
+#include <bert/bertDataContainer.h>
+#include <bert/bertJacobian.h>
+#include <bert/bertMisc.h>
+#include <bert/dcfemmodelling.h>
+
+using namespace GIMLI;
+
+class BERTTest : public CppUnit::TestFixture{
+    CPPUNIT_TEST_SUITE(BERTTest);
+    CPPUNIT_TEST(testMatrixFreeJacobian);
+    CPPUNIT_TEST(testCompressedJacobian);
+    CPPUNIT_TEST(testResponseMT);
+    CPPUNIT_TEST(testCachedAssembly);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+
+    void testMatrixFreeJacobian(){
+        Mesh mesh(createMesh2D(6, 4));
+        for (Index i = 0; i < mesh.cellCount(); i ++) mesh.cell(i).setMarker(i);
+
+        DataContainerERT data;
+        Index nElecs = 5;
+        for (Index i = 0; i < nElecs; i ++) data.createSensor(RVector3(i, 0.0));
+        data.addFourPointData(0, 1, 2, 3);
+        data.addFourPointData(1, 2, 3, 4);
+        data.addFourPointData(0, 4, 1, 3);
+        data.addFourPointData(2, -1, 0, -1);
+        RVector kFactor(data.size());
+        for (Index i = 0; i < kFactor.size(); i ++) kFactor[i] = 1.0 + i * 0.5;
+        data.set("k", kFactor);
+
+        //** two wave numbers with synthetic potentials
+        RVector weights(2); weights[0] = 0.6; weights[1] = 0.4;
+        RVector k(2); k[0] = 0.1; k[1] = 1.3;
+        RMatrix pots(weights.size() * nElecs, mesh.nodeCount());
+        for (Index i = 0; i < pots.rows(); i ++){
+            for (Index j = 0; j < pots.cols(); j ++){
+                pots[i][j] = std::sin(1.0 + i * 0.7 + j * 1.3);
+            }
+        }
+        RVector model(mesh.cellCount());
+        for (Index i = 0; i < model.size(); i ++) model[i] = 10.0 + i;
+
+        RMatrix J;
+        std::vector < std::pair < Index, Index > > matrixClusterIds;
+        createSensitivityCol(J, mesh, data, pots, weights, k,
+                             matrixClusterIds, 1, false);
+        for (Index i = 0; i < J.rows(); i ++) J[i] /= (model * model / data("k")[i]);
+
+        DCMatrixFreeJacobian Jmf(mesh, data, pots, weights, k, model, 2);
+        CPPUNIT_ASSERT(Jmf.rows() == J.rows());
+        CPPUNIT_ASSERT(Jmf.cols() == J.cols());
+
+        double scale = max(abs(J[0]));
+        for (Index i = 0; i < J.rows(); i ++){
+            CPPUNIT_ASSERT(max(abs(Jmf.row(i) - J[i])) < 1e-10 * scale);
+        }
+
+        RVector a(J.cols()); for (Index i = 0; i < a.size(); i ++) a[i] = std::cos(i * 0.3);
+        RVector d(J.rows()); for (Index i = 0; i < d.size(); i ++) d[i] = 1.0 + i;
+        CPPUNIT_ASSERT(max(abs(Jmf.mult(a) - J * a)) < 1e-10 * scale * J.cols());
+        CPPUNIT_ASSERT(max(abs(Jmf.transMult(d) - transMult(J, d))) < 1e-10 * scale * J.rows() * J.rows());
+    }
+
+    void testCompressedJacobian(){
+        //** rows with ties at the drop threshold
+        RMatrix J(3, 8);
+        J[0].fill(1.0);
+        J[1].fill(1.0); J[1][2] = 5.0; J[1][6] = -4.0;
+        for (Index j = 0; j < J.cols(); j ++) J[2][j] = (j % 2 ? 2.0 : -2.0) + (j == 0);
+
+        double relError = 0.5;
+        CompressedJacobian Jc(J, relError);
+        CPPUNIT_ASSERT(Jc.relativeError() <= relError);
+        CPPUNIT_ASSERT(Jc.nVals() > 0);
+
+        for (Index i = 0; i < J.rows(); i ++){
+            RVector e(J.rows(), 0.0); e[i] = 1.0;
+            RVector row(Jc.transMult(e));
+            CPPUNIT_ASSERT(norml2(J[i] - row) <= relError * norml2(J[i]));
+            CPPUNIT_ASSERT(norml2(row) > 0.0);
+        }
+
+        RVector a(J.cols()); for (Index i = 0; i < a.size(); i ++) a[i] = 1.0 + i;
+        RVector JcA(Jc.mult(a));
+        for (Index i = 0; i < J.rows(); i ++){
+            RVector e(J.rows(), 0.0); e[i] = 1.0;
+            CPPUNIT_ASSERT(std::fabs(JcA[i] - dot(Jc.transMult(e), a)) < 1e-12);
+        }
+
+        CompressedJacobian Jfull(J, 0.0);
+        CPPUNIT_ASSERT(Jfull.nVals() == J.rows() * J.cols());
+        CPPUNIT_ASSERT(max(abs(Jfull.mult(a) - J * a)) < 1e-12);
+    }
+
+    void testResponseMT(){
+        //** analytical potentials, no direct solver needed
+        RVector x(13), y(6);
+        for (Index i = 0; i < x.size(); i ++) x[i] = -2.0 + i;
+        for (Index i = 0; i < y.size(); i ++) y[i] = -5.0 + i;
+        Mesh mesh(createMesh2D(x, y));
+        for (Index i = 0; i < mesh.cellCount(); i ++) mesh.cell(i).setMarker(i);
+
+        DataContainerERT data;
+        for (Index i = 0; i < 9; i ++) data.createSensor(RVector3(i, 0.0));
+        for (Index i = 0; i + 3 < data.sensorCount(); i ++) data.addFourPointData(i, i + 3, i + 1, i + 2);
+        data.set("k", geometricFactors(data));
+
+        DCMultiElectrodeModelling fop(mesh, data);
+        fop.setAnalytical(true);
+
+        std::vector < RVector > models;
+        for (Index j = 0; j < 2; j ++){
+            RVector m(mesh.cellCount());
+            for (Index i = 0; i < m.size(); i ++) m[i] = 100.0 + 20.0 * std::sin(i * 0.7 + j);
+            models.push_back(m);
+        }
+        std::vector < RVector > resps(fop.responses(models, 2));
+        for (Index j = 0; j < models.size(); j ++){
+            RVector ref(fop.response(models[j]));
+            CPPUNIT_ASSERT(ref.size() == data.size());
+            CPPUNIT_ASSERT(max(abs(fop.response_mt(models[j]) - ref)) < 1e-10 * max(abs(ref)));
+            CPPUNIT_ASSERT(max(abs(resps[j] - ref)) < 1e-10 * max(abs(ref)));
+        }
+
+        //** no read only response with singularity removal
+        DCSRMultiElectrodeModelling srFop(mesh, data);
+        CPPUNIT_ASSERT_THROW(srFop.response_mt(models[0]), std::length_error);
+    }
+
+
+    void testCachedAssembly(){
+        //** quadratic cells take the cached stiffness for static meshes
+        Mesh tri(2);
+        for (Index j = 0; j < 5; j ++){
+            for (Index i = 0; i < 6; i ++) tri.createNode(RVector3(i + 0.1 * j, j * 0.7));
+        }
+        for (Index j = 0; j < 4; j ++){
+            for (Index i = 0; i < 5; i ++){
+                Index n = j * 6 + i;
+                tri.createTriangle(tri.node(n), tri.node(n + 1), tri.node(n + 7));
+                tri.createTriangle(tri.node(n), tri.node(n + 7), tri.node(n + 6));
+            }
+        }
+        tri.createNeighbourInfos();
+        Mesh mesh(tri.createP2());
+        for (Index i = 0; i < mesh.cellCount(); i ++) mesh.cell(i).setAttribute(10.0 + i);
+        RVector x(mesh.nodeCount());
+        for (Index i = 0; i < x.size(); i ++) x[i] = std::sin(0.3 * i);
+
+        for (Index i = 0; i < 2; i ++){
+            double k = 0.3 * i;
+            mesh.setStaticGeometry(true);
+            RSparseMatrix S;
+            dcfemDomainAssembleStiffnessMatrix(S, mesh, k, false);
+            mesh.setStaticGeometry(false);
+            RSparseMatrix Sref;
+            dcfemDomainAssembleStiffnessMatrix(Sref, mesh, k, false);
+            RVector ref(Sref * x);
+            CPPUNIT_ASSERT(max(abs(S * x - ref)) < 1e-12 * max(abs(ref)));
+        }
+    }
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(BERTTest);
+
+#endif
@@ -7,6 +7,8 @@
 #include <meshentities.h>
 #include <elementmatrix.h>
 #include <integration.h>
+#include <mesh.h>
+#include <meshgenerators.h>
 
 class FEMTest : public CppUnit::TestFixture  {
     CPPUNIT_TEST_SUITE(FEMTest);
@@ -16,6 +18,8 @@ class FEMTest : public CppUnit::TestFixture  {
     CPPUNIT_TEST(testFEM1D);
     CPPUNIT_TEST(testFEM2D);
     CPPUNIT_TEST(testFEM3D);
+    CPPUNIT_TEST(testCellGradientCache);
+    CPPUNIT_TEST(testElementKernel);
 
     CPPUNIT_TEST_SUITE_END();
 
@@ -68,6 +72,120 @@ public:
         testStiffness3D();
     }
 
+    void testCellGradientCache(){
+        GIMLI::Mesh mesh2(GIMLI::createMesh2D(4, 3));
+        checkCellGradientCache_(mesh2);
+        GIMLI::Mesh mesh3(GIMLI::createMesh3D(3u, 2u, 2u));
+        checkCellGradientCache_(mesh3);
+    }
+
+    /*! Compare the cached stiffness matrices with the uncached ones, before
+     * and after an anisotropic scaling that has to drop the cache. */
+    void checkCellGradientCache_(GIMLI::Mesh & mesh){
+        mesh.setStaticGeometry(true);
+        GIMLI::ElementMatrix< double > S, Sc;
+
+        GIMLI::RVector before(mesh.cellCount());
+        for (GIMLI::Index i = 0; i < mesh.cellCount(); i ++){
+            const GIMLI::Cell & cell = mesh.cell(i);
+            S.ux2uy2uz2(cell);
+            Sc.ux2uy2uz2(cell, mesh.cellGradientCache());
+            CPPUNIT_ASSERT(Sc.idx() == S.idx());
+            for (GIMLI::Index j = 0; j < S.size(); j ++){
+                CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(Sc[j] - S[j])) < 1e-12 * GIMLI::max(GIMLI::abs(S[j])));
+            }
+            before[i] = S[0][0];
+        }
+
+        //** the cache is rebuilt in place, earlier references stay valid
+        const GIMLI::CellGradientCache & cache = mesh.cellGradientCache();
+        mesh.scale(GIMLI::RVector3(2.0, 0.5, 3.0));
+        CPPUNIT_ASSERT(&mesh.cellGradientCache() == &cache);
+        for (GIMLI::Index i = 0; i < mesh.cellCount(); i ++){
+            const GIMLI::Cell & cell = mesh.cell(i);
+            S.ux2uy2uz2(cell);
+            Sc.ux2uy2uz2(cell, mesh.cellGradientCache());
+            CPPUNIT_ASSERT(::fabs(S[0][0] - before[i]) > 1e-3 * ::fabs(before[i]));
+            for (GIMLI::Index j = 0; j < S.size(); j ++){
+                CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(Sc[j] - S[j])) < 1e-12 * GIMLI::max(GIMLI::abs(S[j])));
+            }
+        }
+
+        //** without static geometry every call rebuilds the same object
+        mesh.setStaticGeometry(false);
+        mesh.node(0).setPos(mesh.node(0).pos() * 0.9);
+        CPPUNIT_ASSERT(&mesh.cellGradientCache() == &cache);
+        const GIMLI::Cell & cell = **mesh.node(0).cellSet().begin();
+        S.ux2uy2uz2(cell);
+        Sc.ux2uy2uz2(cell, cache);
+        for (GIMLI::Index j = 0; j < S.size(); j ++){
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(Sc[j] - S[j])) < 1e-12 * GIMLI::max(GIMLI::abs(S[j])));
+        }
+    }
+
+    /*! Compare the stack kernel with ElementMatrix u2 * k2 + ux2uy2uz2. */
+    template < GIMLI::Index N > bool checkElementKernel_(const GIMLI::Cell & cell, double k2){
+        GIMLI::ElementKernel< N > K;
+        if (!GIMLI::elementKernel(cell, k2, K)) return false;
+
+        GIMLI::ElementMatrix< double > S, S1;
+        S1.ux2uy2uz2(cell);
+        S.u2(cell);
+        S *= k2;
+        S += S1;
+        CPPUNIT_ASSERT(S.size() == N);
+        double nrm = 0.0;
+        for (GIMLI::Index i = 0; i < N; i ++) nrm = std::max(nrm, GIMLI::max(GIMLI::abs(S.row(i))));
+        for (GIMLI::Index i = 0; i < N; i ++){
+            CPPUNIT_ASSERT(K.idx(i) == S.idx(i));
+            for (GIMLI::Index j = 0; j < N; j ++){
+                CPPUNIT_ASSERT(::fabs(K.getVal(i, j) - S.getVal(i, j)) < 1e-12 * nrm);
+            }
+        }
+        return true;
+    }
+
+    void testElementKernel(){
+        GIMLI::Mesh mesh2(2);
+        GIMLI::Node * n0 = mesh2.createNode(GIMLI::RVector3(0.1, 0.2));
+        GIMLI::Node * n1 = mesh2.createNode(GIMLI::RVector3(2.3, 0.4));
+        GIMLI::Node * n2 = mesh2.createNode(GIMLI::RVector3(2.9, 1.7));
+        GIMLI::Node * n3 = mesh2.createNode(GIMLI::RVector3(0.6, 1.5));
+        GIMLI::Cell * tri = mesh2.createTriangle(*n0, *n1, *n2);
+        GIMLI::Cell * quad = mesh2.createQuadrangle(*n0, *n1, *n2, *n3);
+
+        //** a parallelepiped with a tetrahedron, a prism and a hexahedron in it
+        GIMLI::Mesh mesh3(3);
+        GIMLI::RVector3 e0(1.2, 0.1, 0.2), e1(0.3, 0.9, -0.1), e2(0.1, 0.2, 1.4);
+        std::vector < GIMLI::Node * > nodes;
+        for (GIMLI::Index k = 0; k < 2; k ++){
+            for (GIMLI::Index j = 0; j < 2; j ++){
+                for (GIMLI::Index i = 0; i < 2; i ++){
+                    nodes.push_back(mesh3.createNode(GIMLI::RVector3(-1.0, 0.5, 2.0) +
+                                                     e0 * double(i) + e1 * double(j) + e2 * double(k)));
+                }
+            }
+        }
+        GIMLI::Cell * tet = mesh3.createTetrahedron(*nodes[0], *nodes[1], *nodes[2], *nodes[4]);
+        std::vector < GIMLI::Node * > prismNodes;
+        prismNodes.push_back(nodes[0]); prismNodes.push_back(nodes[1]); prismNodes.push_back(nodes[2]);
+        prismNodes.push_back(nodes[4]); prismNodes.push_back(nodes[5]); prismNodes.push_back(nodes[6]);
+        GIMLI::Cell * prism = mesh3.createCell(prismNodes);
+        std::vector < GIMLI::Node * > hexNodes;
+        hexNodes.push_back(nodes[0]); hexNodes.push_back(nodes[1]); hexNodes.push_back(nodes[3]); hexNodes.push_back(nodes[2]);
+        hexNodes.push_back(nodes[4]); hexNodes.push_back(nodes[5]); hexNodes.push_back(nodes[7]); hexNodes.push_back(nodes[6]);
+        GIMLI::Cell * hex = mesh3.createCell(hexNodes);
+
+        double k2s[2] = {0.0, 0.37};
+        for (GIMLI::Index i = 0; i < 2; i ++){
+            CPPUNIT_ASSERT(checkElementKernel_< 3 >(*tri, k2s[i]));
+            CPPUNIT_ASSERT(checkElementKernel_< 4 >(*quad, k2s[i]));
+            CPPUNIT_ASSERT(checkElementKernel_< 4 >(*tet, k2s[i]));
+            CPPUNIT_ASSERT(checkElementKernel_< 6 >(*prism, k2s[i]));
+            CPPUNIT_ASSERT(checkElementKernel_< 8 >(*hex, k2s[i]));
+        }
+    }
+
     void testStiffness1D(){
         
         std::vector < GIMLI::Node * > n(2);
@@ -12,6 +12,15 @@
 #include <polynomial.h>
 #include <pos.h>
 
+#include <curvefitting.h>
+#include <datacontainer.h>
+#include <dc1dmodelling.h>
+#include <em1dmodelling.h>
+#include <gravimetry.h>
+#include <meshgenerators.h>
+#include <ttdijkstramodelling.h>
+#include <inversion.h>
+
 class GIMLIMiscTest : public CppUnit::TestFixture  {
     CPPUNIT_TEST_SUITE(GIMLIMiscTest);
     CPPUNIT_TEST(testGimliMisc);
@@ -21,6 +30,16 @@ class GIMLIMiscTest : public CppUnit::TestFixture  {
     //CPPUNIT_TEST(testIPCSHM);
     CPPUNIT_TEST(testMemWatch);
     CPPUNIT_TEST(testPolynomialFunction);
+    CPPUNIT_TEST(testLinearCurveFitter);
+    CPPUNIT_TEST(testAnalyticJacobian1D);
+    CPPUNIT_TEST(testDC1dMulti);
+    CPPUNIT_TEST(testFDEMHankelTable);
+    CPPUNIT_TEST(testMT1dImpedance);
+    CPPUNIT_TEST(testMRSKernel);
+    CPPUNIT_TEST(testGravimetryTreeCode);
+    CPPUNIT_TEST(testGravimetryCylinder);
+    CPPUNIT_TEST(testTravelTimeResponseMT);
+    CPPUNIT_TEST(testConcurrentInversion);
 //     CPPUNIT_TEST(testRotationByQuaternion);
     
 	//CPPUNIT_TEST_EXCEPTION(funct, exception);
@@ -176,6 +195,522 @@ public:
         
     }
     
+
+    /*! Compare the analytic Jacobian of fop with the brute force one of
+     * ModellingBase and with central differences. */
+    void checkJacobian_(GIMLI::ModellingBase & fop, const GIMLI::RVector & model){
+        fop.ModellingBase::createJacobian(model);
+        GIMLI::RMatrix Jfd(*dynamic_cast< GIMLI::RMatrix * >(fop.jacobian()));
+        fop.createJacobian(model);
+        GIMLI::RMatrix J(*dynamic_cast< GIMLI::RMatrix * >(fop.jacobian()));
+
+        CPPUNIT_ASSERT(J.rows() == Jfd.rows());
+        CPPUNIT_ASSERT(J.cols() == Jfd.cols());
+
+        double nrm = 0.0, err = 0.0, errCD = 0.0;
+        for (GIMLI::Index j = 0; j < J.cols(); j ++){
+            GIMLI::RVector m1(model), m2(model);
+            double h = model[j] * 1e-6;
+            m1[j] += h; m2[j] -= h;
+            GIMLI::RVector cd((fop.response(m1) - fop.response(m2)) / (2.0 * h));
+            for (GIMLI::Index i = 0; i < J.rows(); i ++){
+                nrm += J[i][j] * J[i][j];
+                err += (J[i][j] - Jfd[i][j]) * (J[i][j] - Jfd[i][j]);
+                errCD += (J[i][j] - cd[i]) * (J[i][j] - cd[i]);
+            }
+        }
+        //** brute force uses a forward step of 5 %
+        CPPUNIT_ASSERT(std::sqrt(err / nrm) < 0.05);
+        CPPUNIT_ASSERT(std::sqrt(errCD / nrm) < 1e-5);
+    }
+
+    void testLinearCurveFitter(){
+        //** exact 2D polynomial data in Pascal's triangle style
+        std::vector < GIMLI::RVector3 > pos;
+        for (GIMLI::Index j = 0; j < 6; j ++){
+            for (GIMLI::Index i = 0; i < 7; i ++) pos.push_back(GIMLI::RVector3(-1.0 + i * 0.4, 0.5 * j - 1.0));
+        }
+        GIMLI::PolynomialModelling fop(2, 3, pos, GIMLI::RVector(0));
+        fop.setPascalsStyle(true);
+
+        GIMLI::RVector p0(fop.startModel());
+        GIMLI::RMatrix coeff(3, p0.size());
+        GIMLI::RMatrix data(coeff.rows(), pos.size());
+        for (GIMLI::Index s = 0; s < coeff.rows(); s ++){
+            for (GIMLI::Index c = 0; c < p0.size(); c ++){
+                if (p0[c] != 0.0) coeff[s][c] = 0.5 * (1.0 + s) - 0.25 * c;
+            }
+            data[s] = fop.response(coeff[s]);
+        }
+
+        GIMLI::LinearCurveFitter fitter(fop.designMatrix());
+        CPPUNIT_ASSERT(fitter.rankDefect() == p0.size() - GIMLI::sum(GIMLI::abs(p0)));
+
+        GIMLI::RMatrix fitted(fitter.fit(data, 2));
+        CPPUNIT_ASSERT(fitted.rows() == coeff.rows());
+        GIMLI::RMatrix fittedData(fitter.response(fitted));
+        for (GIMLI::Index s = 0; s < coeff.rows(); s ++){
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(fitted[s] - coeff[s])) < 1e-10);
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(fitter.fit(data[s]) - fitted[s])) < 1e-12);
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(fop.response(fitted[s]) - data[s])) < 1e-10);
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(fittedData[s] - data[s])) < 1e-10);
+        }
+
+        //** a small scaled design matrix keeps all its coefficients
+        GIMLI::RMatrix G(10, 2);
+        GIMLI::RVector line(G.rows());
+        for (GIMLI::Index t = 0; t < G.rows(); t ++){
+            G[t][0] = 1e-7;
+            G[t][1] = 1e-7 * t;
+            line[t] = 3.0 + 2.0 * t;
+        }
+        GIMLI::LinearCurveFitter lineFitter(G);
+        CPPUNIT_ASSERT(lineFitter.rankDefect() == 0);
+        GIMLI::RVector lineCoeff(lineFitter.fit(line));
+        CPPUNIT_ASSERT(std::fabs(lineCoeff[0] - 3e7) < 1e-6 * 3e7);
+        CPPUNIT_ASSERT(std::fabs(lineCoeff[1] - 2e7) < 1e-6 * 2e7);
+
+        GIMLI::LinearCurveFitter scaledFitter(fop.designMatrix() * 1e-7);
+        CPPUNIT_ASSERT(scaledFitter.rankDefect() == fitter.rankDefect());
+        GIMLI::RMatrix scaled(scaledFitter.fit(data, 2));
+        for (GIMLI::Index s = 0; s < coeff.rows(); s ++){
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(scaled[s] * 1e-7 - coeff[s])) < 1e-10);
+        }
+    }
+
+    void testAnalyticJacobian1D(){
+        GIMLI::Index nlay = 3;
+        GIMLI::RVector model(nlay * 2 - 1);
+        model[0] = 5.0; model[1] = 12.0;                  // thk
+        model[2] = 100.0; model[3] = 10.0; model[4] = 500.0; // rho
+
+        GIMLI::RVector ab2(10), mn2(10, 0.5);
+        for (GIMLI::Index i = 0; i < ab2.size(); i ++) ab2[i] = 1.5 * std::pow(1.6, double(i));
+        GIMLI::DC1dModelling dc(nlay, ab2, mn2);
+        checkJacobian_(dc, model);
+
+        GIMLI::RVector periods(8);
+        for (GIMLI::Index i = 0; i < periods.size(); i ++) periods[i] = 1e-3 * std::pow(5.0, double(i));
+        GIMLI::MT1dModelling mt(periods, nlay);
+        checkJacobian_(mt, model);
+
+        GIMLI::RVector freqs(5);
+        for (GIMLI::Index i = 0; i < freqs.size(); i ++) freqs[i] = 110.0 * std::pow(3.0, double(i));
+        GIMLI::FDEM1dModelling fdem(nlay, freqs, 10.0, -1.0);
+        GIMLI::RVector fdemModel(model);
+        fdemModel[0] = 2.0; fdemModel[1] = 4.0;
+        checkJacobian_(fdem, fdemModel);
+
+        //** a zero thickness layer gives a finite Jacobian
+        GIMLI::RVector model0(model); model0[1] = 0.0;
+        mt.createJacobian(model0);
+        GIMLI::RMatrix J0(*dynamic_cast< GIMLI::RMatrix * >(mt.jacobian()));
+        for (GIMLI::Index i = 0; i < J0.rows(); i ++){
+            CPPUNIT_ASSERT(!GIMLI::haveInfNaN(J0[i]));
+        }
+    }
+
+    void testDC1dMulti(){
+        GIMLI::Index nlay = 3, nS = 5, nPar = nlay * 2 - 1;
+        GIMLI::RVector ab2(10), mn2(10, 0.5);
+        for (GIMLI::Index i = 0; i < ab2.size(); i ++) ab2[i] = 1.5 * std::pow(1.6, double(i));
+
+        //** parameter major over the soundings
+        GIMLI::RVector model(nPar * nS);
+        for (GIMLI::Index s = 0; s < nS; s ++){
+            model[0 * nS + s] = 5.0 + s;
+            model[1 * nS + s] = 12.0 - s;
+            model[2 * nS + s] = 100.0 + 20.0 * s;
+            model[3 * nS + s] = 10.0 * (1.0 + s);
+            model[4 * nS + s] = 500.0 - 50.0 * s;
+        }
+
+        GIMLI::DC1dMultiModelling multi(nlay, nS, ab2, mn2);
+        multi.setThreadCount(2);
+        GIMLI::RVector resp(multi.response(model));
+        CPPUNIT_ASSERT(resp.size() == nS * ab2.size());
+        multi.createJacobian(model);
+        const GIMLI::DC1dMultiJacobian & J =
+            *dynamic_cast< GIMLI::DC1dMultiJacobian * >(multi.jacobian());
+
+        GIMLI::DC1dModelling single(nlay, ab2, mn2);
+        for (GIMLI::Index s = 0; s < nS; s ++){
+            GIMLI::RVector ms(nPar);
+            for (GIMLI::Index p = 0; p < nPar; p ++) ms[p] = model[p * nS + s];
+            GIMLI::RVector ref(single.response(ms));
+            GIMLI::RVector rs(resp(s * ab2.size(), (s + 1) * ab2.size()));
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(rs - ref)) < 1e-10 * GIMLI::max(ref));
+
+            //** central differences of the single sounding
+            const GIMLI::RMatrix & Js = J.block(s);
+            double nrm = 0.0, err = 0.0;
+            for (GIMLI::Index p = 0; p < nPar; p ++){
+                GIMLI::RVector m1(ms), m2(ms);
+                double h = ms[p] * 1e-6;
+                m1[p] += h; m2[p] -= h;
+                GIMLI::RVector cd((single.response(m1) - single.response(m2)) / (2.0 * h));
+                for (GIMLI::Index i = 0; i < ab2.size(); i ++){
+                    nrm += Js[i][p] * Js[i][p];
+                    err += (Js[i][p] - cd[i]) * (Js[i][p] - cd[i]);
+                }
+            }
+            CPPUNIT_ASSERT(std::sqrt(err / nrm) < 1e-5);
+        }
+
+        //** the block operator agrees with its blocks
+        GIMLI::RVector dm(model.size());
+        for (GIMLI::Index i = 0; i < dm.size(); i ++) dm[i] = std::sin(i * 0.7);
+        GIMLI::RVector Jdm(J.mult(dm));
+        for (GIMLI::Index s = 0; s < nS; s ++){
+            GIMLI::RVector dms(nPar);
+            for (GIMLI::Index p = 0; p < nPar; p ++) dms[p] = dm[p * nS + s];
+            GIMLI::RVector ref(J.block(s) * dms);
+            GIMLI::RVector js(Jdm(s * ab2.size(), (s + 1) * ab2.size()));
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(js - ref)) < 1e-10 * GIMLI::max(GIMLI::abs(ref)));
+        }
+
+        //** an empty sounding set still runs on one thread
+        GIMLI::DC1dMultiModelling empty(nlay, 0, ab2, mn2);
+        CPPUNIT_ASSERT(empty.response(GIMLI::RVector(0)).size() == 0);
+    }
+
+    void testFDEMHankelTable(){
+        //** inphase and quadrature of the per call Hankel evaluation, i.e.,
+        //** btp for each frequency and filter point before the tabulation
+        double ref1[10] = {
+            3.785316905296693e-04, 3.077182320937137e-03, 2.507856845422854e-02,
+            1.981405138876523e-01, 1.415134501217044e+00, 7.807392047812513e-02,
+            2.339239618521058e-01, 6.987228584079095e-01, 2.058895167974443e+00,
+            5.719484951364312e+00};
+        double ref2[6] = {
+            -1.035047527832877e+01, -2.478205092471228e+01, -4.858181778219112e+01,
+            -8.870969536073856e+00, -1.335687191386704e+01, -2.376608704004022e+01};
+
+        GIMLI::RVector freqs(5);
+        for (GIMLI::Index i = 0; i < freqs.size(); i ++) freqs[i] = 110.0 * std::pow(3.0, double(i));
+        GIMLI::FDEM1dModelling fdem(3, freqs, 10.0, -1.0);
+        GIMLI::RVector model(5);
+        model[0] = 2.0; model[1] = 4.0;                      // thk
+        model[2] = 100.0; model[3] = 10.0; model[4] = 500.0; // rho
+        GIMLI::RVector resp(fdem.response(model));
+        CPPUNIT_ASSERT(resp.size() == 10);
+        for (GIMLI::Index i = 0; i < resp.size(); i ++){
+            CPPUNIT_ASSERT(std::fabs(resp[i] - ref1[i]) < 1e-12 * std::fabs(ref1[i]));
+        }
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(fdem.response_mt(model) - resp)) == 0.0);
+
+        //** one coil spacing per frequency and an airborne height
+        GIMLI::RVector freqs2(3), cs(3);
+        freqs2[0] = 900.0; freqs2[1] = 7200.0; freqs2[2] = 56000.0;
+        cs[0] = 4.5; cs[1] = 8.0; cs[2] = 2.0;
+        GIMLI::FDEM1dModelling fdem2(2, freqs2, cs, -30.0);
+        GIMLI::RVector model2(3);
+        model2[0] = 15.0; model2[1] = 30.0; model2[2] = 3.0;
+        GIMLI::RVector resp2(fdem2.response(model2));
+        CPPUNIT_ASSERT(resp2.size() == 6);
+        for (GIMLI::Index i = 0; i < resp2.size(); i ++){
+            CPPUNIT_ASSERT(std::fabs(resp2[i] - ref2[i]) < 1e-12 * std::fabs(ref2[i]));
+        }
+    }
+
+    /*! App. res. and phase by the complex impedance recursion, one period after another. */
+    GIMLI::RVector mtRhoaPhiPerPeriod_(const GIMLI::RVector & periods,
+                                       const GIMLI::RVector & rho,
+                                       const GIMLI::RVector & thk){
+        GIMLI::Index nl = rho.size(), np = periods.size();
+        double my0 = PI * 4e-7;
+        GIMLI::Complex iu(0.0, 1.0);
+        GIMLI::RVector ret(np * 2);
+        for (GIMLI::Index i = 0; i < np; i ++){
+            double omega = 2.0 * PI / periods[i];
+            GIMLI::Complex z(std::sqrt(iu * omega * rho[nl - 1] / my0));
+            for (int k = nl - 2; k >= 0; k --){
+                GIMLI::Complex adm(std::sqrt(my0 / (rho[k] * iu * omega)));
+                GIMLI::Complex alpha(thk[k] * std::sqrt(iu * my0 * omega / rho[k]));
+                GIMLI::Complex tanalpha(std::tanh(alpha));
+                z = (adm * z + tanalpha) / (adm * z * tanalpha + 1.0) / adm;
+            }
+            ret[i] = std::abs(z) * std::abs(z) * my0 / omega;
+            ret[i + np] = std::atan(std::imag(z) / std::real(z));
+        }
+        return ret;
+    }
+
+    void testMT1dImpedance(){
+        //** periods over eight decades, so exp(-2 alpha) underflows for the thick layer
+        GIMLI::RVector periods(33);
+        for (GIMLI::Index i = 0; i < periods.size(); i ++) periods[i] = 1e-4 * std::pow(10.0, 0.25 * i);
+        GIMLI::Index nlay = 4;
+        GIMLI::RVector model(nlay * 2 - 1);
+        model[0] = 50.0; model[1] = 300.0; model[2] = 5000.0;                  // thk
+        model[3] = 100.0; model[4] = 3.0; model[5] = 1000.0; model[6] = 20.0;  // rho
+        GIMLI::RVector thk(model(0, nlay - 1)), rho(model(nlay - 1, 2 * nlay - 1));
+
+        GIMLI::MT1dModelling mt(periods, nlay);
+        GIMLI::RVector ref(mtRhoaPhiPerPeriod_(periods, rho, thk));
+        GIMLI::RVector resp(mt.rhoaphi(rho, thk));
+        CPPUNIT_ASSERT(resp.size() == ref.size());
+        for (GIMLI::Index i = 0; i < ref.size(); i ++){
+            CPPUNIT_ASSERT(std::fabs(resp[i] - ref[i]) < 1e-10 * std::fabs(ref[i]));
+        }
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(mt.response_mt(model) - resp)) == 0.0);
+
+        //** batched stations
+        GIMLI::RMatrix models(5, model.size());
+        for (GIMLI::Index s = 0; s < models.rows(); s ++){
+            models[s] = model;
+            models[s][nlay - 1 + s % nlay] *= 1.0 + 0.5 * s;
+        }
+        GIMLI::RMatrix resps(mt.responses(models, 2));
+        CPPUNIT_ASSERT(resps.rows() == models.rows());
+        for (GIMLI::Index s = 0; s < models.rows(); s ++){
+            GIMLI::RVector refS(mtRhoaPhiPerPeriod_(periods, models[s](nlay - 1, 2 * nlay - 1),
+                                                    models[s](0, nlay - 1)));
+            for (GIMLI::Index i = 0; i < refS.size(); i ++){
+                CPPUNIT_ASSERT(std::fabs(resps[s][i] - refS[i]) < 1e-10 * std::fabs(refS[i]));
+            }
+        }
+    }
+
+    void testMRSKernel(){
+        GIMLI::Index nRows = 24, nCols = 30;
+        GIMLI::RMatrix KR(nRows, nCols), KI(nRows, nCols);
+        for (GIMLI::Index i = 0; i < nRows; i ++){
+            for (GIMLI::Index j = 0; j < nCols; j ++){
+                KR[i][j] = std::sin(0.3 * i + 0.11 * j) * std::exp(-0.05 * j);
+                KI[i][j] = std::cos(0.17 * i - 0.23 * j) * std::exp(-0.07 * j);
+            }
+        }
+        GIMLI::RVector model(nCols);
+        for (GIMLI::Index j = 0; j < nCols; j ++) model[j] = 0.1 + 0.2 * std::fabs(std::sin(0.4 * j));
+
+        //** separate amplitude and Jacobian as before the fused kernel
+        GIMLI::RVector ddr(KR * model), ddi(KI * model);
+        GIMLI::RVector ampRef(GIMLI::sqrt(ddr * ddr + ddi * ddi));
+        GIMLI::RMatrix JRef(nRows, nCols);
+        for (GIMLI::Index i = 0; i < nRows; i ++){
+            JRef[i] = (KR[i] * ddr[i] + KI[i] * ddi[i]) / ampRef[i];
+        }
+
+        GIMLI::MRSModelling fop(KR, KI);
+        GIMLI::RVector amp(fop.response(model));
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(amp - ampRef)) < 1e-12 * GIMLI::max(ampRef));
+        fop.createJacobian(model);
+        GIMLI::RMatrix J(*dynamic_cast< GIMLI::RMatrix * >(fop.jacobian()));
+        CPPUNIT_ASSERT(J.rows() == nRows && J.cols() == nCols);
+        for (GIMLI::Index i = 0; i < nRows; i ++){
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(J[i] - JRef[i])) < 1e-12 * GIMLI::max(GIMLI::abs(JRef[i])));
+        }
+
+        //** single precision storage accumulates in double, so the float
+        //** rounding of the kernel dominates
+        for (GIMLI::Index single = 0; single < 2; single ++){
+            double tol = single ? 1e-6 : 1e-12;
+            GIMLI::MRSKernel kernel(KR, KI, single == 1);
+            CPPUNIT_ASSERT(kernel.singlePrecision() == (single == 1));
+            for (GIMLI::Index nThreads = 1; nThreads < 4; nThreads += 2){
+                GIMLI::RVector a;
+                GIMLI::RMatrix Jk;
+                kernel.amplitude(model, a, &Jk, nThreads);
+                CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(a - ampRef)) < tol * GIMLI::max(ampRef));
+                for (GIMLI::Index i = 0; i < nRows; i ++){
+                    CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(Jk[i] - JRef[i])) < tol * GIMLI::max(GIMLI::abs(JRef[i])));
+                }
+            }
+            GIMLI::MRSModelling kfop(kernel);
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(kfop.response(model) - ampRef)) < tol * GIMLI::max(ampRef));
+        }
+    }
+
+    /*! Compare the tree code with the dense kernel for mult and transMult. */
+    void checkGravimetryTree_(GIMLI::Mesh & mesh, GIMLI::DataContainer & data,
+                              double accuracy){
+        GIMLI::GravimetryModelling fop(mesh, data);
+        const GIMLI::MatrixBase & K = fop.kernel();
+
+        GIMLI::GravimetryTreeOperator T(mesh, data.sensorPositions(), accuracy, 2);
+        CPPUNIT_ASSERT(T.rows() == K.rows());
+        CPPUNIT_ASSERT(T.cols() == K.cols());
+
+        GIMLI::RVector dens(mesh.cellCount());
+        for (GIMLI::Index i = 0; i < dens.size(); i ++) dens[i] = 100.0 + 50.0 * std::sin(i * 0.37);
+        GIMLI::RVector b(data.sensorCount());
+        for (GIMLI::Index i = 0; i < b.size(); i ++) b[i] = 1.0 + std::cos(i * 0.61);
+
+        GIMLI::RVector g(K.mult(dens));
+        GIMLI::RVector gT(K.transMult(b));
+        CPPUNIT_ASSERT(GIMLI::norml2(T.mult(dens) - g) < 10.0 * accuracy * GIMLI::norml2(g));
+        CPPUNIT_ASSERT(GIMLI::norml2(T.transMult(b) - gT) < 10.0 * accuracy * GIMLI::norml2(gT));
+    }
+
+    void testGravimetryTreeCode(){
+        GIMLI::RVector x(41), y(11);
+        for (GIMLI::Index i = 0; i < x.size(); i ++) x[i] = -20.0 + i;
+        for (GIMLI::Index i = 0; i < y.size(); i ++) y[i] = -10.0 + i;
+
+        GIMLI::Mesh mesh2(GIMLI::createMesh2D(x, y));
+        GIMLI::DataContainer data2;
+        for (GIMLI::Index i = 0; i < 60; i ++) data2.createSensor(GIMLI::RVector3(-30.0 + i, 0.5));
+        checkGravimetryTree_(mesh2, data2, 1e-3);
+
+        GIMLI::RVector x3(17), z3(7);
+        for (GIMLI::Index i = 0; i < x3.size(); i ++) x3[i] = -8.0 + i;
+        for (GIMLI::Index i = 0; i < z3.size(); i ++) z3[i] = -6.0 + i;
+        GIMLI::Mesh mesh3(GIMLI::createMesh3D(x3, x3, z3));
+        GIMLI::DataContainer data3;
+        for (GIMLI::Index i = 0; i < 12; i ++){
+            for (GIMLI::Index j = 0; j < 12; j ++){
+                data3.createSensor(GIMLI::RVector3(-11.0 + 2.0 * i, -11.0 + 2.0 * j, 0.5));
+            }
+        }
+        //** a station at a cell center stays finite
+        data3.createSensor(mesh3.cell(0).center());
+        checkGravimetryTree_(mesh3, data3, 1e-3);
+    }
+
+    void testGravimetryCylinder(){
+        //** horizontal cylinder as a regular polygon, its field outside
+        //** equals the field of a line mass of the polygon area
+        GIMLI::Index nSeg = 64;
+        double radius = 2.0, depth = 5.0, dRho = 1000.0;
+        GIMLI::Mesh mesh(2);
+        GIMLI::Node * center = mesh.createNode(GIMLI::RVector3(0.0, -depth));
+        std::vector < GIMLI::Node * > ring;
+        for (GIMLI::Index i = 0; i < nSeg; i ++){
+            double phi = 2.0 * PI * i / nSeg;
+            ring.push_back(mesh.createNode(GIMLI::RVector3(radius * std::cos(phi),
+                                                           -depth + radius * std::sin(phi))));
+        }
+        for (GIMLI::Index i = 0; i < nSeg; i ++){
+            //** every other triangle clockwise
+            if (i % 2) mesh.createTriangle(*center, *ring[i], *ring[(i + 1) % nSeg]);
+            else mesh.createTriangle(*center, *ring[(i + 1) % nSeg], *ring[i]);
+        }
+        double area = 0.5 * nSeg * radius * radius * std::sin(2.0 * PI / nSeg);
+
+        GIMLI::DataContainer data;
+        std::vector < GIMLI::RVector3 > pos;
+        for (GIMLI::Index i = 0; i < 21; i ++){
+            pos.push_back(GIMLI::RVector3(-20.0 + 2.0 * i, 0.0));
+            data.createSensor(pos.back());
+        }
+        GIMLI::RVector dens(mesh.cellCount(), dRho);
+
+        GIMLI::RVector ana(pos.size());
+        for (GIMLI::Index i = 0; i < pos.size(); i ++){
+            double x = pos[i][0];
+            ana[i] = 2.0 * 6.67384e-11 * 1e5 * dRho * area * depth / (x * x + depth * depth);
+        }
+
+        GIMLI::GravimetryModelling fop(mesh, data);
+        GIMLI::RVector gz(fop.response(dens));
+        CPPUNIT_ASSERT(GIMLI::min(gz) > 0.0);
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(gz - ana)) < 1e-8 * GIMLI::max(ana));
+
+        //** the legacy integration shares the sign convention
+        GIMLI::RVector gzC(GIMLI::calcGCells(pos, mesh, dens, 0));
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(gzC - ana)) < 1e-8 * GIMLI::max(ana));
+        GIMLI::RVector gzQ(GIMLI::calcGCells(pos, mesh, dens, 5));
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(gzQ - ana)) < 1e-3 * GIMLI::max(ana));
+    }
+
+    void testTravelTimeResponseMT(){
+        GIMLI::RVector x(11), y(6);
+        for (GIMLI::Index i = 0; i < x.size(); i ++) x[i] = i;
+        for (GIMLI::Index i = 0; i < y.size(); i ++) y[i] = -5.0 + i;
+        GIMLI::Mesh mesh(GIMLI::createMesh2D(x, y));
+        for (GIMLI::Index i = 0; i < mesh.cellCount(); i ++) mesh.cell(i).setMarker(i);
+
+        GIMLI::DataContainer data;
+        data.registerSensorIndex("s");
+        data.registerSensorIndex("g");
+        for (GIMLI::Index i = 0; i < x.size(); i ++) data.createSensor(GIMLI::RVector3(x[i], 0.0));
+        GIMLI::RVector s, g;
+        for (GIMLI::Index shot = 0; shot < x.size(); shot += 5){
+            for (GIMLI::Index i = 0; i < x.size(); i ++){
+                if (i == shot) continue;
+                s.push_back(shot); g.push_back(i);
+            }
+        }
+        data.resize(s.size());
+        data.set("s", s);
+        data.set("g", g);
+
+        GIMLI::TravelTimeDijkstraModelling fop(mesh, data);
+        std::vector < GIMLI::RVector > models;
+        for (GIMLI::Index j = 0; j < 3; j ++){
+            GIMLI::RVector m(mesh.cellCount());
+            for (GIMLI::Index i = 0; i < m.size(); i ++) m[i] = 1.0 + 0.5 * std::sin(i * 0.3 + j);
+            models.push_back(m);
+        }
+
+        std::vector < GIMLI::RVector > resps(fop.responses(models, 2));
+        for (GIMLI::Index j = 0; j < models.size(); j ++){
+            GIMLI::RVector ref(fop.response(models[j]));
+            CPPUNIT_ASSERT(ref.size() == data.size());
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(fop.response_mt(models[j]) - ref)) < 1e-12);
+            CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(resps[j] - ref)) < 1e-12);
+        }
+
+        //** a shot unknown to the operator
+        GIMLI::RVector s2(s); s2[0] = 1;
+        data.set("s", s2);
+        CPPUNIT_ASSERT_THROW(fop.response_mt(models[0]), std::length_error);
+    }
+
+    GIMLI::RVector invertTravelTimes_(GIMLI::Index nThreads, bool optLambda){
+        GIMLI::RVector x(11), y(6);
+        for (GIMLI::Index i = 0; i < x.size(); i ++) x[i] = i;
+        for (GIMLI::Index i = 0; i < y.size(); i ++) y[i] = -5.0 + i;
+        GIMLI::Mesh mesh(GIMLI::createMesh2D(x, y));
+
+        GIMLI::DataContainer data;
+        data.registerSensorIndex("s");
+        data.registerSensorIndex("g");
+        for (GIMLI::Index i = 0; i < x.size(); i ++) data.createSensor(GIMLI::RVector3(x[i], 0.0));
+        GIMLI::RVector s, g;
+        for (GIMLI::Index shot = 0; shot < x.size(); shot += 2){
+            for (GIMLI::Index i = 0; i < x.size(); i ++){
+                if (i == shot) continue;
+                s.push_back(shot); g.push_back(i);
+            }
+        }
+        data.resize(s.size());
+        data.set("s", s);
+        data.set("g", g);
+
+        GIMLI::TravelTimeDijkstraModelling fop(mesh, data);
+        GIMLI::RVector synth(mesh.cellCount(), 1.0);
+        for (GIMLI::Index i = 0; i < mesh.cellCount(); i ++){
+            if (mesh.cell(i).center()[1] > -2.0) synth[i] = 2.0;
+        }
+        GIMLI::RVector t(fop.response(synth));
+
+        GIMLI::RInversion inv(t, fop, false, false);
+        inv.setRelativeError(0.01);
+        inv.setModel(GIMLI::RVector(mesh.cellCount(), 1.5));
+        inv.setLambda(10.0);
+        inv.setMaxIter(3);
+        inv.setOptimizeLambda(optLambda);
+        inv.setConcurrentEvaluation(nThreads);
+        return inv.run();
+    }
+
+    void testConcurrentInversion(){
+        //** line search only, the concurrent path differs in the read only parabolic step
+        GIMLI::RVector m1(invertTravelTimes_(1, false));
+        GIMLI::RVector m3(invertTravelTimes_(3, false));
+        CPPUNIT_ASSERT(m1.size() == m3.size());
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(m1 - m3)) < 1e-10 * GIMLI::max(GIMLI::abs(m1)));
+
+        //** batched L-curve lambdas start from the last solution of the batch,
+        //** so they agree with the serial ones only up to the CGLS tolerance
+        GIMLI::RVector l1(invertTravelTimes_(1, true));
+        GIMLI::RVector l3(invertTravelTimes_(3, true));
+        CPPUNIT_ASSERT(l1.size() == l3.size());
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(l1 - l3)) < 1e-3 * GIMLI::max(GIMLI::abs(l1)));
+    }
+
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(GIMLIMiscTest);
@@ -3,6 +3,8 @@
 #include <gimli.h>
 #include <mesh.h>
 #include <meshgenerators.h>
+#include <interpolate.h>
+#include <spatialindex.h>
 
 #include <stdexcept>
 
@@ -13,6 +15,9 @@ class MeshTest : public CppUnit::TestFixture{
     CPPUNIT_TEST(testSimple);
     CPPUNIT_TEST(testRefine2d);
     CPPUNIT_TEST(testRefine3d);
+    CPPUNIT_TEST(testMeshInterpolator);
+    CPPUNIT_TEST(testSpatialIndex);
+    CPPUNIT_TEST(testMerge);
         
     //CPPUNIT_TEST_EXCEPTION(funct, exception);
     CPPUNIT_TEST_SUITE_END();
@@ -131,7 +136,174 @@ public:
         CPPUNIT_ASSERT(q.cellCount() == 8);
         CPPUNIT_ASSERT(q.nodeCount() == 27);
     }
-    
+
+    void testMeshInterpolator(){
+        RVector x(5); for (Index i = 0; i < x.size(); i ++) x[i] = i * i * 0.5;
+        RVector y(4); for (Index i = 0; i < y.size(); i ++) y[i] = -2.0 + i * 0.7;
+        Mesh mesh2(createMesh2D(x, y));
+        checkMeshInterpolator_(mesh2);
+
+        Mesh mesh3(createMesh3D(x, y, y));
+        checkMeshInterpolator_(mesh3);
+    }
+
+    /*! Compare MeshInterpolator::apply with interpolate for node and cell
+     * data, for positions inside, on the nodes and outside of the mesh. */
+    void checkMeshInterpolator_(Mesh & mesh){
+        R3Vector pos;
+        for (Index i = 0; i < 40; i ++){
+            RVector3 p(mesh.xmin() + (mesh.xmax() - mesh.xmin()) * (0.5 + 0.6 * std::sin(i * 1.3)),
+                       mesh.ymin() + (mesh.ymax() - mesh.ymin()) * (0.5 + 0.6 * std::cos(i * 0.7)));
+            if (mesh.dim() == 3) p[2] = mesh.zmin() + (mesh.zmax() - mesh.zmin()) * (0.5 + 0.4 * std::sin(i * 2.1));
+            pos.push_back(p);
+        }
+        pos.push_back(mesh.node(3).pos());
+        pos.push_back(RVector3(mesh.xmax() + 1.0, mesh.ymin(), mesh.zmin()));
+
+        RVector nodeData(mesh.nodeCount());
+        for (Index i = 0; i < nodeData.size(); i ++){
+            nodeData[i] = std::sin(mesh.node(i).pos()[0]) + mesh.node(i).pos()[1];
+        }
+        RVector cellData(mesh.cellCount());
+        for (Index i = 0; i < cellData.size(); i ++) cellData[i] = 1.0 + i % 7;
+
+        double fill = -99.0;
+        MeshInterpolator I(mesh, pos);
+        CPPUNIT_ASSERT(I.size() == pos.size());
+        CPPUNIT_ASSERT(I.outside().size() > 0);
+
+        RVector ref(interpolate(mesh, nodeData, pos, false, fill));
+        CPPUNIT_ASSERT(max(abs(I.apply(nodeData, fill) - ref)) < 1e-12);
+        for (Index i = 0; i < I.outside().size(); i ++){
+            CPPUNIT_ASSERT(I.apply(nodeData, fill)[I.outside()[i]] == fill);
+            CPPUNIT_ASSERT(ref[I.outside()[i]] == fill);
+        }
+        CPPUNIT_ASSERT(std::fabs(I.apply(nodeData)[pos.size() - 2] - nodeData[3]) < 1e-12);
+
+        RVector refCell(interpolate(mesh, cellDataToPointData(mesh, cellData), pos, false, fill));
+        CPPUNIT_ASSERT(max(abs(I.apply(cellData, fill) - refCell)) < 1e-12);
+
+        //** empty rows are left untouched
+        RMatrix in(3, 0), out(3, pos.size());
+        in[0] = nodeData; in[2] = cellData;
+        out[1].fill(7.0);
+        I.apply(in, out, fill);
+        CPPUNIT_ASSERT(out.rows() == in.rows());
+        CPPUNIT_ASSERT(max(abs(out[0] - ref)) < 1e-12);
+        CPPUNIT_ASSERT(out[1] == RVector(pos.size(), 7.0));
+        CPPUNIT_ASSERT(max(abs(out[2] - refCell)) < 1e-12);
+    }
+
+    void testSpatialIndex(){
+        SpatialIndex empty;
+        CPPUNIT_ASSERT_THROW(empty.nearest(RVector3(0.0, 0.0, 0.0)), std::length_error);
+
+        R3Vector pts;
+        for (Index i = 0; i < 300; i ++){
+            pts.push_back(RVector3(std::sin(i * 1.1) * 10.0, std::cos(i * 2.3) * 5.0, std::sin(i * 0.37)));
+        }
+        SpatialIndex index(pts);
+        checkSpatialIndex_(index, pts);
+
+        //** inserts trigger merges of the internal trees
+        for (Index i = 0; i < 70; i ++){
+            RVector3 p(std::cos(i * 0.9) * 12.0, std::sin(i * 1.7) * 4.0, 0.5);
+            index.insert(p, pts.size());
+            pts.push_back(p);
+        }
+        CPPUNIT_ASSERT(index.size() == pts.size());
+        checkSpatialIndex_(index, pts);
+    }
+
+    /*! Compare nearest, k-nearest and radius queries with brute force. */
+    void checkSpatialIndex_(const SpatialIndex & index, const R3Vector & pts){
+        Index k = 5;
+        double r = 2.5;
+        R3Vector queries;
+        for (Index q = 0; q < 25; q ++){
+            queries.push_back(RVector3(std::cos(q * 0.77) * 11.0, std::sin(q * 1.9) * 6.0, std::cos(q * 3.1)));
+        }
+        IndexArray nearestIds(index.nearest(queries));
+        std::vector< IndexArray > kIds(index.nearest(queries, k));
+        std::vector< IndexArray > rIds(index.radius(queries, r));
+
+        for (Index q = 0; q < queries.size(); q ++){
+            const RVector3 & pos = queries[q];
+            RVector dists(pts.size());
+            for (Index i = 0; i < pts.size(); i ++) dists[i] = pos.distance(pts[i]);
+            RVector sorted(sort(dists));
+
+            double dist = -1.0;
+            Index id = index.nearest(pos, &dist);
+            CPPUNIT_ASSERT(std::fabs(dist - sorted[0]) < 1e-12);
+            CPPUNIT_ASSERT(std::fabs(dists[id] - sorted[0]) < 1e-12);
+            CPPUNIT_ASSERT(nearestIds[q] == id);
+
+            IndexArray ids; RVector kDists;
+            index.nearest(pos, k, ids, kDists);
+            CPPUNIT_ASSERT(ids.size() == k);
+            CPPUNIT_ASSERT(kIds[q] == ids);
+            for (Index i = 0; i < k; i ++){
+                CPPUNIT_ASSERT(std::fabs(kDists[i] - sorted[i]) < 1e-12);
+                CPPUNIT_ASSERT(std::fabs(dists[ids[i]] - sorted[i]) < 1e-12);
+            }
+
+            IndexArray inside(index.radius(pos, r));
+            CPPUNIT_ASSERT(rIds[q] == inside);
+            CPPUNIT_ASSERT(inside.size() == find(dists <= r).size());
+            for (Index i = 0; i < inside.size(); i ++){
+                CPPUNIT_ASSERT(dists[inside[i]] <= r);
+                if (i > 0) CPPUNIT_ASSERT(dists[inside[i - 1]] <= dists[inside[i]]);
+            }
+        }
+    }
+
+    void testMerge(){
+        //** two meshes touching at x = 3, the second one slightly shifted
+        RVector xa(4); for (Index i = 0; i < xa.size(); i ++) xa[i] = i;
+        RVector xb(3); for (Index i = 0; i < xb.size(); i ++) xb[i] = 3.0 + i * 0.5 + 1e-8;
+        RVector y(3); for (Index i = 0; i < y.size(); i ++) y[i] = i * 0.8;
+        Mesh a(createMesh2D(xa, y));
+        Mesh b(createMesh2D(xb, y));
+
+        //** bulk node creation, including duplicates within pos
+        R3Vector pos(b.positions());
+        pos.push_back(b.node(1).pos());
+        pos.push_back(RVector3(3.0, 0.8 + 1e-7));
+        pos.push_back(RVector3(-1.0, 0.0));
+        Mesh bulk(a), seq(a);
+        IndexArray bulkIds(bulk.createNodesWithCheck(pos));
+        CPPUNIT_ASSERT(bulkIds.size() == pos.size());
+        for (Index i = 0; i < pos.size(); i ++){
+            CPPUNIT_ASSERT(bulkIds[i] == Index(seq.createNodeWithCheck(pos[i])->id()));
+        }
+        CPPUNIT_ASSERT(bulk.nodeCount() == seq.nodeCount());
+        for (Index i = 0; i < bulk.nodeCount(); i ++){
+            CPPUNIT_ASSERT(bulk.node(i).pos() == seq.node(i).pos());
+        }
+
+        //** merge versus sequential copies of cells and boundaries
+        Mesh merged(a); seq = a;
+        IndexArray map(merged.merge(b));
+        for (Index i = 0; i < b.cellCount(); i ++) seq.copyCell(b.cell(i));
+        for (Index i = 0; i < b.boundaryCount(); i ++) seq.copyBoundary(b.boundary(i));
+
+        CPPUNIT_ASSERT(map.size() == b.nodeCount());
+        CPPUNIT_ASSERT(merged.nodeCount() == seq.nodeCount());
+        CPPUNIT_ASSERT(merged.nodeCount() == a.nodeCount() + b.nodeCount() - y.size());
+        CPPUNIT_ASSERT(merged.cellCount() == seq.cellCount());
+        CPPUNIT_ASSERT(merged.boundaryCount() == seq.boundaryCount());
+        for (Index i = 0; i < b.nodeCount(); i ++){
+            CPPUNIT_ASSERT(merged.node(map[i]).pos().distance(b.node(i).pos()) < 1e-6);
+        }
+        //** merge creates the nodes in node order, copyCell in cell order
+        for (Index i = 0; i < merged.cellCount(); i ++){
+            for (Index j = 0; j < merged.cell(i).nodeCount(); j ++){
+                CPPUNIT_ASSERT(merged.cell(i).node(j).pos() == seq.cell(i).node(j).pos());
+            }
+        }
+    }
+
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(MeshTest);
\ No newline at end of file
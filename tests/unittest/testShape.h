@@ -23,6 +23,7 @@ class ShapeTest : public CppUnit::TestFixture  {
     CPPUNIT_TEST(testInterpolate);
     CPPUNIT_TEST(testSplit);
     CPPUNIT_TEST(testGridGen);
+    CPPUNIT_TEST(testInsideOrExit);
     
     CPPUNIT_TEST_SUITE_END();
 
@@ -248,6 +249,69 @@ public:
         
     }
     
+    void testInsideOrExit(){
+        GIMLI::Mesh quads(GIMLI::createMesh2D(3, 3));
+        checkInsideOrExit_(quads);
+
+        GIMLI::Mesh tris(2);
+        for (GIMLI::Index i = 0; i < quads.nodeCount(); i ++) tris.createNode(quads.node(i).pos());
+        for (GIMLI::Index i = 0; i < quads.cellCount(); i ++){
+            const GIMLI::Cell & c = quads.cell(i);
+            tris.createTriangle(tris.node(c.node(0).id()), tris.node(c.node(1).id()), tris.node(c.node(2).id()));
+            tris.createTriangle(tris.node(c.node(0).id()), tris.node(c.node(2).id()), tris.node(c.node(3).id()));
+        }
+        checkInsideOrExit_(tris);
+
+        GIMLI::RVector z(3); z[0] = 0.0; z[1] = 0.7; z[2] = 1.5;
+        GIMLI::Mesh prisms(GIMLI::createMesh3D(tris, z));
+        checkInsideOrExit_(prisms);
+
+        GIMLI::Mesh hexs(GIMLI::createMesh3D(3u, 3u, 3u));
+        checkInsideOrExit_(hexs);
+
+        GIMLI::Mesh tets(3);
+        for (GIMLI::Index i = 0; i < hexs.nodeCount(); i ++) tets.createNode(hexs.node(i).pos());
+        for (GIMLI::Index i = 0; i < hexs.cellCount(); i ++){
+            const GIMLI::Cell & c = hexs.cell(i);
+            for (GIMLI::Index j = 0; j < 6; j ++){
+                tets.createTetrahedron(tets.node(c.node(GIMLI::HexahedronSplit6TetID[j][0]).id()),
+                                       tets.node(c.node(GIMLI::HexahedronSplit6TetID[j][1]).id()),
+                                       tets.node(c.node(GIMLI::HexahedronSplit6TetID[j][2]).id()),
+                                       tets.node(c.node(GIMLI::HexahedronSplit6TetID[j][3]).id()));
+            }
+        }
+        checkInsideOrExit_(tets);
+    }
+
+    /*! Points just behind the center of each boundary have to exit through
+     * this boundary, towards the same neighbor as Cell::neighbourCell(sf). */
+    void checkInsideOrExit_(GIMLI::Mesh & mesh){
+        mesh.createNeighbourInfos();
+        for (GIMLI::Index i = 0; i < mesh.cellCount(); i ++){
+            GIMLI::Cell & c = mesh.cell(i);
+            int exitFace = -2;
+            CPPUNIT_ASSERT(c.shape().isInsideOrExit(c.center(), exitFace));
+
+            for (GIMLI::Index j = 0; j < c.boundaryCount(); j ++){
+                std::vector < GIMLI::Node * > nodes(c.boundaryNodes(j));
+                GIMLI::RVector3 bc(0.0, 0.0, 0.0);
+                for (GIMLI::Index k = 0; k < nodes.size(); k ++) bc += nodes[k]->pos();
+                bc /= double(nodes.size());
+                GIMLI::RVector3 pos(c.center() + (bc - c.center()) * 1.1);
+
+                CPPUNIT_ASSERT(!c.shape().isInsideOrExit(pos, exitFace));
+                CPPUNIT_ASSERT(exitFace == int(j));
+
+                GIMLI::RVector sf;
+                c.shape().isInside(pos, sf, false);
+                CPPUNIT_ASSERT(c.neighbourCell(exitFace) == c.neighbourCell(sf));
+                if (c.neighbourCell(exitFace)){
+                    CPPUNIT_ASSERT(c.neighbourCell(exitFace)->shape().isInside(pos));
+                }
+            }
+        }
+    }
+
     template < class cell > void checkCellBoundNorms_(cell & c){
         for (Index i = 0; i < c.boundaryCount(); i ++ ){
             
@@ -28,8 +28,10 @@ class VectorTest : public CppUnit::TestFixture  {
     CPPUNIT_TEST(testCVector);
     CPPUNIT_TEST(testRVector3);
     CPPUNIT_TEST(testMatrix);
+    CPPUNIT_TEST(testMatrixExpression);
     CPPUNIT_TEST(testBlockMatrix);
     CPPUNIT_TEST(testSparseMapMatrix);
+    CPPUNIT_TEST(testSparseRowMatrix);
     CPPUNIT_TEST(testFind);
     CPPUNIT_TEST(testIO);
 
@@ -431,6 +433,35 @@ public:
 //        testMatrix_< float >();
     }
 
+    void testMatrixExpression(){
+        GIMLI::RMatrix J(4, 3);
+        for (GIMLI::Index i = 0; i < J.rows(); i ++){
+            for (GIMLI::Index j = 0; j < J.cols(); j ++) J[i][j] = std::sin(1.0 + i * 3 + j);
+        }
+        GIMLI::RVector d(J.rows()); for (GIMLI::Index i = 0; i < d.size(); i ++) d[i] = 1.0 + i;
+        GIMLI::RVector m(J.cols()); for (GIMLI::Index i = 0; i < m.size(); i ++) m[i] = 0.5 - i;
+
+        //** explicitly scaled copy of J
+        GIMLI::RMatrix S(J);
+        for (GIMLI::Index i = 0; i < S.rows(); i ++){
+            for (GIMLI::Index j = 0; j < S.cols(); j ++) S[i][j] *= d[i] * m[j];
+        }
+
+        GIMLI::RVector b(J.cols()); for (GIMLI::Index i = 0; i < b.size(); i ++) b[i] = std::cos(i * 0.7);
+        GIMLI::RVector y(J.rows()); for (GIMLI::Index i = 0; i < y.size(); i ++) y[i] = 2.0 - i;
+
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs((GIMLI::diag(d) * J * GIMLI::diag(m)) * b - S * b)) < TOLERANCE);
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(GIMLI::mult(GIMLI::diag(d) * J * GIMLI::diag(m), b) - S * b)) < TOLERANCE);
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(GIMLI::transMult(GIMLI::diag(d) * J * GIMLI::diag(m), y)
+                                             - GIMLI::transMult(S, y))) < TOLERANCE);
+
+        GIMLI::RMatrix C(GIMLI::diag(d) * J * GIMLI::diag(m));
+        CPPUNIT_ASSERT(C == S);
+        C = J;
+        C = GIMLI::diag(d) * C;
+        for (GIMLI::Index i = 0; i < C.rows(); i ++) CPPUNIT_ASSERT(C[i] == J[i] * d[i]);
+    }
+
     void testBlockMatrix(){
         GIMLI::BlockMatrix < double > A(false);
 
@@ -478,6 +509,38 @@ public:
         CPPUNIT_ASSERT(((C+C)*2.0).getVal(1, 1) == 8.0);
     }
 
+    void testSparseRowMatrix(){
+        //** rectangular, unsorted entries with duplicates and an empty row
+        GIMLI::Index nRows = 5, nCols = 7;
+        GIMLI::RSparseMapMatrix M(nRows, nCols);
+        GIMLI::SparseRowMatrix S(nRows, nCols);
+        for (GIMLI::Index k = 0; k < 20; k ++){
+            GIMLI::Index i = (k * 3) % nRows;
+            if (i == 2) continue;
+            GIMLI::Index j = (k * 5 + 6) % nCols;
+            double v = 1.0 + 0.5 * k;
+            M.addVal(i, j, v);
+            S.addVal(i, j, v);
+        }
+        S.compress();
+        CPPUNIT_ASSERT(S.rows() == nRows);
+        CPPUNIT_ASSERT(S.cols() == nCols);
+        CPPUNIT_ASSERT(S.nVals() == M.nVals());
+
+        //** values added after compress are merged into the rows
+        M.addVal(4, 0, -2.0); S.addVal(4, 0, -2.0);
+        M.addVal(0, 6, 3.0);  S.addVal(0, 6, 3.0);
+        S.compress();
+
+        GIMLI::RVector a(nCols); for (GIMLI::Index i = 0; i < a.size(); i ++) a[i] = std::cos(1.0 + i);
+        GIMLI::RVector b(nRows); for (GIMLI::Index i = 0; i < b.size(); i ++) b[i] = 1.0 - i * 0.3;
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(S.mult(a) - M.mult(a))) < TOLERANCE);
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(S.transMult(b) - M.transMult(b))) < TOLERANCE);
+        CPPUNIT_ASSERT(GIMLI::max(GIMLI::abs(GIMLI::transMult(S, b) - M.transMult(b))) < TOLERANCE);
+        CPPUNIT_ASSERT(S.mult(a)[2] == 0.0);
+        CPPUNIT_ASSERT_THROW(S.mult(b), std::length_error);
+    }
+
     void testIO(){
         RVector v(100);
         randn(v);
@@ -16,6 +16,7 @@
     #include "testShape.h"
     #include "testGeometry.h"
     #include "testFEM.h"
+    #include "testBERT.h"
     #include "testExternals.h"
 
 #endif // HAVE_UNITTEST